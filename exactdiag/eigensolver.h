@@ -0,0 +1,7 @@
+#pragma once
+#include "global.h"
+
+#include "eigensolver/lanczos.h"
+#include "eigensolver/lobpcg.h"
+#include "eigensolver/davidson.h"
+#include "eigensolver/sector_driver.h"
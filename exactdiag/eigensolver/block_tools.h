@@ -0,0 +1,60 @@
+#pragma once
+#include "../global.h"
+
+#include <Eigen/Dense>
+
+#include "../utility/scalar_tools.h"
+
+namespace detail {
+
+//! @brief Orthonormal basis of the span of the columns (SVQB).
+//!
+//! The columns are scaled to unit norm, and their Gram matrix is diagonalized. Directions
+//! whose eigenvalue is below 1000 eps times the largest one are dropped, so the result
+//! may have fewer columns than the argument.
+template <typename Derived>
+typename Derived::PlainObject orthonormalize(const Eigen::MatrixBase<Derived>& v)
+{
+  using Scalar = typename Derived::Scalar;
+  using RealScalar = typename Eigen::NumTraits<Scalar>::Real;
+  using MatrixType = Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic>;
+  using RealVectorType = Eigen::Matrix<RealScalar, Eigen::Dynamic, 1>;
+
+  const RealScalar drop = 1E3 * std::numeric_limits<RealScalar>::epsilon();
+  MatrixType gram = v.adjoint() * v;
+  RealVectorType scale(v.cols());
+  for (Eigen::Index i = 0; i < v.cols(); ++i) {
+    RealScalar norm = std::sqrt(real_part(gram(i, i)));
+    scale(i) = (norm > 0) ? 1 / norm : 0;
+  }
+  gram = scale.asDiagonal() * gram * scale.asDiagonal();
+  Eigen::SelfAdjointEigenSolver<MatrixType> solver(gram);
+  RealScalar max_value = (v.cols() > 0) ? solver.eigenvalues().maxCoeff() : 0;
+  std::vector<Eigen::Index> kept;
+  for (Eigen::Index i = 0; i < v.cols(); ++i) {
+    if (solver.eigenvalues()(i) > drop * max_value) { kept.push_back(i); }
+  }
+  MatrixType t(v.cols(), static_cast<Eigen::Index>(kept.size()));
+  for (size_t i = 0; i < kept.size(); ++i) {
+    t.col(static_cast<Eigen::Index>(i)) = scale.asDiagonal() * solver.eigenvectors().col(kept[i])
+                                          / std::sqrt(solver.eigenvalues()(kept[i]));
+  }
+  return v * t;
+}
+
+//! @brief Dense matrix of an operator, obtained by applying it to the identity block.
+//!
+//! The operator has apply(x, y, n_vector) for row-major blocks (see Lobpcg).
+//! The result is made exactly Hermitian.
+template <typename Scalar, typename OperatorType>
+Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic> dense_matrix(const OperatorType& op)
+{
+  using BlockType = Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>;
+  using RealScalar = typename Eigen::NumTraits<Scalar>::Real;
+  Eigen::Index n = static_cast<Eigen::Index>(op.size());
+  BlockType x = BlockType::Identity(n, n), y(n, n);
+  op.apply(x.data(), y.data(), op.size());
+  return (y + y.adjoint()) / RealScalar(2);
+}
+
+} // namespace detail
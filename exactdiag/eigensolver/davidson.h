@@ -0,0 +1,271 @@
+#pragma once
+#include "../global.h"
+
+#include <random>
+#include <Eigen/Dense>
+
+#include "block_tools.h"
+
+//! Correction vector of the Davidson iteration.
+enum class DavidsonCorrection
+{
+  Diagonal,  //!< t = (D - theta)^-1 r  (generalized Davidson)
+  Olsen      //!< t = (D - theta)^-1 (r - eps x), with t orthogonal to x (Jacobi-Davidson with diagonal D)
+};
+
+
+//! @class Davidson
+//!
+//! @brief Davidson solver for the lowest eigenpairs of a Hermitian operator, preconditioned
+//! with its diagonal.
+//!
+//! The operator is any object with
+//!
+//!     size_t size() const;
+//!     void apply(const Scalar* x, Scalar* y, size_t n_vector) const;     // Y = H X (row-major blocks)
+//!     const DiagonalType & diagonal() const;                             // d[i], d.size()
+//!
+//! as SparseHamiltonian and MatrixFreeHamiltonian, whose diagonal is evaluated once per
+//! sector (see SectorDiagonal). The diagonal can also be passed to compute() explicitly.
+//!
+//! Every iteration adds the correction vectors of the unconverged roots to the search
+//! space (in one block product), and the roots are the lowest Ritz pairs in it. When the
+//! search space would grow beyond max_subspace() vectors, it is restarted with the lowest
+//! restart_size() Ritz vectors. The initial vectors are the unit vectors of the smallest
+//! diagonal elements, with a small random admixture so that no symmetry sector is missed.
+//!
+//! This converges in far fewer products than Lanczos when the operator is diagonally
+//! dominant (e.g. large interactions). Sectors with size() <= max_subspace() are
+//! diagonalized densely.
+//!
+//! @tparam _Scalar Scalar type of the vectors (real or complex).
+template <typename _Scalar>
+class Davidson
+{
+ public:
+  using Scalar = _Scalar;
+  using RealScalar = typename Eigen::NumTraits<Scalar>::Real;
+  using MatrixType = Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic>;
+  using RealVectorType = Eigen::Matrix<RealScalar, Eigen::Dynamic, 1>;
+  using BlockType = Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>;
+
+  Davidson()
+      : n_root_(1), max_subspace_(0), restart_size_(0), max_iteration_(1000), tolerance_(1E-8),
+        correction_(DavidsonCorrection::Olsen), seed_(1),
+        n_iteration_(0), n_apply_(0), n_restart_(0), converged_(false)
+  {
+  }
+
+  //! Number of lowest eigenpairs to compute.
+  Davidson& set_n_root(size_t n) { n_root_ = n; return *this; }
+  //! Maximum dimension of the search space (0 for max(20, 4 n_root)).
+  Davidson& set_max_subspace(size_t n) { max_subspace_ = n; return *this; }
+  //! Number of Ritz vectors kept at a restart (0 for 2 n_root).
+  Davidson& set_restart_size(size_t n) { restart_size_ = n; return *this; }
+  Davidson& set_max_iteration(size_t n) { max_iteration_ = n; return *this; }
+  //! A root is converged when |H x - E x| < tolerance * max(1, |E|).
+  Davidson& set_tolerance(RealScalar tol) { tolerance_ = tol; return *this; }
+  Davidson& set_correction(DavidsonCorrection c) { correction_ = c; return *this; }
+  //! Seed of the random admixture to the initial vectors.
+  Davidson& set_seed(unsigned seed) { seed_ = seed; return *this; }
+
+  size_t n_root() const { return n_root_; }
+
+  size_t max_subspace() const {
+    size_t m = (max_subspace_ == 0) ? std::max<size_t>(20, 4 * n_root_) : max_subspace_;
+    return std::max(m, 2 * n_root_);
+  }
+
+  size_t restart_size() const {
+    size_t m = (restart_size_ == 0) ? 2 * n_root_ : restart_size_;
+    return std::min(std::max(m, n_root_), max_subspace() - n_root_);
+  }
+
+  //! @brief Compute the lowest n_root() eigenpairs, with the diagonal of the operator.
+  template <typename OperatorType>
+  Davidson& compute(const OperatorType& op) { return compute(op, op.diagonal()); }
+
+  //! @brief Compute the lowest n_root() eigenpairs.
+  //! @param diagonal Diagonal elements of the operator (operator[] and size()).
+  //! @throw std::domain_error if the operator has fewer than n_root() states.
+  //! @throw std::length_error if the size of the diagonal does not match.
+  template <typename OperatorType, typename DiagonalType>
+  Davidson& compute(const OperatorType& op, const DiagonalType& diagonal)
+  {
+    size_t n = op.size();
+    if (n_root_ == 0 || n < n_root_) {
+      throw std::domain_error("Davidson::compute(): dimension smaller than the number of roots");
+    }
+    if (diagonal.size() != n) {
+      throw std::length_error("Davidson::compute(): diagonal of wrong size");
+    }
+    n_iteration_ = 0;
+    n_apply_ = 0;
+    n_restart_ = 0;
+    converged_ = false;
+    const Eigen::Index nr = static_cast<Eigen::Index>(n_root_);
+
+    if (n <= max_subspace()) {
+      Eigen::SelfAdjointEigenSolver<MatrixType> solver(detail::dense_matrix<Scalar>(op));
+      n_apply_ = n;
+      eigenvalues_ = solver.eigenvalues().head(nr);
+      eigenvectors_ = solver.eigenvectors().leftCols(nr);
+      residuals_ = RealVectorType::Zero(nr);
+      converged_ = true;
+      return *this;
+    }
+
+    const Eigen::Index m_max = static_cast<Eigen::Index>(max_subspace());
+    BlockType v(n, m_max), hv(n, m_max);
+    MatrixType gram(m_max, m_max);
+    Eigen::Index m = 0;
+
+    BlockType t = start_block(diagonal);
+    BlockType x, hx;
+    RealVectorType values;
+    residuals_.resize(nr);
+    for (n_iteration_ = 0; n_iteration_ < max_iteration_; ++n_iteration_) {
+      // extend the search space
+      for (int pass = 0; pass < 2; ++pass) {
+        if (m > 0) { t -= v.leftCols(m) * (v.leftCols(m).adjoint() * t); }
+        t = detail::orthonormalize(t);
+      }
+      if (t.cols() == 0) { break; }
+      BlockType ht(n, t.cols());
+      op.apply(t.data(), ht.data(), static_cast<size_t>(t.cols()));
+      n_apply_ += static_cast<size_t>(t.cols());
+      Eigen::Index a = t.cols();
+      v.middleCols(m, a) = t;
+      hv.middleCols(m, a) = ht;
+      gram.block(0, m, m + a, a) = v.leftCols(m + a).adjoint() * ht;
+      gram.block(m, 0, a, m) = gram.block(0, m, m, a).adjoint();
+      m += a;
+
+      // Ritz pairs
+      MatrixType g = gram.topLeftCorner(m, m);
+      g = (g + g.adjoint()) / RealScalar(2);
+      Eigen::SelfAdjointEigenSolver<MatrixType> solver(g);
+      x = v.leftCols(m) * solver.eigenvectors().leftCols(nr);
+      hx = hv.leftCols(m) * solver.eigenvectors().leftCols(nr);
+      values = solver.eigenvalues().head(nr);
+
+      std::vector<Eigen::Index> active;
+      for (Eigen::Index i = 0; i < nr; ++i) {
+        residuals_(i) = (hx.col(i) - values(i) * x.col(i)).norm();
+        if (residuals_(i) >= tolerance_ * std::max(RealScalar(1), std::abs(values(i)))) { active.push_back(i); }
+      }
+      if (active.empty()) {
+        converged_ = true;
+        break;
+      }
+
+      // correction vectors
+      t.resize(n, static_cast<Eigen::Index>(active.size()));
+      for (size_t j = 0; j < active.size(); ++j) {
+        Eigen::Index i = active[j];
+        correct(diagonal, values(i), x.col(i), hx.col(i), t.col(static_cast<Eigen::Index>(j)));
+      }
+
+      // restart with the lowest Ritz vectors
+      if (m + t.cols() > m_max) {
+        Eigen::Index l = static_cast<Eigen::Index>(restart_size());
+        MatrixType c = solver.eigenvectors().leftCols(l);
+        BlockType kept = v.leftCols(m) * c;
+        v.leftCols(l) = kept;
+        kept = hv.leftCols(m) * c;
+        hv.leftCols(l) = kept;
+        gram.topLeftCorner(l, l) = solver.eigenvalues().head(l).template cast<Scalar>().asDiagonal();
+        m = l;
+        ++n_restart_;
+      }
+    }
+    eigenvalues_ = values;
+    eigenvectors_ = x;
+    return *this;
+  }
+
+  //! Lowest eigenvalues in ascending order.
+  const RealVectorType & eigenvalues() const { return eigenvalues_; }
+
+  //! Orthonormal eigenvectors (columns).
+  const MatrixType & eigenvectors() const { return eigenvectors_; }
+
+  //! |H x - E x| of every root.
+  const RealVectorType & residuals() const { return residuals_; }
+
+  size_t n_iteration() const { return n_iteration_; }
+
+  //! Number of vectors the operator was applied to.
+  size_t n_apply() const { return n_apply_; }
+
+  //! Number of restarts of the search space.
+  size_t n_restart() const { return n_restart_; }
+
+  bool converged() const { return converged_; }
+
+ private:
+  //! Unit vectors of the n_root smallest diagonal elements, plus a small random admixture.
+  template <typename DiagonalType>
+  BlockType start_block(const DiagonalType& diagonal) const {
+    size_t n = diagonal.size();
+    std::vector<size_t> order(n);
+    for (size_t i = 0; i < n; ++i) { order[i] = i; }
+    std::partial_sort(order.begin(), order.begin() + static_cast<std::ptrdiff_t>(n_root_), order.end(),
+                      [&](size_t i, size_t j) {
+                        return detail::real_part(diagonal[i]) < detail::real_part(diagonal[j]);
+                      });
+    std::mt19937 rng(seed_);
+    std::uniform_real_distribution<RealScalar> dist(-1, 1);
+    RealScalar scale = RealScalar(0.1) / std::sqrt(static_cast<RealScalar>(n));
+    BlockType t(n, n_root_);
+    for (Eigen::Index i = 0; i < t.rows(); ++i) {
+      for (Eigen::Index j = 0; j < t.cols(); ++j) { t(i, j) = Scalar(scale * dist(rng)); }
+    }
+    for (size_t j = 0; j < n_root_; ++j) {
+      t(static_cast<Eigen::Index>(order[j]), static_cast<Eigen::Index>(j)) += Scalar(1);
+    }
+    return t;
+  }
+
+  //! Correction vector of the Ritz pair (value, x) with H x = hx.
+  template <typename DiagonalType, typename VectorIn, typename VectorOut>
+  void correct(const DiagonalType& diagonal, RealScalar value,
+               const VectorIn& x, const VectorIn& hx, VectorOut t) const {
+    const RealScalar min_denominator = 1E-8;
+    Eigen::Index n = x.rows();
+    Scalar xt(0), xy(0);
+    std::vector<Scalar> y(correction_ == DavidsonCorrection::Olsen ? static_cast<size_t>(n) : 0);
+    for (Eigen::Index k = 0; k < n; ++k) {
+      RealScalar denominator = detail::real_part(diagonal[static_cast<size_t>(k)]) - value;
+      if (std::abs(denominator) < min_denominator) {
+        denominator = (denominator < 0) ? -min_denominator : min_denominator;
+      }
+      t(k) = (hx(k) - value * x(k)) / denominator;
+      if (correction_ == DavidsonCorrection::Olsen) {
+        y[static_cast<size_t>(k)] = x(k) / denominator;
+        xt += detail::conjugate(x(k)) * t(k);
+        xy += detail::conjugate(x(k)) * y[static_cast<size_t>(k)];
+      }
+    }
+    if (correction_ == DavidsonCorrection::Olsen && xy != Scalar(0)) {
+      Scalar eps = xt / xy;
+      for (Eigen::Index k = 0; k < n; ++k) { t(k) -= eps * y[static_cast<size_t>(k)]; }
+    }
+  }
+
+  size_t n_root_;
+  size_t max_subspace_;
+  size_t restart_size_;
+  size_t max_iteration_;
+  RealScalar tolerance_;
+  DavidsonCorrection correction_;
+  unsigned seed_;
+
+  RealVectorType eigenvalues_;
+  MatrixType eigenvectors_;
+  RealVectorType residuals_;
+  size_t n_iteration_;
+  size_t n_apply_;
+  size_t n_restart_;
+  bool converged_;
+};
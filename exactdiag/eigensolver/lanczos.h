@@ -0,0 +1,248 @@
+#pragma once
+#include "../global.h"
+
+#include <random>
+#include <Eigen/Dense>
+
+#include "../utility/scalar_tools.h"
+
+//! Reorthogonalization of the Lanczos vectors.
+enum class Reorthogonalization
+{
+  None,     //!< plain three-term recurrence (ghost copies of converged eigenvalues may appear)
+  Partial,  //!< against all previous vectors, when the estimated loss of orthogonality exceeds sqrt(eps)
+  Full      //!< against all previous vectors, in every iteration
+};
+
+
+//! @class Lanczos
+//!
+//! @brief Lanczos solver for the lowest eigenpair of a Hermitian operator.
+//!
+//! The operator is any object with
+//!
+//!     size_t size() const;
+//!     void apply(const Scalar* x, Scalar* y) const;     // y = H x
+//!
+//! such as SparseHamiltonian and MatrixFreeHamiltonian.
+//!
+//! In every iteration the tridiagonal matrix is diagonalized, and the residual estimate
+//! |beta_j s_j| of the lowest Ritz pair is recorded (see residuals()). The iteration stops
+//! when it is below tolerance * max(1, |E|).
+//!
+//! In the low-memory mode only three vectors are kept. The first pass computes the
+//! eigenvalue, and the second pass repeats the same recurrence to accumulate the eigenvector.
+//! No reorthogonalization is possible in that mode.
+//!
+//! @tparam _Scalar Scalar type of the vectors (real or complex).
+template <typename _Scalar>
+class Lanczos
+{
+ public:
+  using Scalar = _Scalar;
+  using RealScalar = typename Eigen::NumTraits<Scalar>::Real;
+  using VectorType = Eigen::Matrix<Scalar, Eigen::Dynamic, 1>;
+  using RealVectorType = Eigen::Matrix<RealScalar, Eigen::Dynamic, 1>;
+
+  Lanczos()
+      : max_iteration_(300), tolerance_(1E-10),
+        reorthogonalization_(Reorthogonalization::Full), low_memory_(false), seed_(1),
+        eigenvalue_(0), residual_(0), n_iteration_(0), n_apply_(0), converged_(false)
+  {
+  }
+
+  //! @throw std::domain_error if n is zero.
+  Lanczos& set_max_iteration(size_t n) {
+    if (n == 0) { throw std::domain_error("Lanczos::set_max_iteration(): at least one iteration is required"); }
+    max_iteration_ = n;
+    return *this;
+  }
+  Lanczos& set_tolerance(RealScalar tol) { tolerance_ = tol; return *this; }
+  Lanczos& set_reorthogonalization(Reorthogonalization r) { reorthogonalization_ = r; return *this; }
+  //! Two-pass mode with three vectors. Implies Reorthogonalization::None.
+  Lanczos& set_low_memory(bool low_memory) { low_memory_ = low_memory; return *this; }
+  //! Seed of the random starting vector.
+  Lanczos& set_seed(unsigned seed) { seed_ = seed; return *this; }
+
+  //! @brief Compute the lowest eigenpair.
+  //! @throw std::domain_error if the operator is empty.
+  template <typename OperatorType>
+  Lanczos& compute(const OperatorType& op)
+  {
+    size_t n = op.size();
+    if (n == 0) {
+      throw std::domain_error("Lanczos::compute(): empty operator");
+    }
+    Reorthogonalization reorth = low_memory_ ? Reorthogonalization::None : reorthogonalization_;
+    alpha_.clear();
+    beta_.clear();
+    residuals_.clear();
+    n_iteration_ = 0;
+    n_apply_ = 0;
+    converged_ = false;
+
+    const RealScalar eps = std::numeric_limits<RealScalar>::epsilon();
+    VectorType v = start_vector(n);
+    VectorType v_prev = VectorType::Zero(n);
+    VectorType w(n);
+    std::vector<VectorType> basis;
+    if (!low_memory_) { basis.push_back(v); }
+
+    // partial reorthogonalization: estimates of <v_j, v_k> (Simon's recurrence).
+    std::vector<RealScalar> omega_prev, omega(1, 1), omega_next;
+    bool reorthogonalize_next = false;
+
+    RealVectorType ritz_vector;
+    size_t max_iteration = std::min(max_iteration_, n);
+    for (size_t j = 0; j < max_iteration; ++j) {
+      op.apply(v.data(), w.data());
+      ++n_apply_;
+      RealScalar a = detail::real_part(v.dot(w));
+      w -= a * v;
+      if (j > 0) { w -= beta_[j - 1] * v_prev; }
+      alpha_.push_back(a);
+
+      if (reorth == Reorthogonalization::Full) {
+        orthogonalize(basis, w);
+        orthogonalize(basis, w);
+      }
+      RealScalar b = w.norm();
+
+      if (reorth == Reorthogonalization::Partial) {
+        omega_next.assign(j + 2, 0);
+        for (size_t k = 0; k < j; ++k) {
+          RealScalar x = (alpha_[k] - a) * omega[k] + beta_[k] * omega[k + 1];
+          if (k > 0) { x += beta_[k - 1] * omega[k - 1]; }
+          if (j > 0) { x -= beta_[j - 1] * omega_prev[k]; }
+          x += (x >= 0 ? 1 : -1) * eps * (beta_[k] + b);
+          omega_next[k] = (b > 0) ? x / b : 0;
+        }
+        omega_next[j] = eps * static_cast<RealScalar>(n);
+        omega_next[j + 1] = 1;
+        RealScalar max_omega = 0;
+        for (size_t k = 0; k <= j; ++k) { max_omega = std::max(max_omega, std::abs(omega_next[k])); }
+        if (reorthogonalize_next || max_omega > std::sqrt(eps)) {
+          orthogonalize(basis, w);
+          b = w.norm();
+          for (size_t k = 0; k <= j; ++k) { omega_next[k] = eps; }
+          // the next vector is reorthogonalized as well (as in Simon's scheme)
+          reorthogonalize_next = !reorthogonalize_next;
+        }
+        omega_prev.swap(omega);
+        omega.swap(omega_next);
+      }
+      beta_.push_back(b);
+
+      // lowest Ritz pair of the tridiagonal matrix
+      RealScalar residual_estimate;
+      tridiagonal_ground_state(j + 1, eigenvalue_, ritz_vector);
+      residual_estimate = std::abs(b * ritz_vector(static_cast<Eigen::Index>(j)));
+      residuals_.push_back(residual_estimate);
+      n_iteration_ = j + 1;
+
+      if (residual_estimate < tolerance_ * std::max(RealScalar(1), std::abs(eigenvalue_))
+          || b <= eps * std::max(RealScalar(1), std::abs(a))) {
+        converged_ = true;
+        break;
+      }
+
+      v_prev.swap(v);
+      v = w / b;
+      if (!low_memory_) { basis.push_back(v); }
+    }
+
+    // eigenvector
+    if (!low_memory_) {
+      eigenvector_ = VectorType::Zero(n);
+      for (size_t k = 0; k < n_iteration_; ++k) {
+        eigenvector_ += ritz_vector(static_cast<Eigen::Index>(k)) * basis[k];
+      }
+    } else {
+      // second pass, with the same coefficients.
+      v = start_vector(n);
+      v_prev = VectorType::Zero(n);
+      eigenvector_ = ritz_vector(0) * v;
+      for (size_t j = 0; j + 1 < n_iteration_; ++j) {
+        op.apply(v.data(), w.data());
+        ++n_apply_;
+        w -= alpha_[j] * v;
+        if (j > 0) { w -= beta_[j - 1] * v_prev; }
+        v_prev.swap(v);
+        v = w / beta_[j];
+        eigenvector_ += ritz_vector(static_cast<Eigen::Index>(j + 1)) * v;
+      }
+    }
+    eigenvector_.normalize();
+
+    // true residual norm of the eigenpair
+    op.apply(eigenvector_.data(), w.data());
+    ++n_apply_;
+    residual_ = (w - eigenvalue_ * eigenvector_).norm();
+    return *this;
+  }
+
+  //! Lowest eigenvalue.
+  RealScalar eigenvalue() const { return eigenvalue_; }
+
+  //! Normalized eigenvector of the lowest eigenvalue.
+  const VectorType & eigenvector() const { return eigenvector_; }
+
+  //! Residual estimate of the lowest Ritz pair in every iteration.
+  const std::vector<RealScalar> & residuals() const { return residuals_; }
+
+  //! |H x - E x| of the returned eigenpair.
+  RealScalar residual() const { return residual_; }
+
+  //! Diagonal and off-diagonal elements of the tridiagonal matrix.
+  const std::vector<RealScalar> & alpha() const { return alpha_; }
+  const std::vector<RealScalar> & beta() const { return beta_; }
+
+  size_t n_iteration() const { return n_iteration_; }
+
+  //! Number of operator applications.
+  size_t n_apply() const { return n_apply_; }
+
+  bool converged() const { return converged_; }
+
+ private:
+  VectorType start_vector(size_t n) const {
+    std::mt19937 rng(seed_);
+    std::uniform_real_distribution<RealScalar> dist(-1, 1);
+    VectorType v(n);
+    for (size_t i = 0; i < n; ++i) { v(static_cast<Eigen::Index>(i)) = Scalar(dist(rng)); }
+    return v.normalized();
+  }
+
+  //! w -= sum_k <v_k, w> v_k
+  static void orthogonalize(const std::vector<VectorType>& basis, VectorType& w) {
+    for (auto const & u : basis) {
+      w -= u.dot(w) * u;
+    }
+  }
+
+  //! Lowest eigenpair of the leading m x m block of the tridiagonal matrix.
+  void tridiagonal_ground_state(size_t m, RealScalar& value, RealVectorType& vec) const {
+    Eigen::Index mi = static_cast<Eigen::Index>(m);
+    RealVectorType diag(mi), sub(std::max<Eigen::Index>(mi - 1, 0));
+    for (Eigen::Index k = 0; k < mi; ++k) { diag(k) = alpha_[static_cast<size_t>(k)]; }
+    for (Eigen::Index k = 0; k + 1 < mi; ++k) { sub(k) = beta_[static_cast<size_t>(k)]; }
+    Eigen::SelfAdjointEigenSolver<Eigen::Matrix<RealScalar, Eigen::Dynamic, Eigen::Dynamic>> solver;
+    solver.computeFromTridiagonal(diag, sub, Eigen::ComputeEigenvectors);
+    value = solver.eigenvalues()(0);
+    vec = solver.eigenvectors().col(0);
+  }
+
+  size_t max_iteration_;
+  RealScalar tolerance_;
+  Reorthogonalization reorthogonalization_;
+  bool low_memory_;
+  unsigned seed_;
+
+  std::vector<RealScalar> alpha_, beta_, residuals_;
+  RealScalar eigenvalue_;
+  VectorType eigenvector_;
+  RealScalar residual_;
+  size_t n_iteration_;
+  size_t n_apply_;
+  bool converged_;
+};
@@ -0,0 +1,223 @@
+#pragma once
+#include "../global.h"
+
+#include <random>
+#include <Eigen/Dense>
+
+#include "block_tools.h"
+
+//! @class Lobpcg
+//!
+//! @brief Locally optimal block preconditioned conjugate gradient solver (LOBPCG) for the
+//! lowest eigenpairs of a Hermitian operator.
+//!
+//! A block of block_size() vectors is iterated at once, so degenerate eigenvalues are
+//! resolved without deflation. The operator is any object with
+//!
+//!     size_t size() const;
+//!     void apply(const Scalar* x, Scalar* y, size_t n_vector) const;     // Y = H X
+//!
+//! where X and Y are row-major blocks of size() x n_vector (as SparseHamiltonian and
+//! MatrixFreeHamiltonian), so the traversal of the Hamiltonian is shared by the vectors.
+//!
+//! Every iteration applies the operator to the residuals of the unconverged vectors only
+//! (soft locking), and the Rayleigh-Ritz step is done in the span of the current vectors X,
+//! the residuals W and the previous search directions P. The products H P and H X are
+//! updated from the small Ritz coefficients, and the new P is orthonormalized in the
+//! coefficient space (Hetmaniuk and Lehoucq), so there is one block product per iteration.
+//! Blocks are orthonormalized by SVQB (see detail::orthonormalize), which drops linearly
+//! dependent vectors.
+//!
+//! Sectors with size() < 3 * block_size() are diagonalized densely.
+//!
+//! @tparam _Scalar Scalar type of the vectors (real or complex).
+template <typename _Scalar>
+class Lobpcg
+{
+ public:
+  using Scalar = _Scalar;
+  using RealScalar = typename Eigen::NumTraits<Scalar>::Real;
+  using MatrixType = Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic>;
+  using RealVectorType = Eigen::Matrix<RealScalar, Eigen::Dynamic, 1>;
+  //! Layout of the blocks passed to the operator.
+  using BlockType = Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>;
+
+  Lobpcg()
+      : n_eigenvalue_(1), block_size_(0), max_iteration_(1000), tolerance_(1E-8), seed_(1),
+        n_iteration_(0), n_apply_(0), converged_(false)
+  {
+  }
+
+  //! Number of eigenpairs to compute.
+  Lobpcg& set_n_eigenvalue(size_t n) { n_eigenvalue_ = n; return *this; }
+  //! Number of vectors iterated (at least n_eigenvalue; 0 for n_eigenvalue + 2).
+  //! The additional vectors speed up the convergence of the highest wanted eigenpair.
+  Lobpcg& set_block_size(size_t n) { block_size_ = n; return *this; }
+  Lobpcg& set_max_iteration(size_t n) { max_iteration_ = n; return *this; }
+  //! An eigenpair is converged when |H x - E x| < tolerance * max(1, |E|).
+  Lobpcg& set_tolerance(RealScalar tol) { tolerance_ = tol; return *this; }
+  //! Seed of the random initial block.
+  Lobpcg& set_seed(unsigned seed) { seed_ = seed; return *this; }
+
+  size_t n_eigenvalue() const { return n_eigenvalue_; }
+  size_t block_size() const { return std::max(block_size_ == 0 ? n_eigenvalue_ + 2 : block_size_, n_eigenvalue_); }
+
+  //! @brief Compute the lowest n_eigenvalue() eigenpairs.
+  //! @throw std::domain_error if the operator has fewer than n_eigenvalue() states.
+  template <typename OperatorType>
+  Lobpcg& compute(const OperatorType& op)
+  {
+    size_t n = op.size();
+    if (n_eigenvalue_ == 0 || n < n_eigenvalue_) {
+      throw std::domain_error("Lobpcg::compute(): dimension smaller than the number of eigenvalues");
+    }
+    n_iteration_ = 0;
+    n_apply_ = 0;
+    converged_ = false;
+
+    size_t k = std::min(block_size(), n);
+    if (n < 3 * k) {
+      compute_dense(op);
+      return *this;
+    }
+
+    const Eigen::Index ne = static_cast<Eigen::Index>(n_eigenvalue_);
+    BlockType x = detail::orthonormalize(start_block(n, k));
+    BlockType hx = apply(op, x);
+    BlockType p(n, 0), hp(n, 0);
+    RealVectorType values;
+    rayleigh_ritz(x, hx, values);
+
+    RealVectorType res(x.cols());
+    for (n_iteration_ = 0; n_iteration_ < max_iteration_; ++n_iteration_) {
+      BlockType r = hx - x * values.asDiagonal();
+      std::vector<Eigen::Index> active;
+      for (Eigen::Index i = 0; i < x.cols(); ++i) {
+        res(i) = r.col(i).norm();
+        if (res(i) >= threshold(values(i))) { active.push_back(i); }
+      }
+      if (active.empty() || active.front() >= ne) {
+        converged_ = true;
+        break;
+      }
+
+      // search directions: residuals of the active vectors, orthogonal to X and P.
+      BlockType w(n, static_cast<Eigen::Index>(active.size()));
+      for (size_t i = 0; i < active.size(); ++i) { w.col(static_cast<Eigen::Index>(i)) = r.col(active[i]); }
+      for (int pass = 0; pass < 2; ++pass) {
+        w -= x * (x.adjoint() * w);
+        if (p.cols() > 0) { w -= p * (p.adjoint() * w); }
+        w = detail::orthonormalize(w);
+      }
+      if (w.cols() == 0) { break; }
+      BlockType hw = apply(op, w);
+
+      // Rayleigh-Ritz in [X, W, P]
+      Eigen::Index m = x.cols() + w.cols() + p.cols();
+      BlockType s(n, m), hs(n, m);
+      s << x, w, p;
+      hs << hx, hw, hp;
+      MatrixType gram = s.adjoint() * hs;
+      gram = (gram + gram.adjoint()) / RealScalar(2);
+      Eigen::SelfAdjointEigenSolver<MatrixType> solver(gram);
+      MatrixType c = solver.eigenvectors().leftCols(x.cols());
+      values = solver.eigenvalues().head(x.cols());
+
+      // new directions: the W and P parts of the Ritz vectors, orthonormalized against them.
+      MatrixType cp = c;
+      cp.topRows(x.cols()).setZero();
+      for (int pass = 0; pass < 2; ++pass) {
+        cp -= c * (c.adjoint() * cp);
+        cp = detail::orthonormalize(cp);
+      }
+      x = s * c;
+      hx = hs * c;
+      p = s * cp;
+      hp = hs * cp;
+    }
+
+    // products from the linear updates drift slowly, so the residuals are recomputed.
+    hx = apply(op, x);
+    residuals_.resize(ne);
+    for (Eigen::Index i = 0; i < ne; ++i) {
+      residuals_(i) = (hx.col(i) - values(i) * x.col(i)).norm();
+    }
+    eigenvalues_ = values.head(ne);
+    eigenvectors_ = x.leftCols(ne);
+    return *this;
+  }
+
+  //! Lowest eigenvalues in ascending order.
+  const RealVectorType & eigenvalues() const { return eigenvalues_; }
+
+  //! Orthonormal eigenvectors (columns).
+  const MatrixType & eigenvectors() const { return eigenvectors_; }
+
+  //! |H x - E x| of every eigenpair.
+  const RealVectorType & residuals() const { return residuals_; }
+
+  size_t n_iteration() const { return n_iteration_; }
+
+  //! Number of vectors the operator was applied to.
+  size_t n_apply() const { return n_apply_; }
+
+  bool converged() const { return converged_; }
+
+ private:
+  RealScalar threshold(RealScalar value) const {
+    return tolerance_ * std::max(RealScalar(1), std::abs(value));
+  }
+
+  template <typename OperatorType>
+  BlockType apply(const OperatorType& op, const BlockType& x) {
+    BlockType y(x.rows(), x.cols());
+    op.apply(x.data(), y.data(), static_cast<size_t>(x.cols()));
+    n_apply_ += static_cast<size_t>(x.cols());
+    return y;
+  }
+
+  BlockType start_block(size_t n, size_t k) const {
+    std::mt19937 rng(seed_);
+    std::uniform_real_distribution<RealScalar> dist(-1, 1);
+    BlockType x(n, k);
+    for (Eigen::Index i = 0; i < x.rows(); ++i) {
+      for (Eigen::Index j = 0; j < x.cols(); ++j) { x(i, j) = Scalar(dist(rng)); }
+    }
+    return x;
+  }
+
+  //! Rayleigh-Ritz in the span of X only.
+  void rayleigh_ritz(BlockType& x, BlockType& hx, RealVectorType& values) const {
+    MatrixType gram = x.adjoint() * hx;
+    gram = (gram + gram.adjoint()) / RealScalar(2);
+    Eigen::SelfAdjointEigenSolver<MatrixType> solver(gram);
+    x = x * solver.eigenvectors();
+    hx = hx * solver.eigenvectors();
+    values = solver.eigenvalues();
+  }
+
+  //! Diagonalize the full matrix, obtained by applying the operator to the identity.
+  template <typename OperatorType>
+  void compute_dense(const OperatorType& op) {
+    Eigen::SelfAdjointEigenSolver<MatrixType> solver(detail::dense_matrix<Scalar>(op));
+    n_apply_ += op.size();
+    Eigen::Index ne = static_cast<Eigen::Index>(n_eigenvalue_);
+    eigenvalues_ = solver.eigenvalues().head(ne);
+    eigenvectors_ = solver.eigenvectors().leftCols(ne);
+    residuals_ = RealVectorType::Zero(ne);
+    converged_ = true;
+  }
+
+  size_t n_eigenvalue_;
+  size_t block_size_;
+  size_t max_iteration_;
+  RealScalar tolerance_;
+  unsigned seed_;
+
+  RealVectorType eigenvalues_;
+  MatrixType eigenvectors_;
+  RealVectorType residuals_;
+  size_t n_iteration_;
+  size_t n_apply_;
+  bool converged_;
+};
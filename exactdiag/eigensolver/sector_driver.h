@@ -0,0 +1,342 @@
+#pragma once
+#include "../global.h"
+
+#include <ostream>
+#include <Eigen/Dense>
+
+#include "../hilbertspace.h"
+#include "../hamiltonian.h"
+#include "../utility/thread_pool.h"
+#include "lanczos.h"
+#include "lobpcg.h"
+
+//! Method used for the spectrum of a sector.
+enum class SectorMethod
+{
+  Dense,    //!< full diagonalization
+  Lanczos,  //!< ground state only
+  Lobpcg    //!< several lowest states
+};
+
+inline std::ostream& operator<<(std::ostream& os, SectorMethod method)
+{
+  switch (method) {
+    case SectorMethod::Dense: return os << "dense";
+    case SectorMethod::Lanczos: return os << "lanczos";
+    case SectorMethod::Lobpcg: return os << "lobpcg";
+  }
+  return os;
+}
+
+//! How the Hamiltonian of a sector is stored and applied.
+enum class SectorStorage
+{
+  Sparse,       //!< SparseHamiltonian
+  MatrixFree,   //!< MatrixFreeHamiltonian (basis and diagonal only)
+  Kronecker     //!< KroneckerHamiltonian (species factors and diagonal, no basis of the sector)
+};
+
+inline std::ostream& operator<<(std::ostream& os, SectorStorage storage)
+{
+  switch (storage) {
+    case SectorStorage::Sparse: return os << "sparse";
+    case SectorStorage::MatrixFree: return os << "matrix-free";
+    case SectorStorage::Kronecker: return os << "kronecker";
+  }
+  return os;
+}
+
+
+//! @class SectorDriver
+//!
+//! @brief Lowest eigenvalues of a Hermitian operator in many sectors, on a thread pool.
+//!
+//! Every sector is an independent task: its basis is generated, its Hamiltonian is built,
+//! and it is diagonalized. The cost of every sector is estimated from its dimension
+//! (System::sector_dimension, without generating the basis), and the tasks are submitted to
+//! a ThreadPool largest first, so that the long tasks do not end up last. A task builds and
+//! applies its Hamiltonian on a share of the threads proportional to its share of the total
+//! cost (at least one), so a sector which dominates the run is not left on a single thread.
+//! Sectors up to dense_limit() states are diagonalized densely (cost ~ d^3), the larger ones
+//! with Lanczos (one eigenvalue) or Lobpcg (several), whose cost is taken as
+//! ~ d dense_limit()^2 so that the two estimates agree at the crossover.
+//!
+//! Sectors up to sparse_limit() states (whose number of elements surely fits in the int
+//! indices of the SparseHamiltonian) are stored as a SparseHamiltonian. The larger ones are
+//! applied without storing the matrix: with a KroneckerHamiltonian if the operator separates
+//! into two species (see KroneckerHamiltonian::separate_species), which does not even
+//! generate the basis of the sector, and with a MatrixFreeHamiltonian otherwise. Lanczos
+//! then runs in its low-memory mode, with three vectors.
+//!
+//! With set_split_fragments(), a sector which falls apart into disconnected fragments (Hilbert-space
+//! fragmentation) is diagonalized fragment by fragment, which is much cheaper than the whole sector.
+//!
+//! The table returned by run() is sorted by the quantum numbers, independent of the
+//! number of threads and of the order in which the tasks finished.
+//!
+//! @tparam _Scalar Scalar(Field) type of the coefficient.
+//! @tparam _RepSize Number of bits of the Rep
+//! @tparam _SiteSize Number of bits of the Site (for fermion parity counting).
+//! @tparam QNS List of quantum number types.
+template <typename _Scalar, size_t _RepSize, size_t _SiteSize, typename ... QNS>
+class SectorDriver
+{
+ public:
+  static const size_t RepSize = _RepSize;
+  static const size_t SiteSize = _SiteSize;
+  using Scalar = _Scalar;
+  using RealScalar = typename Eigen::NumTraits<Scalar>::Real;
+  using SystemType = System<QNS...>;
+  using QuantumNumberTuple = typename SystemType::QuantumNumberTuple;
+  using MixedOperatorType = MixedOperator<Scalar, RepSize, SiteSize>;
+  using SectorGeneratorType = SectorGenerator<RepSize, SiteSize, QNS...>;
+
+  using KroneckerHamiltonianType = KroneckerHamiltonian<Scalar, RepSize, SiteSize, QNS...>;
+
+  static const size_t DefaultDenseLimit = 400;
+  static const size_t DefaultSparseLimit = size_t(1) << 21;
+
+  //! Row of the spectrum table.
+  struct SectorSpectrum
+  {
+    QuantumNumberTuple quantum_number;
+    size_t dimension;
+    SectorMethod method;
+    SectorStorage storage;
+    std::vector<RealScalar> eigenvalues;   //!< lowest ones, ascending
+    bool converged;
+
+    //! One line: quantum numbers, dimension, method, storage, and the eigenvalues.
+    friend std::ostream& operator<<(std::ostream& os, const SectorSpectrum& s) {
+      os << s.quantum_number << "\t" << s.dimension << "\t" << s.method << "\t" << s.storage;
+      for (auto const & e : s.eigenvalues) { os << "\t" << e; }
+      if (!s.converged) { os << "\t(not converged)"; }
+      return os;
+    }
+  };
+
+  //! Constructor
+  //! @param system %System, which must outlive the driver.
+  //! @param op Hermitian operator which conserves the quantum numbers.
+  SectorDriver(const SystemType& system, const MixedOperatorType& op)
+      : system_(system), op_(op), builder_(op), fragmentation_(op),
+        separable_(KroneckerHamiltonianType::separate_species(system, op).any()),
+        max_sparse_dimension_(static_cast<size_t>(std::numeric_limits<int>::max())
+                              / (1 + op.off_diagonal().n_term())),
+        n_thread_(0), n_eigenvalue_(1), dense_limit_(DefaultDenseLimit), sparse_limit_(DefaultSparseLimit),
+        tolerance_(1E-9), split_fragments_(false)
+  {
+  }
+
+  //! Number of sectors diagonalized at the same time (0 for default_n_thread()).
+  SectorDriver& set_n_thread(size_t n) { n_thread_ = n; return *this; }
+  //! Number of lowest eigenvalues per sector.
+  SectorDriver& set_n_eigenvalue(size_t n) { n_eigenvalue_ = n; return *this; }
+  //! Largest dimension which is diagonalized densely.
+  SectorDriver& set_dense_limit(size_t n) { dense_limit_ = n; return *this; }
+  //! Largest dimension whose matrix is stored (see storage()).
+  SectorDriver& set_sparse_limit(size_t n) { sparse_limit_ = n; return *this; }
+  //! Tolerance of the iterative solvers (relative residual).
+  SectorDriver& set_tolerance(RealScalar tol) { tolerance_ = tol; return *this; }
+
+  //! @brief Whether every sector is split into its connected components (see SectorFragmentation),
+  //! which are diagonalized one by one with the method for their own dimension. The method in
+  //! the table is then that of the largest fragment.
+  SectorDriver& set_split_fragments(bool split) { split_fragments_ = split; return *this; }
+
+  //! Method used for a sector of the given dimension.
+  SectorMethod method(size_t dimension) const {
+    if (dimension <= dense_limit_) { return SectorMethod::Dense; }
+    return (n_eigenvalue_ <= 1) ? SectorMethod::Lanczos : SectorMethod::Lobpcg;
+  }
+
+  //! @brief Storage of the Hamiltonian of a sector of the given dimension.
+  //!
+  //! Sparse for the dense sectors, and up to sparse_limit() states (and as long as one element
+  //! per off-diagonal term and state fits in the int indices). Above, Kronecker if the operator
+  //! is separable and the sectors are not split into fragments, and MatrixFree otherwise.
+  SectorStorage storage(size_t dimension) const { return storage(dimension, !split_fragments_); }
+
+  //! Estimated cost of a sector of the given dimension (in arbitrary units).
+  double estimate_cost(size_t dimension) const {
+    double d = static_cast<double>(dimension);
+    double limit = static_cast<double>(std::max<size_t>(dense_limit_, 1));
+    return (method(dimension) == SectorMethod::Dense) ? d * d * d : d * limit * limit;
+  }
+
+  //! Quantum numbers of all the nonempty sectors.
+  std::vector<QuantumNumberTuple> all_sectors() const {
+    std::vector<QuantumNumberTuple> ret;
+    for (auto const & dim : system_.sector_dimensions()) { ret.push_back(dim.first); }
+    return ret;
+  }
+
+  //! @brief Spectra of the given sectors.
+  //! @param sectors Quantum numbers of the sectors (duplicates are ignored).
+  //! @return One row per distinct sector, sorted by quantum numbers. Empty sectors have no eigenvalues.
+  //! @throw The first exception thrown by a sector (e.g. std::domain_error if the operator
+  //! does not conserve it).
+  std::vector<SectorSpectrum> run(const std::vector<QuantumNumberTuple>& sectors) const
+  {
+    std::vector<QuantumNumberTuple> qns(sectors);
+    std::sort(qns.begin(), qns.end());
+    qns.erase(std::unique(qns.begin(), qns.end()), qns.end());
+
+    std::vector<SectorSpectrum> table(qns.size());
+    std::vector<double> cost(qns.size());
+    for (size_t i = 0; i < qns.size(); ++i) {
+      table[i].quantum_number = qns[i];
+      table[i].dimension = dimension(qns[i], aux::gen_seq<sizeof...(QNS)>());
+      table[i].method = method(table[i].dimension);
+      table[i].storage = storage(table[i].dimension);
+      table[i].converged = true;
+      cost[i] = (table[i].dimension == 0) ? 0.0 : estimate_cost(table[i].dimension);
+    }
+    double total_cost = 0;
+    for (double c : cost) { total_cost += c; }
+
+    std::vector<size_t> order(qns.size());
+    for (size_t i = 0; i < order.size(); ++i) { order[i] = i; }
+    std::stable_sort(order.begin(), order.end(), [&](size_t i, size_t j) { return cost[i] > cost[j]; });
+
+    ThreadPool pool(n_thread_);
+    for (size_t i : order) {
+      if (table[i].dimension == 0) { continue; }
+      // threads for the build and apply of this sector, by its share of the cost.
+      double share = cost[i] / total_cost * static_cast<double>(pool.n_thread());
+      size_t n_inner = std::min(pool.n_thread(), std::max<size_t>(1, static_cast<size_t>(share + 0.5)));
+      pool.submit([this, &table, i, n_inner]() { solve(table[i], n_inner); });
+    }
+    pool.wait();
+    return table;
+  }
+
+  //! Spectra of all the nonempty sectors.
+  std::vector<SectorSpectrum> run() const { return run(all_sectors()); }
+
+ private:
+  template <size_t ... Is>
+  size_t dimension(const QuantumNumberTuple& qn, aux::seq<Is...>) const {
+    return system_.sector_dimension(std::get<Is>(qn)...);
+  }
+
+  template <size_t ... Is>
+  typename SectorGeneratorType::Sector generate(const QuantumNumberTuple& qn, size_t n_thread,
+                                                aux::seq<Is...>) const {
+    return SectorGeneratorType(system_).generate_parallel(n_thread, std::get<Is>(qn)...);
+  }
+
+  SectorStorage storage(size_t dimension, bool whole_sector) const {
+    if (method(dimension) == SectorMethod::Dense
+        || (dimension <= sparse_limit_ && dimension <= max_sparse_dimension_)) {
+      return SectorStorage::Sparse;
+    }
+    return (whole_sector && separable_) ? SectorStorage::Kronecker : SectorStorage::MatrixFree;
+  }
+
+  //! Diagonalize one sector, building and applying its Hamiltonian on n_thread threads.
+  void solve(SectorSpectrum& entry, size_t n_thread) const {
+    size_t ne = std::min(n_eigenvalue_, entry.dimension);
+    entry.eigenvalues.clear();
+    if (entry.storage == SectorStorage::Kronecker) {
+      KroneckerHamiltonianType hamiltonian(system_, op_, entry.quantum_number, n_thread);
+      diagonalize(hamiltonian, entry.method, ne, entry);
+      return;
+    }
+    auto sector = generate(entry.quantum_number, n_thread, aux::gen_seq<sizeof...(QNS)>());
+    if (!split_fragments_) {
+      solve(sector, entry.method, ne, n_thread, entry);
+      return;
+    }
+    // the lowest ne eigenvalues of all the fragments.
+    size_t largest = 0;
+    for (auto const & fragment : fragmentation_.split(sector, n_thread)) {
+      solve(fragment, method(fragment.size()), std::min(ne, fragment.size()), n_thread, entry);
+      largest = std::max(largest, fragment.size());
+    }
+    entry.method = method(largest);
+    entry.storage = storage(largest, false);
+    std::sort(entry.eigenvalues.begin(), entry.eigenvalues.end());
+    entry.eigenvalues.resize(ne);
+  }
+
+  //! Append the lowest ne eigenvalues in the given sector (or fragment) to the entry.
+  template <typename SectorType>
+  void solve(const SectorType& sector, SectorMethod sector_method, size_t ne, size_t n_thread,
+             SectorSpectrum& entry) const {
+    if (storage(sector.size(), false) == SectorStorage::Sparse) {
+      diagonalize(builder_.build(sector, n_thread), sector_method, ne, entry);
+    } else {
+      diagonalize(make_matrix_free_hamiltonian(op_, sector, n_thread), sector_method, ne, entry);
+    }
+  }
+
+  //! Append the lowest ne eigenvalues of the Hamiltonian to the entry.
+  template <typename HamiltonianType>
+  void diagonalize(const HamiltonianType& hamiltonian, SectorMethod sector_method, size_t ne,
+                   SectorSpectrum& entry) const {
+    switch (sector_method) {
+      case SectorMethod::Dense: {
+        Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic> dense = dense_matrix(hamiltonian);
+        Eigen::SelfAdjointEigenSolver<decltype(dense)> solver(dense, Eigen::EigenvaluesOnly);
+        for (size_t i = 0; i < ne; ++i) { entry.eigenvalues.push_back(solver.eigenvalues()(static_cast<Eigen::Index>(i))); }
+        break;
+      }
+      case SectorMethod::Lanczos: {
+        Lanczos<Scalar> lanczos;
+        lanczos.set_tolerance(tolerance_).set_reorthogonalization(Reorthogonalization::Partial);
+        lanczos.set_low_memory(hamiltonian.size() > sparse_limit_);
+        lanczos.compute(hamiltonian);
+        entry.eigenvalues.push_back(lanczos.eigenvalue());
+        entry.converged = entry.converged && lanczos.converged();
+        break;
+      }
+      case SectorMethod::Lobpcg: {
+        Lobpcg<Scalar> lobpcg;
+        lobpcg.set_n_eigenvalue(ne).set_tolerance(tolerance_);
+        lobpcg.compute(hamiltonian);
+        for (size_t i = 0; i < ne; ++i) { entry.eigenvalues.push_back(lobpcg.eigenvalues()(static_cast<Eigen::Index>(i))); }
+        entry.converged = entry.converged && lobpcg.converged();
+        break;
+      }
+    }
+  }
+
+  //! Dense matrix of a Hamiltonian which is only applied, column by column.
+  template <typename HamiltonianType>
+  static Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic> dense_matrix(const HamiltonianType& hamiltonian) {
+    Eigen::Index n = static_cast<Eigen::Index>(hamiltonian.size());
+    Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic> ret(n, n);
+    Eigen::Matrix<Scalar, Eigen::Dynamic, 1> x = Eigen::Matrix<Scalar, Eigen::Dynamic, 1>::Zero(n);
+    for (Eigen::Index j = 0; j < n; ++j) {
+      x(j) = Scalar(1);
+      hamiltonian.apply(x.data(), ret.col(j).data());
+      x(j) = Scalar(0);
+    }
+    return ret;
+  }
+
+  static Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic>
+  dense_matrix(const typename HamiltonianBuilder<Scalar, RepSize, SiteSize>::SparseHamiltonianType& hamiltonian) {
+    return hamiltonian.matrix();
+  }
+
+  const SystemType& system_;
+  MixedOperatorType op_;
+  HamiltonianBuilder<Scalar, RepSize, SiteSize> builder_;
+  SectorFragmentation<Scalar, RepSize, SiteSize> fragmentation_;
+  bool separable_;                 //!< whether the operator separates into two species
+  size_t max_sparse_dimension_;    //!< dimension up to which the elements surely fit in int
+  size_t n_thread_;
+  size_t n_eigenvalue_;
+  size_t dense_limit_;
+  size_t sparse_limit_;
+  RealScalar tolerance_;
+  bool split_fragments_;
+};
+
+template <typename _Scalar, size_t _RepSize, size_t _SiteSize, typename ... QNS>
+const size_t SectorDriver<_Scalar, _RepSize, _SiteSize, QNS...>::DefaultDenseLimit;
+
+template <typename _Scalar, size_t _RepSize, size_t _SiteSize, typename ... QNS>
+const size_t SectorDriver<_Scalar, _RepSize, _SiteSize, QNS...>::DefaultSparseLimit;
@@ -1,10 +1,13 @@
 #pragma once
 
+#include <algorithm>
 #include <cmath>
+#include <cstdint>
 #include <cassert>
 #include <iostream>
 #include <sstream>
 #include <vector>
+#include <map>
 #include <unordered_map>
 #include <string>
 #include <memory>
@@ -0,0 +1,12 @@
+#pragma once
+#include "global.h"
+
+#include "hilbertspace.h"
+#include "operator.h"
+
+#include "hamiltonian/diagonal.h"
+#include "hamiltonian/sparse_builder.h"
+#include "hamiltonian/matrix_free.h"
+#include "hamiltonian/kronecker.h"
+#include "hamiltonian/symmetric_builder.h"
+#include "hamiltonian/fragmentation.h"
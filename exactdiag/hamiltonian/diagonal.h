@@ -0,0 +1,76 @@
+#pragma once
+#include "../global.h"
+
+#include "../operator.h"
+#include "../utility/parallel.h"
+
+//! @class SectorDiagonal
+//!
+//! @brief Diagonal matrix elements of an operator in a sector.
+//!
+//! Only the diagonal terms of the operator (see PureOperator::is_diagonal) contribute,
+//! since an off-diagonal term never maps a state to itself. The energies are evaluated
+//! once, so that the diagonal part can be applied as an elementwise multiplication,
+//! without any lookup of the resulting states.
+//!
+//! @tparam _Scalar Scalar type of the matrix elements.
+template <typename _Scalar>
+class SectorDiagonal
+{
+ public:
+  using Scalar = _Scalar;
+
+  SectorDiagonal() { }
+
+  //! Constructor from the diagonal elements.
+  explicit SectorDiagonal(std::vector<Scalar> values) : values_(std::move(values)) { }
+
+  //! Constructor
+  //! @param op Operator (its off-diagonal terms are ignored).
+  //! @param sector Sector, which provides size() and state(idx).
+  //! @param n_thread Number of threads (0 for default_n_thread()).
+  template <size_t RepSize, size_t SiteSize, typename SectorType>
+  SectorDiagonal(const MixedOperator<Scalar, RepSize, SiteSize>& op,
+                 const SectorType& sector,
+                 size_t n_thread = 0)
+      : values_(sector.size(), Scalar(0))
+  {
+    auto diag = op.diagonal();
+    if (diag.n_term() == 0) { return; }
+    static const size_t BlockSize = 4096;
+    size_t n_block = (sector.size() + BlockSize - 1) / BlockSize;
+    parallel_for(0, n_block, n_thread, [&](size_t i_block) {
+      size_t end = std::min(sector.size(), (i_block + 1) * BlockSize);
+      for (size_t idx = i_block * BlockSize; idx < end; ++idx) {
+        auto bvec_fvec = sector.state(idx);
+        Scalar & value = values_[idx];
+        diag.apply(std::get<0>(bvec_fvec), std::get<1>(bvec_fvec),
+                   [&value](const std::bitset<RepSize>&, const std::bitset<SiteSize>&, const Scalar& v) {
+                     value += v;
+                   });
+      }
+    });
+  }
+
+  //! Dimension of the sector.
+  size_t size() const { return values_.size(); }
+
+  //! Diagonal matrix element of the basis state of the given index.
+  const Scalar & operator[](size_t idx) const { return values_[idx]; }
+
+  const std::vector<Scalar> & values() const { return values_; }
+
+  //! y[i] += d[i] * x[i] for i in [begin, end).
+  void apply(const Scalar* x, Scalar* y, size_t begin, size_t end) const {
+    assert(end <= values_.size());
+    for (size_t i = begin; i < end; ++i) {
+      y[i] += values_[i] * x[i];
+    }
+  }
+
+  //! y += d * x, elementwise.
+  void apply(const Scalar* x, Scalar* y) const { apply(x, y, 0, values_.size()); }
+
+ private:
+  std::vector<Scalar> values_;
+};
@@ -0,0 +1,179 @@
+#pragma once
+#include "../global.h"
+
+#include "../hilbertspace.h"
+#include "../operator.h"
+#include "../utility/parallel.h"
+#include "../utility/union_find.h"
+
+//! @class SectorFragmentation
+//!
+//! @brief Connected components of the basis of a sector under an operator (Hilbert-space
+//! fragmentation, e.g. in constrained or dipole-conserving models).
+//!
+//! Two basis states are connected if the operator has a nonzero matrix element between
+//! them. The states of a component are never mixed by the operator (nor by any power of
+//! it), so the operator is block diagonal in the components, which can be diagonalized
+//! separately. For a Hermitian operator the components are the Krylov subspaces of the
+//! basis states.
+//!
+//! The off-diagonal terms are applied to every basis state, as in HamiltonianBuilder (the
+//! elements reaching the same state are summed, and those which cancel do not connect), and
+//! the connected states are merged in a ConcurrentUnionFind. The basis states are split into
+//! blocks on threads, which merge into the same union-find without locks.
+//!
+//! @tparam _Scalar Scalar(Field) type of the coefficient.
+//! @tparam _RepSize Number of bits of the Rep
+//! @tparam _SiteSize Number of bits of the Site (for fermion parity counting).
+template <typename _Scalar, size_t _RepSize, size_t _SiteSize>
+class SectorFragmentation
+{
+ public:
+  static const size_t RepSize = _RepSize;
+  static const size_t SiteSize = _SiteSize;
+  using Scalar = _Scalar;
+  using MixedOperatorType = MixedOperator<Scalar, RepSize, SiteSize>;
+  using CompactOperatorType = CompactOperator<Scalar, RepSize, SiteSize>;
+  using CodecType = CompactCodec<RepSize, SiteSize>;
+  using Rep = CompactRep<RepSize>;
+  using Word = typename Rep::type;
+  using BitRep = std::bitset<RepSize>;
+  using BitSite = std::bitset<SiteSize>;
+  using BasisType = std::vector<Word>;
+
+  //! Number of basis states handed to a thread at a time.
+  static const size_t BlockSize = 1024;
+
+  //! Tolerance below which a summed matrix element does not connect two states.
+  static constexpr double Epsilon = 1E-14;
+
+  //! @brief Sub-sector of one component, with the interface of Sector, so it can be passed to
+  //! HamiltonianBuilder, MatrixFreeHamiltonian, etc.
+  //!
+  //! The basis states are in ascending order of representation, and parent_index maps every
+  //! one of them to its index in the original sector (use restrict and extend for vectors).
+  struct Fragment
+  {
+    static const size_t npos = static_cast<size_t>(-1);
+
+    BasisType basis;                     //!< representations, ascending
+    std::vector<size_t> parent_index;    //!< index of every basis state in the original sector
+    CodecType codec;
+
+    //! Dimension of the fragment.
+    size_t size() const { return basis.size(); }
+
+    //! Compact representation of the basis state of the given index.
+    Word word(size_t idx) const { return basis[idx]; }
+
+    //! Basis state of the given index, as used by PureOperator and MixedOperator.
+    std::tuple<BitRep, BitSite> state(size_t idx) const { return codec.decode(basis[idx]); }
+
+    //! Index of the basis state with the given representation.
+    //! @return npos if the representation does not belong to the fragment.
+    size_t find(const BitRep& rep) const { return find_word(codec.encode(rep)); }
+
+    //! Index of the basis state with the given compact representation.
+    //! @return npos if the representation does not belong to the fragment.
+    size_t find_word(const Word& w) const {
+      auto found = std::lower_bound(basis.begin(), basis.end(), w, &Rep::less);
+      return (found != basis.end() && *found == w) ? static_cast<size_t>(found - basis.begin()) : npos;
+    }
+
+    //! Components of a vector of the original sector on the fragment.
+    template <typename T>
+    void restrict(const T* x_parent, T* x) const {
+      for (size_t i = 0; i < parent_index.size(); ++i) { x[i] = x_parent[parent_index[i]]; }
+    }
+
+    //! Write a vector of the fragment into the components of a vector of the original sector
+    //! (the other components are left unchanged).
+    template <typename T>
+    void extend(const T* x, T* x_parent) const {
+      for (size_t i = 0; i < parent_index.size(); ++i) { x_parent[parent_index[i]] = x[i]; }
+    }
+  };
+
+  //! Constructor
+  //! @param op Operator, which must conserve the quantum numbers of the sectors.
+  SectorFragmentation(const MixedOperatorType& op)
+      : off_diagonal_(op.off_diagonal())
+  {
+  }
+
+  //! @brief Component of every basis state of the sector.
+  //! @param sector Sector generated by BasicSectorGenerator (or a Fragment).
+  //! @param n_thread Number of threads (0 for default_n_thread()).
+  //! @return Label 0, 1, ... of the component of every basis state, numbered in the order of
+  //! their first basis state.
+  //! @throw std::domain_error if the operator maps a state out of the sector.
+  template <typename SectorType>
+  std::vector<size_t> labels(const SectorType& sector, size_t n_thread = 0) const
+  {
+    using Entry = std::pair<size_t, Scalar>;
+    size_t n = sector.size();
+    CompactOperatorType off_diagonal(off_diagonal_, sector.codec);
+    ConcurrentUnionFind components(n);
+    size_t n_block = (n + BlockSize - 1) / BlockSize;
+    parallel_for(0, n_block, n_thread, [&](size_t i_block) {
+      std::vector<Entry> column;
+      for (size_t j = i_block * BlockSize; j < std::min(n, (i_block + 1) * BlockSize); ++j) {
+        column.clear();
+        off_diagonal.apply(sector.word(j), [&](const Word& w, const Scalar& v) {
+          size_t i = sector.find_word(w);
+          if (i == sector.npos) {
+            throw std::domain_error("SectorFragmentation::labels(): operator does not conserve the sector");
+          }
+          column.emplace_back(i, v);
+        });
+        std::sort(column.begin(), column.end(),
+                  [](const Entry& x, const Entry& y) { return x.first < y.first; });
+        for (size_t k = 0; k < column.size();) {
+          size_t i = column[k].first;
+          Scalar sum(0);
+          for (; k < column.size() && column[k].first == i; ++k) { sum += column[k].second; }
+          if (i != j && std::abs(sum) > Epsilon) { components.unite(i, j); }
+        }
+      }
+    });
+    return components.labels();
+  }
+
+  //! @brief Sub-sectors of the connected components of the sector.
+  //! @param sector Sector generated by BasicSectorGenerator (or a Fragment).
+  //! @param n_thread Number of threads (0 for default_n_thread()).
+  //! @return Fragments in the order of their first basis state in the sector.
+  //! @throw std::domain_error if the operator maps a state out of the sector.
+  template <typename SectorType>
+  std::vector<Fragment> split(const SectorType& sector, size_t n_thread = 0) const
+  {
+    std::vector<size_t> label = labels(sector, n_thread);
+    size_t n_fragment = 0;
+    for (size_t l : label) { n_fragment = std::max(n_fragment, l + 1); }
+    std::vector<Fragment> ret(n_fragment);
+    for (size_t i = 0; i < label.size(); ++i) { ret[label[i]].parent_index.push_back(i); }
+    parallel_for(0, n_fragment, n_thread, [&](size_t i_fragment) {
+      Fragment & fragment = ret[i_fragment];
+      auto & index = fragment.parent_index;
+      std::sort(index.begin(), index.end(), [&](size_t i, size_t j) {
+        return Rep::less(sector.word(i), sector.word(j));
+      });
+      fragment.basis.reserve(index.size());
+      for (size_t i : index) { fragment.basis.push_back(sector.word(i)); }
+      fragment.codec = sector.codec;
+    });
+    return ret;
+  }
+
+ private:
+  MixedOperatorType off_diagonal_;
+};
+
+template <typename _Scalar, size_t _RepSize, size_t _SiteSize>
+const size_t SectorFragmentation<_Scalar, _RepSize, _SiteSize>::BlockSize;
+
+template <typename _Scalar, size_t _RepSize, size_t _SiteSize>
+constexpr double SectorFragmentation<_Scalar, _RepSize, _SiteSize>::Epsilon;
+
+template <typename _Scalar, size_t _RepSize, size_t _SiteSize>
+const size_t SectorFragmentation<_Scalar, _RepSize, _SiteSize>::Fragment::npos;
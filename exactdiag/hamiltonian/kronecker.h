@@ -0,0 +1,386 @@
+#pragma once
+#include "../global.h"
+
+#include "../hilbertspace.h"
+#include "../operator.h"
+#include "../utility/parallel.h"
+#include "../utility/scalar_tools.h"
+#include "../utility/union_find.h"
+
+//! @class KroneckerHamiltonian
+//!
+//! @brief Hermitian operator in a sector, applied through its per-species factors.
+//!
+//! If the sites fall into two species A and B such that every off-diagonal term acts on
+//! sites of one species only (e.g. spin-up and spin-down fermions in the Hubbard model,
+//! where the hopping never mixes spins), the sector with quantum numbers Q is the direct sum
+//! of the products of the species sectors with qA and qB = Q - qA, and the operator is
+//!
+//!     H = H_A (x) 1 + 1 (x) H_B + D
+//!
+//! with D diagonal. The species are found by a union-find of the sites connected by the
+//! off-diagonal terms (see separate_species).
+//!
+//! The basis is ordered by block (ascending qA), then by the A state, then by the B state,
+//! so a vector is a sequence of row-major dim_A x dim_B matrices X, and
+//!
+//!     Y = H_A X + X H_B^T + D o X
+//!
+//! for every block. Only the small sparse matrices of the species, and the diagonal, are
+//! stored, so the memory is O(dim) instead of O(nnz) of the full matrix. The H_A part adds
+//! whole rows of X (dim_B contiguous elements), and the H_B part is a sparse product with
+//! every row.
+//!
+//! The basis states are the fermionic states with all the A fermions ordered before the
+//! B fermions. The state |a, b> of this basis is (-1)^n |w> in the usual order of the sites,
+//! where w is the combined representation and n the number of pairs of an occupied A fermion
+//! site after an occupied B fermion site. In this order the fermion signs of a species do not
+//! depend on the other species. Use to_sector and from_sector to convert vectors.
+//!
+//! The interface is that of MatrixFreeHamiltonian: size(), apply(x, y), apply(x, y, n_vector)
+//! and diagonal(), so it can be used with the eigensolvers.
+//!
+//! @tparam _Scalar Scalar(Field) type of the coefficient.
+//! @tparam _RepSize Number of bits of the Rep
+//! @tparam _SiteSize Number of bits of the Site (for fermion parity counting).
+//! @tparam QNS List of quantum number types.
+template <typename _Scalar, size_t _RepSize, size_t _SiteSize, typename ... QNS>
+class KroneckerHamiltonian
+{
+ public:
+  static const size_t RepSize = _RepSize;
+  static const size_t SiteSize = _SiteSize;
+  using Scalar = _Scalar;
+  using SystemType = System<QNS...>;
+  using QuantumNumberTuple = typename SystemType::QuantumNumberTuple;
+  using MixedOperatorType = MixedOperator<Scalar, RepSize, SiteSize>;
+  using CompactOperatorType = CompactOperator<Scalar, RepSize, SiteSize>;
+  using CodecType = CompactCodec<RepSize, SiteSize>;
+  using Rep = CompactRep<RepSize>;
+  using Word = typename Rep::type;
+  using BitSite = std::bitset<SiteSize>;
+
+  //! Number of elements of a vector handed to a thread at a time.
+  static const size_t BlockSize = 4096;
+
+  //! @brief Sites of species A, such that no off-diagonal term acts on both species.
+  //!
+  //! The sites acted on by every off-diagonal term are joined in a union-find. The resulting
+  //! groups are dealt to A and B in the order of their first site, each to the species with
+  //! fewer digits so far.
+  //! @return Bitset of the A sites, or none() if there is only one group, or if an off-diagonal
+  //! term has an odd number of fermion operators.
+  static BitSite separate_species(const SystemType& system, const MixedOperatorType& op)
+  {
+    size_t ns = system.n_site();
+    UnionFind groups(ns);
+    auto off_diagonal = op.off_diagonal();
+    for (size_t i_term = 0; i_term < off_diagonal.n_term(); ++i_term) {
+      auto const & term = off_diagonal.term(i_term);
+      if ((term.fp_row().count() + term.fp_col().count()) % 2 != 0) { return BitSite(); }
+      size_t first = ns;
+      for (size_t i_site = 0; i_site < ns; ++i_site) {
+        if ((term.mask() & system.template mask_digit<RepSize>(i_site)).none() && !term.fp_mask().test(i_site)) {
+          continue;
+        }
+        if (first == ns) { first = i_site; } else { groups.unite(first, i_site); }
+      }
+    }
+
+    std::vector<size_t> label = groups.labels();
+    size_t n_group = ns == 0 ? 0 : *std::max_element(label.begin(), label.end()) + 1;
+    if (n_group < 2) { return BitSite(); }
+    std::vector<size_t> n_group_digit(n_group, 0);
+    for (size_t i_site = 0; i_site < ns; ++i_site) { n_group_digit[label[i_site]] += system.site(i_site).n_digit(); }
+    std::vector<bool> in_a(n_group, false);
+    size_t n_digit_a = 0, n_digit_b = 0;
+    for (size_t g = 0; g < n_group; ++g) {
+      if (n_digit_a <= n_digit_b) {
+        in_a[g] = true;
+        n_digit_a += n_group_digit[g];
+      } else {
+        n_digit_b += n_group_digit[g];
+      }
+    }
+    BitSite species;
+    for (size_t i_site = 0; i_site < ns; ++i_site) { species.set(i_site, in_a[label[i_site]]); }
+    return species;
+  }
+
+  //! Constructor
+  //! @param system %System
+  //! @param op Hermitian operator which conserves the quantum numbers.
+  //! @param quantum_number Quantum numbers of the sector.
+  //! @param n_thread Number of threads (0 for default_n_thread()).
+  //! @throw std::domain_error if the operator is not separable, or does not conserve the sector.
+  KroneckerHamiltonian(const SystemType& system, const MixedOperatorType& op,
+                       const QuantumNumberTuple& quantum_number, size_t n_thread = 0)
+      : codec_(system), n_site_(system.n_site()), size_(0), n_thread_(n_thread)
+  {
+    species_ = separate_species(system, op);
+    if (species_.none()) {
+      throw std::domain_error("KroneckerHamiltonian(): operator is not separable");
+    }
+
+    // sub-systems of the two species, and the species sectors.
+    SystemType subsystem[2];
+    std::vector<size_t> sites[2];
+    for (size_t i_site = 0; i_site < n_site_; ++i_site) {
+      size_t s = species_.test(i_site) ? 0 : 1;
+      subsystem[s].add_site(system.site(i_site));
+      sites[s].push_back(i_site);
+    }
+    auto dimensions_b = subsystem[1].sector_dimensions();
+    for (auto const & dim_a : subsystem[0].sector_dimensions()) {
+      QuantumNumberTuple qn_b = elementwise(quantum_number) - elementwise(dim_a.first);
+      if (dimensions_b.find(qn_b) == dimensions_b.end()) { continue; }
+      QuantumNumberTuple qns[2] = {dim_a.first, qn_b};
+      Block block;
+      block.offset = size_;
+      for (size_t s = 0; s < 2; ++s) {
+        Part part;
+        for (BasisIterator<RepSize, SiteSize, QNS...> iter(subsystem[s], qns[s]); iter.valid(); ++iter) {
+          part.basis.push_back(scatter(system, subsystem[s], sites[s], iter.word()));
+        }
+        (s == 0 ? block.a : block.b) = parts_[s].size();
+        parts_[s].push_back(std::move(part));
+      }
+      blocks_.push_back(block);
+      size_ += parts_[0][block.a].size() * parts_[1][block.b].size();
+    }
+
+    // species matrices, in the fermion order of A before B.
+    auto off_diagonal = op.off_diagonal();
+    for (size_t s = 0; s < 2; ++s) {
+      MixedOperatorType species_op;
+      for (size_t i_term = 0; i_term < off_diagonal.n_term(); ++i_term) {
+        auto const & term = off_diagonal.term(i_term);
+        if (species_.test(first_site(system, term)) == (s == 0)) { species_op.add(term); }
+      }
+      CompactOperatorType compact(species_op, codec_);
+      parallel_for(0, parts_[s].size(), n_thread_, [&](size_t i_part) { build_part(compact, parts_[s][i_part]); });
+    }
+
+    // tasks: ranges of rows of the blocks.
+    for (size_t i_block = 0; i_block < blocks_.size(); ++i_block) {
+      size_t n_row = parts_[0][blocks_[i_block].a].size();
+      size_t n_col = parts_[1][blocks_[i_block].b].size();
+      size_t step = std::max<size_t>(1, BlockSize / std::max<size_t>(1, n_col));
+      for (size_t begin = 0; begin < n_row; begin += step) {
+        tasks_.push_back(Task{i_block, begin, std::min(n_row, begin + step)});
+      }
+    }
+
+    // diagonal
+    CompactOperatorType diagonal_op(op.diagonal(), codec_);
+    diagonal_.assign(size_, Scalar(0));
+    parallel_for(0, tasks_.size(), n_thread_, [&](size_t i_task) {
+      const Task& task = tasks_[i_task];
+      const Block& block = blocks_[task.block];
+      const Part& pa = parts_[0][block.a];
+      const Part& pb = parts_[1][block.b];
+      for (size_t a = task.begin; a < task.end; ++a) {
+        for (size_t b = 0; b < pb.size(); ++b) {
+          Scalar& value = diagonal_[block.offset + a * pb.size() + b];
+          diagonal_op.apply(pa.basis[a] | pb.basis[b], [&value](const Word&, const Scalar& v) { value += v; });
+        }
+      }
+    });
+  }
+
+  //! Dimension of the sector.
+  size_t size() const { return size_; }
+
+  //! Sites of species A.
+  const BitSite & species() const { return species_; }
+
+  //! Number of blocks (pairs of species sectors qA, Q - qA).
+  size_t n_block() const { return blocks_.size(); }
+
+  //! Diagonal elements, in the order of this basis.
+  const std::vector<Scalar> & diagonal() const { return diagonal_; }
+
+  //! Representation of the basis state of the given index.
+  Word word(size_t idx) const {
+    assert(idx < size_);
+    auto block = std::upper_bound(blocks_.begin(), blocks_.end(), idx,
+                                  [](size_t i, const Block& b) { return i < b.offset; }) - 1;
+    const Part& pb = parts_[1][block->b];
+    size_t r = idx - block->offset;
+    return parts_[0][block->a].basis[r / pb.size()] | pb.basis[r % pb.size()];
+  }
+
+  //! Sign of the basis state of the given index relative to the usual order of the sites.
+  int sign(size_t idx) const { return reorder_odd(word(idx)) ? -1 : 1; }
+
+  //! Number of bytes of the species matrices and the diagonal.
+  size_t memory_usage() const {
+    size_t n_byte = diagonal_.size() * sizeof(Scalar);
+    for (size_t s = 0; s < 2; ++s) {
+      for (auto const & part : parts_[s]) {
+        n_byte += part.basis.size() * sizeof(Word) + part.outer.size() * sizeof(size_t)
+                  + part.inner.size() * sizeof(uint32_t) + part.values.size() * sizeof(Scalar);
+      }
+    }
+    return n_byte;
+  }
+
+  //! y = H x
+  void apply(const Scalar* x, Scalar* y) const { apply(x, y, 1); }
+
+  //! @brief Y = H X for n_vector vectors at once (row-major blocks of size() x n_vector).
+  void apply(const Scalar* x, Scalar* y, size_t n_vector) const {
+    parallel_for(0, tasks_.size(), n_thread_, [&](size_t i_task) {
+      const Task& task = tasks_[i_task];
+      const Block& block = blocks_[task.block];
+      const Part& pa = parts_[0][block.a];
+      const Part& pb = parts_[1][block.b];
+      size_t row = pb.size() * n_vector;
+      const Scalar* xb = x + block.offset * n_vector;
+      Scalar* yb = y + block.offset * n_vector;
+      for (size_t a = task.begin; a < task.end; ++a) {
+        const Scalar* xa = xb + a * row;
+        Scalar* ya = yb + a * row;
+        const Scalar* da = diagonal_.data() + block.offset + a * pb.size();
+        for (size_t b = 0; b < pb.size(); ++b) {
+          for (size_t v = 0; v < n_vector; ++v) { ya[b * n_vector + v] = da[b] * xa[b * n_vector + v]; }
+        }
+        // H_A X: whole rows
+        for (size_t k = pa.outer[a]; k < pa.outer[a + 1]; ++k) {
+          Scalar c = pa.values[k];
+          const Scalar* xk = xb + pa.inner[k] * row;
+          for (size_t e = 0; e < row; ++e) { ya[e] += c * xk[e]; }
+        }
+        // X H_B^T: within the row
+        for (size_t b = 0; b < pb.size(); ++b) {
+          Scalar* yab = ya + b * n_vector;
+          for (size_t k = pb.outer[b]; k < pb.outer[b + 1]; ++k) {
+            Scalar c = pb.values[k];
+            const Scalar* xk = xa + pb.inner[k] * n_vector;
+            for (size_t v = 0; v < n_vector; ++v) { yab[v] += c * xk[v]; }
+          }
+        }
+      }
+    });
+  }
+
+  //! @brief Convert a vector of this basis to the basis of a sector with the same quantum numbers.
+  //! @param sector Sector generated by BasicSectorGenerator.
+  template <typename SectorType>
+  void to_sector(const SectorType& sector, const Scalar* x, Scalar* x_sector) const {
+    assert(sector.size() == size_);
+    parallel_for(0, size_, n_thread_, [&](size_t i) {
+      x_sector[sector.find_word(word(i))] = Scalar(sign(i)) * x[i];
+    });
+  }
+
+  //! Convert a vector of the basis of a sector to this basis.
+  template <typename SectorType>
+  void from_sector(const SectorType& sector, const Scalar* x_sector, Scalar* x) const {
+    assert(sector.size() == size_);
+    parallel_for(0, size_, n_thread_, [&](size_t i) {
+      x[i] = Scalar(sign(i)) * x_sector[sector.find_word(word(i))];
+    });
+  }
+
+ private:
+  //! Basis and off-diagonal matrix of a species sector. Row j holds (i, conj(H[i,j])).
+  struct Part {
+    std::vector<Word> basis;       //!< ascending, in the digits of the full system
+    std::vector<size_t> outer;
+    std::vector<uint32_t> inner;
+    std::vector<Scalar> values;
+
+    size_t size() const { return basis.size(); }
+  };
+
+  struct Block {
+    size_t offset;   //!< index of the first state
+    size_t a, b;     //!< parts of the species
+  };
+
+  struct Task {
+    size_t block;
+    size_t begin, end;   //!< rows (A states)
+  };
+
+  //! Representation of a subsystem state in the digits of the full system.
+  static Word scatter(const SystemType& system, const SystemType& subsystem,
+                      const std::vector<size_t>& sites, const Word& w) {
+    Word ret(0);
+    for (size_t k = 0; k < sites.size(); ++k) {
+      uint64_t digits = Rep::low_bits(w >> subsystem.start_digit(k), subsystem.site(k).n_digit());
+      ret |= Word(digits) << system.start_digit(sites[k]);
+    }
+    return ret;
+  }
+
+  //! First site acted on by a term.
+  template <typename PureOperatorType>
+  static size_t first_site(const SystemType& system, const PureOperatorType& term) {
+    for (size_t i_site = 0; i_site < system.n_site(); ++i_site) {
+      if ((term.mask() & system.template mask_digit<RepSize>(i_site)).any() || term.fp_mask().test(i_site)) {
+        return i_site;
+      }
+    }
+    return 0;
+  }
+
+  //! Whether the number of occupied A fermion sites after occupied B fermion sites is odd.
+  bool reorder_odd(const Word& w) const {
+    BitSite parity = codec_.fermion_parity(w);
+    bool odd = false;
+    size_t n_b = 0;
+    for (size_t i_site = 0; i_site < n_site_; ++i_site) {
+      if (!parity.test(i_site)) { continue; }
+      if (species_.test(i_site)) {
+        odd = (odd != ((n_b & 1) != 0));
+      } else {
+        ++n_b;
+      }
+    }
+    return odd;
+  }
+
+  //! Matrix of the terms of one species in a species sector (the other species is empty).
+  void build_part(const CompactOperatorType& op, Part& part) const {
+    part.outer.assign(1, 0);
+    std::vector<std::pair<uint32_t, Scalar>> row;
+    for (size_t j = 0; j < part.size(); ++j) {
+      row.clear();
+      bool odd_j = reorder_odd(part.basis[j]);
+      op.apply(part.basis[j], [&](const Word& w, const Scalar& v) {
+        auto found = std::lower_bound(part.basis.begin(), part.basis.end(), w, &Rep::less);
+        if (found == part.basis.end() || *found != w) {
+          throw std::domain_error("KroneckerHamiltonian(): operator does not conserve the sector");
+        }
+        bool odd = reorder_odd(w) != odd_j;
+        row.emplace_back(static_cast<uint32_t>(found - part.basis.begin()), detail::conjugate(odd ? -v : v));
+      });
+      std::sort(row.begin(), row.end(),
+                [](const std::pair<uint32_t, Scalar>& x, const std::pair<uint32_t, Scalar>& y) { return x.first < y.first; });
+      for (size_t k = 0; k < row.size(); ++k) {
+        if (k > 0 && row[k].first == row[k - 1].first) {
+          part.values.back() += row[k].second;
+        } else {
+          part.inner.push_back(row[k].first);
+          part.values.push_back(row[k].second);
+        }
+      }
+      part.outer.push_back(part.inner.size());
+    }
+  }
+
+  CodecType codec_;
+  size_t n_site_;
+  BitSite species_;
+  std::vector<Part> parts_[2];
+  std::vector<Block> blocks_;
+  std::vector<Task> tasks_;
+  std::vector<Scalar> diagonal_;
+  size_t size_;
+  size_t n_thread_;
+};
+
+template <typename _Scalar, size_t _RepSize, size_t _SiteSize, typename ... QNS>
+const size_t KroneckerHamiltonian<_Scalar, _RepSize, _SiteSize, QNS...>::BlockSize;
@@ -0,0 +1,203 @@
+#pragma once
+#include "../global.h"
+
+#include <Eigen/Core>
+#include <Eigen/Sparse>
+
+#include "../operator.h"
+#include "../utility/parallel.h"
+#include "../utility/scalar_tools.h"
+#include "diagonal.h"
+
+template <typename _Scalar, size_t _RepSize, size_t _SiteSize, typename _SectorType>
+class MatrixFreeHamiltonian;
+
+namespace Eigen {
+namespace internal {
+
+template <typename _Scalar, size_t _RepSize, size_t _SiteSize, typename _SectorType>
+struct traits<MatrixFreeHamiltonian<_Scalar, _RepSize, _SiteSize, _SectorType>>
+    : public traits<SparseMatrix<_Scalar>>
+{
+};
+
+} // namespace internal
+} // namespace Eigen
+
+
+//! @class MatrixFreeHamiltonian
+//!
+//! @brief Hermitian operator in a sector, applied to vectors without storing its matrix.
+//!
+//! y = H x is computed row by row in the gather form
+//!
+//!     y[i] = d[i] x[i] + sum_k conj(<k|H|i>) x[k]
+//!
+//! where the <k|H|i> are obtained by applying the off-diagonal terms to the basis state i,
+//! and d holds the diagonal elements (see SectorDiagonal). Every thread writes its own
+//! rows of y only, so there are no write conflicts. The operator must be Hermitian
+//! and conserve the sector.
+//!
+//! The interface expected by the eigensolvers of this library is
+//!
+//!     size_t size() const;
+//!     void apply(const Scalar* x, Scalar* y) const;     // y = H x
+//!
+//! and apply(x, y, n_vector) for blocks of vectors (see Lobpcg).
+//!
+//! The class is also an Eigen::EigenBase, so that it can be used with Eigen's iterative
+//! solvers (e.g. ConjugateGradient with IdentityPreconditioner) and in products with Eigen vectors.
+//!
+//! @tparam _Scalar Scalar(Field) type of the coefficient.
+//! @tparam _RepSize Number of bits of the Rep
+//! @tparam _SiteSize Number of bits of the Site (for fermion parity counting).
+//! @tparam _SectorType Sector generated by BasicSectorGenerator. It is referenced, not copied.
+template <typename _Scalar, size_t _RepSize, size_t _SiteSize, typename _SectorType>
+class MatrixFreeHamiltonian
+    : public Eigen::EigenBase<MatrixFreeHamiltonian<_Scalar, _RepSize, _SiteSize, _SectorType>>
+{
+ public:
+  static const size_t RepSize = _RepSize;
+  static const size_t SiteSize = _SiteSize;
+  using Scalar = _Scalar;
+  using RealScalar = typename Eigen::NumTraits<Scalar>::Real;
+  using StorageIndex = int;
+  using SectorType = _SectorType;
+  using MixedOperatorType = MixedOperator<Scalar, RepSize, SiteSize>;
+  using CompactOperatorType = CompactOperator<Scalar, RepSize, SiteSize>;
+  using Word = typename CompactOperatorType::Word;
+
+  enum {
+    ColsAtCompileTime = Eigen::Dynamic,
+    MaxColsAtCompileTime = Eigen::Dynamic,
+    IsRowMajor = false
+  };
+
+  //! Number of rows handed to a thread at a time.
+  static const size_t BlockSize = 1024;
+
+  //! Constructor
+  //! @param op Hermitian operator which conserves the sector.
+  //! @param sector Sector, which must outlive this object.
+  //! @param n_thread Number of threads (0 for default_n_thread()).
+  MatrixFreeHamiltonian(const MixedOperatorType& op, const SectorType& sector, size_t n_thread = 0)
+      : sector_(&sector),
+        diagonal_(op, sector, n_thread),
+        off_diagonal_(op.off_diagonal(), sector.codec),
+        n_thread_(n_thread)
+  {
+  }
+
+  //! Dimension of the sector.
+  size_t size() const { return diagonal_.size(); }
+
+  Eigen::Index rows() const { return static_cast<Eigen::Index>(size()); }
+  Eigen::Index cols() const { return static_cast<Eigen::Index>(size()); }
+
+  const SectorDiagonal<Scalar> & diagonal() const { return diagonal_; }
+
+  //! y = H x
+  //! @throw std::domain_error if the operator maps a state out of the sector.
+  void apply(const Scalar* x, Scalar* y) const {
+    size_t n_block = (size() + BlockSize - 1) / BlockSize;
+    parallel_for(0, n_block, n_thread_, [&](size_t i_block) {
+      apply(x, y, i_block * BlockSize, std::min(size(), (i_block + 1) * BlockSize));
+    });
+  }
+
+  //! y[i] = (H x)[i] for i in [begin, end), on the calling thread.
+  void apply(const Scalar* x, Scalar* y, size_t begin, size_t end) const {
+    for (size_t i = begin; i < end; ++i) {
+      Scalar sum = diagonal_[i] * x[i];
+      off_diagonal_.apply(sector_->word(i), [&](const Word& w, const Scalar& v) {
+        size_t k = sector_->find_word(w);
+        if (k == sector_->npos) {
+          throw std::domain_error("MatrixFreeHamiltonian::apply(): operator does not conserve the sector");
+        }
+        sum += detail::conjugate(v) * x[k];
+      });
+      y[i] = sum;
+    }
+  }
+
+  //! @brief Y = H X for n_vector vectors at once.
+  //!
+  //! X and Y are row-major blocks of size() x n_vector. The off-diagonal terms are applied
+  //! (and the states looked up) once per row for all the vectors.
+  //! @throw std::domain_error if the operator maps a state out of the sector.
+  void apply(const Scalar* x, Scalar* y, size_t n_vector) const {
+    size_t n_block = (size() + BlockSize - 1) / BlockSize;
+    parallel_for(0, n_block, n_thread_, [&](size_t i_block) {
+      size_t end = std::min(size(), (i_block + 1) * BlockSize);
+      for (size_t i = i_block * BlockSize; i < end; ++i) {
+        Scalar* yi = y + i * n_vector;
+        const Scalar* xi = x + i * n_vector;
+        for (size_t v = 0; v < n_vector; ++v) { yi[v] = diagonal_[i] * xi[v]; }
+        off_diagonal_.apply(sector_->word(i), [&](const Word& w, const Scalar& a) {
+          size_t k = sector_->find_word(w);
+          if (k == sector_->npos) {
+            throw std::domain_error("MatrixFreeHamiltonian::apply(): operator does not conserve the sector");
+          }
+          Scalar c = detail::conjugate(a);
+          const Scalar* xk = x + k * n_vector;
+          for (size_t v = 0; v < n_vector; ++v) { yi[v] += c * xk[v]; }
+        });
+      }
+    });
+  }
+
+  //! Product with an Eigen vector, evaluated by apply().
+  template <typename Rhs>
+  Eigen::Product<MatrixFreeHamiltonian, Rhs, Eigen::AliasFreeProduct>
+  operator*(const Eigen::MatrixBase<Rhs>& x) const {
+    return Eigen::Product<MatrixFreeHamiltonian, Rhs, Eigen::AliasFreeProduct>(*this, x.derived());
+  }
+
+ private:
+  const SectorType* sector_;
+  SectorDiagonal<Scalar> diagonal_;
+  CompactOperatorType off_diagonal_;
+  size_t n_thread_;
+};
+
+template <typename _Scalar, size_t _RepSize, size_t _SiteSize, typename _SectorType>
+const size_t MatrixFreeHamiltonian<_Scalar, _RepSize, _SiteSize, _SectorType>::BlockSize;
+
+
+//! Construct a MatrixFreeHamiltonian, deducing the sector type.
+template <typename Scalar, size_t RepSize, size_t SiteSize, typename SectorType> inline
+MatrixFreeHamiltonian<Scalar, RepSize, SiteSize, SectorType>
+make_matrix_free_hamiltonian(const MixedOperator<Scalar, RepSize, SiteSize>& op,
+                             const SectorType& sector,
+                             size_t n_thread = 0)
+{
+  return MatrixFreeHamiltonian<Scalar, RepSize, SiteSize, SectorType>(op, sector, n_thread);
+}
+
+
+namespace Eigen {
+namespace internal {
+
+template <typename _Scalar, size_t _RepSize, size_t _SiteSize, typename _SectorType, typename Rhs>
+struct generic_product_impl<MatrixFreeHamiltonian<_Scalar, _RepSize, _SiteSize, _SectorType>,
+                            Rhs, SparseShape, DenseShape, GemvProduct>
+    : generic_product_impl_base<MatrixFreeHamiltonian<_Scalar, _RepSize, _SiteSize, _SectorType>, Rhs,
+                                generic_product_impl<MatrixFreeHamiltonian<_Scalar, _RepSize, _SiteSize, _SectorType>, Rhs>>
+{
+  using Lhs = MatrixFreeHamiltonian<_Scalar, _RepSize, _SiteSize, _SectorType>;
+  using Scalar = typename Product<Lhs, Rhs>::Scalar;
+  using VectorType = Matrix<_Scalar, Dynamic, 1>;
+
+  //! dst += alpha * lhs * rhs
+  template <typename Dest>
+  static void scaleAndAddTo(Dest& dst, const Lhs& lhs, const Rhs& rhs, const Scalar& alpha)
+  {
+    VectorType x = rhs;
+    VectorType y(lhs.size());
+    lhs.apply(x.data(), y.data());
+    dst.noalias() += alpha * y;
+  }
+};
+
+} // namespace internal
+} // namespace Eigen
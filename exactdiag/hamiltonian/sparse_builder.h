@@ -0,0 +1,238 @@
+#pragma once
+#include "../global.h"
+
+#include <Eigen/Sparse>
+
+#include "../operator.h"
+#include "../utility/parallel.h"
+#include "../utility/scalar_tools.h"
+#include "diagonal.h"
+
+//! @class SparseHamiltonian
+//!
+//! @brief Matrix of an operator in a sector, in compressed sparse column format.
+//!
+//! Column j holds the result of applying the operator to the basis state j, with the
+//! row indices sorted and unique. (For a Hermitian operator these are also the compressed
+//! rows of its complex conjugate, and of the operator itself if it is real.)
+//! The arrays are exported to Eigen by matrix() without copying.
+//!
+//! @tparam _Scalar Scalar type of the matrix elements.
+//! @tparam _StorageIndex Integer type of the indices (as Eigen's StorageIndex).
+template <typename _Scalar, typename _StorageIndex = int>
+class SparseHamiltonian
+{
+ public:
+  using Scalar = _Scalar;
+  using StorageIndex = _StorageIndex;
+  using MatrixType = Eigen::SparseMatrix<Scalar, Eigen::ColMajor, StorageIndex>;
+  using MapType = Eigen::Map<const MatrixType>;
+
+  SparseHamiltonian() : outer_index_(1, 0), n_thread_(0) { }
+
+  //! Dimension of the sector.
+  size_t size() const { return outer_index_.size() - 1; }
+
+  //! Number of stored elements.
+  size_t nnz() const { return values_.size(); }
+
+  const std::vector<StorageIndex> & outer_index() const { return outer_index_; }
+  const std::vector<StorageIndex> & inner_index() const { return inner_index_; }
+  const std::vector<Scalar> & values() const { return values_; }
+
+  //! Diagonal elements (used as the preconditioner of Davidson).
+  const SectorDiagonal<Scalar> & diagonal() const { return diagonal_; }
+
+  //! Number of threads used by apply() (0 for default_n_thread()).
+  size_t n_thread() const { return n_thread_; }
+  void set_n_thread(size_t n_thread) { n_thread_ = n_thread; }
+
+  //! @brief y = A x for a Hermitian A, as expected by the eigensolvers.
+  //!
+  //! Every column is gathered into its own element of y (y[j] = sum_k conj(A[k,j]) x[k]),
+  //! so the columns can be split on threads without write conflicts.
+  void apply(const Scalar* x, Scalar* y) const {
+    static const size_t BlockSize = 4096;
+    size_t n_block = (size() + BlockSize - 1) / BlockSize;
+    parallel_for(0, n_block, n_thread_, [&](size_t i_block) {
+      size_t end = std::min(size(), (i_block + 1) * BlockSize);
+      for (size_t j = i_block * BlockSize; j < end; ++j) {
+        Scalar sum(0);
+        for (StorageIndex k = outer_index_[j]; k < outer_index_[j + 1]; ++k) {
+          sum += detail::conjugate(values_[k]) * x[inner_index_[k]];
+        }
+        y[j] = sum;
+      }
+    });
+  }
+
+  //! @brief Y = A X for n_vector vectors at once.
+  //!
+  //! X and Y are row-major blocks of size() x n_vector (the n_vector elements of every row
+  //! are contiguous), so every stored element is loaded once for all the vectors.
+  void apply(const Scalar* x, Scalar* y, size_t n_vector) const {
+    static const size_t BlockSize = 4096;
+    size_t n_block = (size() + BlockSize - 1) / BlockSize;
+    parallel_for(0, n_block, n_thread_, [&](size_t i_block) {
+      size_t end = std::min(size(), (i_block + 1) * BlockSize);
+      for (size_t j = i_block * BlockSize; j < end; ++j) {
+        Scalar* yj = y + j * n_vector;
+        std::fill(yj, yj + n_vector, Scalar(0));
+        for (StorageIndex k = outer_index_[j]; k < outer_index_[j + 1]; ++k) {
+          Scalar a = detail::conjugate(values_[k]);
+          const Scalar* xk = x + static_cast<size_t>(inner_index_[k]) * n_vector;
+          for (size_t v = 0; v < n_vector; ++v) { yj[v] += a * xk[v]; }
+        }
+      }
+    });
+  }
+
+  //! Eigen view of the arrays. It is valid as long as this object is alive and unchanged.
+  MapType matrix() const {
+    Eigen::Index n = static_cast<Eigen::Index>(size());
+    return MapType(n, n, static_cast<Eigen::Index>(nnz()),
+                   outer_index_.data(), inner_index_.data(), values_.data());
+  }
+
+ private:
+  template <typename, size_t, size_t, typename> friend class HamiltonianBuilder;
+  template <typename, size_t, size_t, typename> friend class SymmetricHamiltonianBuilder;
+
+  std::vector<StorageIndex> outer_index_;
+  std::vector<StorageIndex> inner_index_;
+  std::vector<Scalar> values_;
+  SectorDiagonal<Scalar> diagonal_;
+  size_t n_thread_;
+};
+
+
+//! @class HamiltonianBuilder
+//!
+//! @brief Parallel assembly of the SparseHamiltonian of an operator in a sector.
+//!
+//! The assembly runs in two passes over the basis. The first pass counts the
+//! elements of every column, and a prefix sum gives the column offsets. The second
+//! pass writes every column into its place in the arrays. Both passes are split into
+//! blocks of columns on threads, and no triplets are staged or sorted globally.
+//! The diagonal terms are evaluated by SectorDiagonal, and the off-diagonal terms are
+//! applied to the compact representations and looked up in the sector.
+//!
+//! @tparam _Scalar Scalar(Field) type of the coefficient.
+//! @tparam _RepSize Number of bits of the Rep
+//! @tparam _SiteSize Number of bits of the Site (for fermion parity counting).
+//! @tparam _StorageIndex Integer type of the indices of the SparseHamiltonian.
+template <typename _Scalar, size_t _RepSize, size_t _SiteSize, typename _StorageIndex = int>
+class HamiltonianBuilder
+{
+ public:
+  static const size_t RepSize = _RepSize;
+  static const size_t SiteSize = _SiteSize;
+  using Scalar = _Scalar;
+  using StorageIndex = _StorageIndex;
+  using MixedOperatorType = MixedOperator<Scalar, RepSize, SiteSize>;
+  using CompactOperatorType = CompactOperator<Scalar, RepSize, SiteSize>;
+  using SparseHamiltonianType = SparseHamiltonian<Scalar, StorageIndex>;
+
+  //! Number of columns handed to a thread at a time.
+  static const size_t BlockSize = 1024;
+
+  //! Constructor
+  //! @param op Operator, which must conserve the quantum numbers of the sectors.
+  HamiltonianBuilder(const MixedOperatorType& op)
+      : diagonal_(op.diagonal()), off_diagonal_(op.off_diagonal())
+  {
+  }
+
+  //! @brief Matrix of the operator in the given sector.
+  //! @param sector Sector generated by BasicSectorGenerator.
+  //! @param n_thread Number of threads (0 for default_n_thread()), also used by its apply().
+  //! @throw std::domain_error if the operator maps a state out of the sector.
+  //! @throw std::length_error if the number of elements does not fit in StorageIndex.
+  template <typename SectorType>
+  SparseHamiltonianType build(const SectorType& sector, size_t n_thread = 0) const
+  {
+    size_t n = sector.size();
+    if (n > static_cast<size_t>(std::numeric_limits<StorageIndex>::max())) {
+      throw std::length_error("HamiltonianBuilder::build(): sector too large for StorageIndex");
+    }
+    SectorDiagonal<Scalar> diagonal(diagonal_, sector, n_thread);
+    CompactOperatorType off_diagonal(off_diagonal_, sector.codec);
+    size_t n_block = (n + BlockSize - 1) / BlockSize;
+
+    // pass 1: number of elements in every column.
+    std::vector<size_t> count(n + 1, 0);
+    parallel_for(0, n_block, n_thread, [&](size_t i_block) {
+      std::vector<Entry> column;
+      for (size_t j = i_block * BlockSize; j < std::min(n, (i_block + 1) * BlockSize); ++j) {
+        make_column(sector, diagonal, off_diagonal, j, column);
+        count[j + 1] = column.size();
+      }
+    });
+    for (size_t j = 0; j < n; ++j) { count[j + 1] += count[j]; }
+    if (count[n] > static_cast<size_t>(std::numeric_limits<StorageIndex>::max())) {
+      throw std::length_error("HamiltonianBuilder::build(): too many elements for StorageIndex");
+    }
+
+    // pass 2: fill the columns in place.
+    SparseHamiltonianType ret;
+    ret.n_thread_ = n_thread;
+    ret.outer_index_.resize(n + 1);
+    ret.inner_index_.resize(count[n]);
+    ret.values_.resize(count[n]);
+    parallel_for(0, n_block, n_thread, [&](size_t i_block) {
+      std::vector<Entry> column;
+      for (size_t j = i_block * BlockSize; j < std::min(n, (i_block + 1) * BlockSize); ++j) {
+        make_column(sector, diagonal, off_diagonal, j, column);
+        assert(column.size() == count[j + 1] - count[j]);
+        for (size_t k = 0; k < column.size(); ++k) {
+          ret.inner_index_[count[j] + k] = column[k].first;
+          ret.values_[count[j] + k] = column[k].second;
+        }
+      }
+    });
+    for (size_t j = 0; j <= n; ++j) { ret.outer_index_[j] = static_cast<StorageIndex>(count[j]); }
+    ret.diagonal_ = std::move(diagonal);
+    return ret;
+  }
+
+ private:
+  using Entry = std::pair<StorageIndex, Scalar>;
+
+  //! Elements of column j, sorted by row, with the duplicates summed.
+  template <typename SectorType>
+  static void make_column(const SectorType& sector,
+                          const SectorDiagonal<Scalar>& diagonal,
+                          const CompactOperatorType& off_diagonal,
+                          size_t j,
+                          std::vector<Entry>& column)
+  {
+    column.clear();
+    if (diagonal[j] != Scalar(0)) {
+      column.emplace_back(static_cast<StorageIndex>(j), diagonal[j]);
+    }
+    off_diagonal.apply(sector.word(j), [&](const typename CompactOperatorType::Word& w, const Scalar& v) {
+      size_t i = sector.find_word(w);
+      if (i == sector.npos) {
+        throw std::domain_error("HamiltonianBuilder::build(): operator does not conserve the sector");
+      }
+      column.emplace_back(static_cast<StorageIndex>(i), v);
+    });
+    std::sort(column.begin(), column.end(),
+              [](const Entry& x, const Entry& y) { return x.first < y.first; });
+    size_t n_unique = 0;
+    for (size_t k = 0; k < column.size(); ++k) {
+      if (n_unique > 0 && column[n_unique - 1].first == column[k].first) {
+        column[n_unique - 1].second += column[k].second;
+      } else {
+        column[n_unique++] = column[k];
+      }
+    }
+    column.resize(n_unique);
+  }
+
+  MixedOperatorType diagonal_;
+  MixedOperatorType off_diagonal_;
+};
+
+template <typename _Scalar, size_t _RepSize, size_t _SiteSize, typename _StorageIndex>
+const size_t HamiltonianBuilder<_Scalar, _RepSize, _SiteSize, _StorageIndex>::BlockSize;
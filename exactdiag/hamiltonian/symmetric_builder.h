@@ -0,0 +1,139 @@
+#pragma once
+#include "../global.h"
+
+#include <complex>
+
+#include "../operator.h"
+#include "../utility/parallel.h"
+#include "sparse_builder.h"
+
+//! @class SymmetricHamiltonianBuilder
+//!
+//! @brief Assembly of the SparseHamiltonian of an operator in a symmetry-adapted sector.
+//!
+//! The operator must conserve the quantum numbers and commute with the group of the sector
+//! (see SymmetricSectorGenerator). Applying it to the representative r_j gives states w,
+//! which are mapped to their representatives r_i = g w with g |w> = (-1)^n |r_i>, so
+//!
+//!     <r_i|H|r_j> = sum_w <w|H|r_j> (-1)^n conj(chi(g)) norm(r_i) / norm(r_j)
+//!
+//! States of orbits which are not compatible with the representation do not contribute.
+//! The matrix elements are complex in general (e.g. at nonzero momentum), whatever the
+//! scalar type of the operator. The assembly runs in two passes as HamiltonianBuilder.
+//!
+//! @tparam _Scalar Scalar(Field) type of the coefficient of the operator.
+//! @tparam _RepSize Number of bits of the Rep
+//! @tparam _SiteSize Number of bits of the Site (for fermion parity counting).
+//! @tparam _StorageIndex Integer type of the indices of the SparseHamiltonian.
+template <typename _Scalar, size_t _RepSize, size_t _SiteSize, typename _StorageIndex = int>
+class SymmetricHamiltonianBuilder
+{
+ public:
+  static const size_t RepSize = _RepSize;
+  static const size_t SiteSize = _SiteSize;
+  using Scalar = _Scalar;
+  using Complex = std::complex<double>;
+  using StorageIndex = _StorageIndex;
+  using MixedOperatorType = MixedOperator<Scalar, RepSize, SiteSize>;
+  using CompactOperatorType = CompactOperator<Scalar, RepSize, SiteSize>;
+  using SparseHamiltonianType = SparseHamiltonian<Complex, StorageIndex>;
+
+  //! Number of columns handed to a thread at a time.
+  static const size_t BlockSize = 1024;
+
+  //! Constructor
+  //! @param op Operator, which must conserve the quantum numbers and commute with the group.
+  SymmetricHamiltonianBuilder(const MixedOperatorType& op)
+      : op_(op)
+  {
+  }
+
+  //! @brief Matrix of the operator in the given sector.
+  //! @param sector Sector generated by SymmetricSectorGenerator.
+  //! @param n_thread Number of threads (0 for default_n_thread()), also used by its apply().
+  //! @throw std::length_error if the number of elements does not fit in StorageIndex.
+  template <typename SectorType>
+  SparseHamiltonianType build(const SectorType& sector, size_t n_thread = 0) const
+  {
+    size_t n = sector.size();
+    if (n > static_cast<size_t>(std::numeric_limits<StorageIndex>::max())) {
+      throw std::length_error("SymmetricHamiltonianBuilder::build(): sector too large for StorageIndex");
+    }
+    CompactOperatorType op(op_, sector.codec);
+    size_t n_block = (n + BlockSize - 1) / BlockSize;
+
+    // pass 1: number of elements in every column.
+    std::vector<size_t> count(n + 1, 0);
+    parallel_for(0, n_block, n_thread, [&](size_t i_block) {
+      std::vector<Entry> column;
+      for (size_t j = i_block * BlockSize; j < std::min(n, (i_block + 1) * BlockSize); ++j) {
+        make_column(sector, op, j, column);
+        count[j + 1] = column.size();
+      }
+    });
+    for (size_t j = 0; j < n; ++j) { count[j + 1] += count[j]; }
+    if (count[n] > static_cast<size_t>(std::numeric_limits<StorageIndex>::max())) {
+      throw std::length_error("SymmetricHamiltonianBuilder::build(): too many elements for StorageIndex");
+    }
+
+    // pass 2: fill the columns in place, and pick up the diagonal.
+    SparseHamiltonianType ret;
+    ret.n_thread_ = n_thread;
+    ret.outer_index_.resize(n + 1);
+    ret.inner_index_.resize(count[n]);
+    ret.values_.resize(count[n]);
+    std::vector<Complex> diagonal(n, Complex(0));
+    parallel_for(0, n_block, n_thread, [&](size_t i_block) {
+      std::vector<Entry> column;
+      for (size_t j = i_block * BlockSize; j < std::min(n, (i_block + 1) * BlockSize); ++j) {
+        make_column(sector, op, j, column);
+        assert(column.size() == count[j + 1] - count[j]);
+        for (size_t k = 0; k < column.size(); ++k) {
+          ret.inner_index_[count[j] + k] = column[k].first;
+          ret.values_[count[j] + k] = column[k].second;
+          if (static_cast<size_t>(column[k].first) == j) { diagonal[j] = column[k].second; }
+        }
+      }
+    });
+    for (size_t j = 0; j <= n; ++j) { ret.outer_index_[j] = static_cast<StorageIndex>(count[j]); }
+    ret.diagonal_ = SectorDiagonal<Complex>(std::move(diagonal));
+    return ret;
+  }
+
+ private:
+  using Entry = std::pair<StorageIndex, Complex>;
+
+  //! Elements of column j, sorted by row, with the duplicates summed and the zeros dropped.
+  template <typename SectorType>
+  static void make_column(const SectorType& sector, const CompactOperatorType& op,
+                          size_t j, std::vector<Entry>& column)
+  {
+    column.clear();
+    double norm_j = sector.norm(j);
+    op.apply(sector.word(j), [&](const typename CompactOperatorType::Word& w, const Scalar& v) {
+      auto rep = sector.representative(w);
+      if (rep.index == sector.npos) { return; }
+      Complex c = Complex(v) * std::conj(sector.characters[rep.element]) * (sector.norm(rep.index) / norm_j);
+      column.emplace_back(static_cast<StorageIndex>(rep.index), rep.odd ? -c : c);
+    });
+    std::sort(column.begin(), column.end(),
+              [](const Entry& x, const Entry& y) { return x.first < y.first; });
+    size_t n_unique = 0;
+    for (size_t k = 0; k < column.size(); ++k) {
+      if (n_unique > 0 && column[n_unique - 1].first == column[k].first) {
+        column[n_unique - 1].second += column[k].second;
+      } else {
+        column[n_unique++] = column[k];
+      }
+    }
+    column.resize(n_unique);
+    column.erase(std::remove_if(column.begin(), column.end(),
+                                [](const Entry& e) { return std::abs(e.second) < 1E-14; }),
+                 column.end());
+  }
+
+  MixedOperatorType op_;
+};
+
+template <typename _Scalar, size_t _RepSize, size_t _SiteSize, typename _StorageIndex>
+const size_t SymmetricHamiltonianBuilder<_Scalar, _RepSize, _SiteSize, _StorageIndex>::BlockSize;
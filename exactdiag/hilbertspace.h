@@ -5,10 +5,16 @@
 #include "utility/tuple_tools.h"
 
 #include "hilbertspace/quantumnumber.h"
+#include "hilbertspace/quantum_number_reach.h"
+#include "hilbertspace/quantum_number_packing.h"
 #include "hilbertspace/state.h"
 #include "hilbertspace/site.h"
 #include "hilbertspace/system.h"
+#include "hilbertspace/compact_state.h"
 #include "hilbertspace/basis_iterator.h"
+#include "hilbertspace/combination_basis.h"
+#include "hilbertspace/lin_table.h"
+#include "hilbertspace/basis_lookup.h"
 #include "hilbertspace/sector.h"
 
 
@@ -2,6 +2,7 @@
 #include "../global.h"
 
 #include "system.h"
+#include "compact_state.h"
 
 /*!
  *    BI(S, Q) -> BI(S, Q) -> BI(S, Q) -> null
@@ -39,21 +40,23 @@ class BasisIterator
 
 
   //! Constructor
-  BasisIterator(InvalidIterator) : system_(SystemType()), valid_(false) { }
+  BasisIterator(InvalidIterator) : system_(SystemType()), layout_(nullptr), top_level_(0), valid_(false) { }
 
   //! Constructor
   //! @param system
   //! @param QNS List of quantum numbers
   BasisIterator(const SystemType& system,
     QNS ... quantum_number)
-    : system_(system), quantum_number_(quantum_number...)
+    : system_(system), layout_(system.finalized() ? &system.layout() : nullptr)
+    , quantum_number_(quantum_number...)
     , cumulative_quantum_number_(system_.n_site()) // all zero at the beginning.
     , current_state_(system_.n_site())
+    , top_level_(system_.n_site() - 1)
     , valid_(true)
   {
     assert(system_.n_site() > 0);
     cumulative_quantum_number_[system_.n_site() - 1] = std::make_tuple(QNS(0)...);
-    if (!set_first_rec(system_.n_site() - 1)) {
+    if (!init_packing() || !set_first_rec(system_.n_site() - 1)) {
       //throw std::logic_error("Dictionary empty");
       valid_ = false;
     }
@@ -64,19 +67,52 @@ class BasisIterator
   //! @param QNS List of quantum numbers
   BasisIterator(const SystemType& system,
     QuantumNumberTuple const & quantum_number_tuple)
-    : system_(system), quantum_number_(quantum_number_tuple)
+    : system_(system), layout_(system.finalized() ? &system.layout() : nullptr)
+    , quantum_number_(quantum_number_tuple)
     , cumulative_quantum_number_(system_.n_site()) // all zero at the beginning.
     , current_state_(system_.n_site())
+    , top_level_(system_.n_site() - 1)
     , valid_(true)
   {
     assert(system_.n_site() > 0);
     cumulative_quantum_number_[system_.n_site() - 1] = std::make_tuple(QNS(0)...);
-    if (!set_first_rec(system_.n_site() - 1)) {
+    if (!init_packing() || !set_first_rec(system_.n_site() - 1)) {
       //throw std::logic_error("Dictionary empty");
       valid_ = false;
     }
   }
 
+  //! Constructor for a subtree.
+  //!
+  //! The states of the highest prefix.size() sites are fixed, and only the
+  //! remaining sites are iterated over. The order is the same as that of the
+  //! full iteration, restricted to the given prefix.
+  //! @param system
+  //! @param quantum_number_tuple Quantum numbers of the sector
+  //! @param prefix States of the sites n_site-prefix.size(), ..., n_site-1 (in this order)
+  BasisIterator(const SystemType& system,
+    QuantumNumberTuple const & quantum_number_tuple,
+    std::vector<size_t> const & prefix)
+    : system_(system), layout_(system.finalized() ? &system.layout() : nullptr)
+    , quantum_number_(quantum_number_tuple)
+    , cumulative_quantum_number_(system_.n_site()) // all zero at the beginning.
+    , current_state_(system_.n_site())
+    , top_level_(system_.n_site() - prefix.size() - 1)
+    , valid_(true)
+  {
+    assert(prefix.size() < system_.n_site());
+    QuantumNumberTuple qn = std::make_tuple(QNS(0)...);
+    for (size_t i = 0; i < prefix.size(); ++i) {
+      size_t i_site = top_level_ + 1 + i;
+      current_state_[i_site] = prefix[i];
+      qn = elementwise(qn) + elementwise(state_quantum_number(i_site, prefix[i]));
+    }
+    cumulative_quantum_number_[top_level_] = qn;
+    if (!init_packing() || !set_first_rec(top_level_)) {
+      valid_ = false;
+    }
+  }
+
   template <typename T1, typename T2>
   using first_t = T1;
 
@@ -109,39 +145,19 @@ class BasisIterator
     DEBUGRUN(for(auto c : current_state_) { std::cout << c << ", ";} std::cout << std::endl;)
 
     if (level == 0) {
-      auto const & site = system_.site(level);
-      for (current_state_[level] = 0; current_state_[level] < site.n_state() ; ++current_state_[level]) {
+      size_t n_state = this->n_state(level);
+      for (current_state_[level] = 0; current_state_[level] < n_state ; ++current_state_[level]) {
         DEBUGRUN(std::cout << "LOOP(" << level << ") : " << current_state_[level] << std::endl;)
-        auto const & state = site.state(current_state_[level]);
-        auto qn = elementwise(cumulative_quantum_number_[level])
-                  + elementwise(state.quantum_number());
-        if (qn == quantum_number_) { return true; }
+        if (complete()) { return true; }
       }
       return false;
     } else if (level >= system_.n_site()) {
       throw std::logic_error("level too high");
     } else { // 0 < level < n_site
-      auto const & site = system_.site(level);
-      for (current_state_[level] = 0; current_state_[level] < site.n_state() ; ++current_state_[level]) {
+      size_t n_state = this->n_state(level);
+      for (current_state_[level] = 0; current_state_[level] < n_state ; ++current_state_[level]) {
         DEBUGRUN(std::cout << "LOOP(" << level << ") : " << current_state_[level] << std::endl;)
-        auto const &state = site.state(current_state_[level]);
-        auto qn = elementwise(cumulative_quantum_number_[level])
-                  + elementwise(state.quantum_number());
-        {
-          auto min_qn = elementwise(qn)
-                        + elementwise(system_.min_quantum_number(level));
-          auto test_min = (elementwise(min_qn) <= elementwise(quantum_number_));
-          DEBUGRUN(std::cout << "Testing Min QN: " << min_qn << " vs. " << quantum_number_ << " => "<< (all(test_min))<< std::endl;)
-          if (!all(test_min)) { continue; }
-        }
-        {
-          auto max_qn = elementwise(qn)
-                        + elementwise(system_.max_quantum_number(level));
-          auto test_max = (elementwise(quantum_number_) <= elementwise(max_qn));
-          DEBUGRUN(std::cout << "Testing Max QN: " << max_qn << " vs. " << quantum_number_ << " => "<< (all(test_max))<< std::endl;)
-          if (!all(test_max)) { continue; }
-        }
-        cumulative_quantum_number_[level-1] = qn;
+        if (!descend(level)) { continue; }
         if (set_first_rec(level-1)) { return true; }
       }
       return false;
@@ -153,7 +169,7 @@ class BasisIterator
   {
     if (!valid_) { return *this; }
 
-    if( next(system_.n_site()-1)) {
+    if( next(top_level_)) {
       return *this;
     } else {
       valid_ = false;
@@ -161,48 +177,34 @@ class BasisIterator
     }
   }
 
+  //! @brief Advance to the next state, changing only the sites 0 to level.
+  //!
+  //! Same as advancing the sites below level first, and the site of level only if they are
+  //! exhausted, but walks up from site 0 instead of recursing down from level, so that the
+  //! usual step (site 0 or 1) does not go through all the levels.
   bool next(size_t level)
   {
     assert(valid_);
     DEBUGRUN(std::cout << "next(" << level << ") : ";)
     DEBUGRUN(for(auto c : current_state_) { std::cout << c << ", ";} std::cout << std::endl;)
 
-    if (level == 0) {
-      auto const & site = system_.site(level);
-      for (++current_state_[level]; current_state_[level] < site.n_state() ; ++current_state_[level]) {
-        auto const & state = site.state(current_state_[level]);
-        auto qn = elementwise(cumulative_quantum_number_[level])
-                  + elementwise(state.quantum_number());
-        if (qn == quantum_number_) { return true; }
-      }
-      return false;
-    } else if (level >= system_.n_site()) {
+    if (level >= system_.n_site()) {
       throw std::logic_error("level too high");
-    } else { // 0 < level < n_site
-      if (next(level-1)) { return true; }
-      auto const & site = system_.site(level);
-      for (++current_state_[level]; current_state_[level] < site.n_state() ; ++current_state_[level]) {
-        auto const &state = site.state(current_state_[level]);
-
-        auto qn = elementwise(cumulative_quantum_number_[level])
-                  + elementwise(state.quantum_number());
-        {
-          auto min_qn = elementwise(qn)
-                        + elementwise(system_.min_quantum_number(level));
-          auto test_min = (elementwise(min_qn) <= elementwise(quantum_number_));
-          if (!all(test_min)) { continue; }
-        }
-        {
-          auto max_qn = elementwise(qn)
-                        + elementwise(system_.max_quantum_number(level));
-          auto test_max = (elementwise(quantum_number_) <= elementwise(max_qn));
-          if (!all(test_max)) { continue; }
-        }
-        cumulative_quantum_number_[level-1] = qn;
-        if (set_first_rec(level-1)) { return true; }
+    }
+    {
+      size_t n_state = this->n_state(0);
+      for (++current_state_[0]; current_state_[0] < n_state ; ++current_state_[0]) {
+        if (complete()) { return true; }
+      }
+    }
+    for (size_t l = 1; l <= level; ++l) {
+      size_t n_state = this->n_state(l);
+      for (++current_state_[l]; current_state_[l] < n_state ; ++current_state_[l]) {
+        if (!descend(l)) { continue; }
+        if (set_first_rec(l-1)) { return true; }
       }
-      return false;
     }
+    return false;
   }
 
   bool operator==(const BasisIterator& iter) const {
@@ -225,8 +227,9 @@ class BasisIterator
     std::tuple<std::bitset<RepSize>, std::bitset<SiteSize> > ret;
     for (size_t i = 0 ; i < system_.n_site() ; ++i) {
       std::bitset<RepSize> vr(current_state_[i]);
-      std::bitset<RepSize> vf(system_.site(i).state(current_state_[i]).fermion_parity());
-      vr <<= system_.start_digit(i);
+      std::bitset<RepSize> vf(layout_ ? layout_->state_fermion_parity[i][current_state_[i]]
+                                      : system_.site(i).state(current_state_[i]).fermion_parity());
+      vr <<= (layout_ ? layout_->start_digit[i] : system_.start_digit(i));
       vf <<= i;
       //auto func = system_.get_state_representation<RepSize, SiteSize>;
       //auto v = func(i, current_state_[i]);
@@ -237,14 +240,93 @@ class BasisIterator
     return ret;
   };
 
+  //! Compact representation of the current state (see CompactRep).
+  typename CompactRep<RepSize>::type word() const
+  {
+    using Word = typename CompactRep<RepSize>::type;
+    Word ret(0);
+    for (size_t i = 0 ; i < system_.n_site() ; ++i) {
+      ret |= Word(current_state_[i]) << (layout_ ? layout_->start_digit[i] : system_.start_digit(i));
+    }
+    return ret;
+  }
+
   bool valid() const { return valid_; }
 
  private:
+  //!< Layout queries: tables of a finalized system, or computed by the System otherwise.
+  size_t n_state(size_t i_site) const {
+    return layout_ ? layout_->state_quantum_number[i_site].size() : system_.site(i_site).n_state();
+  }
+
+  QuantumNumberTuple const & state_quantum_number(size_t i_site, size_t i_state) const {
+    return layout_ ? layout_->state_quantum_number[i_site][i_state]
+                   : system_.site(i_site).state(i_state).quantum_number();
+  }
+
+  //! Whether the sites 0 to < i_site can complete qn to the quantum numbers of the sector.
+  bool reachable(size_t i_site, const QuantumNumberTuple& qn) const {
+    return layout_ ? layout_->reach[i_site].reachable(qn, quantum_number_)
+                   : system_.reach(i_site).reachable(qn, quantum_number_);
+  }
+  //!>
+
+  //! @brief Set up the packed quantum numbers (see QuantumNumberPacking), if the system allows it.
+  //!
+  //! Otherwise (Z_n quantum numbers, or too wide ranges) the tuples of quantum numbers are used.
+  //! @return false if the sector is empty.
+  bool init_packing() {
+    packing_ = layout_ ? layout_->packing : system_.packing();
+    if (!packing_->valid()) {
+      packing_.reset();
+      return true;
+    }
+    if (!packing_->bounds(quantum_number_, packed_target_, packed_lower_)) { return false; }
+    cumulative_packed_.assign(system_.n_site(), 0);
+    for (size_t i_site = top_level_ + 1; i_site < system_.n_site(); ++i_site) {
+      cumulative_packed_[top_level_] += packing_->offset(i_site, current_state_[i_site]);
+    }
+    return true;
+  }
+
+  //! Whether the state of site 0 completes the quantum numbers of the sector.
+  bool complete() const {
+    if (packing_) {
+      return cumulative_packed_[0] + packing_->offset(0, current_state_[0]) == packed_target_;
+    }
+    auto qn = elementwise(cumulative_quantum_number_[0])
+              + elementwise(state_quantum_number(0, current_state_[0]));
+    return qn == quantum_number_;
+  }
+
+  //! @brief Whether the sites below level can still complete the state of level to the quantum
+  //! numbers of the sector (bounds of U(1), residues of Z_n). If so, the quantum numbers of the
+  //! sites >= level are stored for level - 1.
+  bool descend(size_t level) {
+    if (packing_) {
+      uint64_t p = cumulative_packed_[level] + packing_->offset(level, current_state_[level]);
+      if (!packing_->within(p, packed_lower_[level], packed_target_)) { return false; }
+      cumulative_packed_[level - 1] = p;
+      return true;
+    }
+    QuantumNumberTuple qn = elementwise(cumulative_quantum_number_[level])
+                            + elementwise(state_quantum_number(level, current_state_[level]));
+    if (!reachable(level, qn)) { return false; }
+    cumulative_quantum_number_[level - 1] = qn;
+    return true;
+  }
+
   const SystemType& system_;
+  const typename SystemType::Layout* layout_; //!< null if the system is not finalized.
   const QuantumNumberTuple quantum_number_;
 
   std::vector<QuantumNumberTuple> cumulative_quantum_number_;
+  std::shared_ptr<const typename SystemType::PackingType> packing_; //!< null if not packed.
+  uint64_t packed_target_;
+  std::vector<uint64_t> packed_lower_;      //!< lower bound of the packed sum of the sites >= level
+  std::vector<uint64_t> cumulative_packed_; //!< packed sum of the sites > level, as cumulative_quantum_number_
   std::vector< size_t > current_state_;
+  size_t top_level_; //!< highest level which is iterated over
   bool valid_;
   //std::tuple< std::bitset<RepSize>, std::bitset<SiteSize> > current_;
 };
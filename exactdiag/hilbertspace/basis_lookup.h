@@ -0,0 +1,268 @@
+#pragma once
+#include "../global.h"
+
+#include "system.h"
+#include "lin_table.h"
+#include "compact_state.h"
+
+//! @file basis_lookup.h
+//! @brief Lookup policies which map a representation to its index in a sector.
+//!
+//! Every policy has the interface
+//!
+//!     Policy(const SystemType& system, const QuantumNumberTuple& qn, const BasisType& basis);
+//!     size_t size() const;                   // dimension of the sector
+//!     size_t find(const Word& w) const;      // index, or npos if absent
+//!     size_t memory_usage() const;           // bytes used by the index
+//!     static const bool CanUnrank;           // whether unrank(idx) is available
+//!
+//! and is passed to BasicSectorGenerator as a template template parameter.
+//! The basis given to the constructor is a vector of compact representations
+//! (see CompactRep) in ascending order. A policy which can unrank may also take the basis
+//! as an rvalue and keep it (see LinTableLookup).
+
+
+//! @class HashLookup
+//! @brief Lookup with std::unordered_map.
+template <size_t _RepSize, size_t _SiteSize, typename ... QNS>
+class HashLookup
+{
+ public:
+  static const size_t RepSize = _RepSize;
+  static const size_t SiteSize = _SiteSize;
+  static const size_t npos = static_cast<size_t>(-1);
+  static const bool CanUnrank = false;
+
+  using SystemType = System<QNS...>;
+  using QuantumNumberTuple = typename SystemType::QuantumNumberTuple;
+  using Rep = CompactRep<RepSize>;
+  using Word = typename Rep::type;
+  using BasisType = std::vector<Word>;
+
+  HashLookup() { }
+
+  HashLookup(const SystemType&, const QuantumNumberTuple&, const BasisType& basis)
+  {
+    map_.reserve(basis.size());
+    for (size_t i = 0; i < basis.size(); ++i) {
+      map_[basis[i]] = i;
+    }
+  }
+
+  size_t size() const { return map_.size(); }
+
+  size_t find(const Word& w) const {
+    auto found = map_.find(w);
+    return (found == map_.end()) ? npos : found->second;
+  }
+
+  //! Approximate number of bytes (nodes with a next pointer, and the bucket array).
+  size_t memory_usage() const {
+    return map_.size() * (sizeof(Word) + sizeof(size_t) + 2 * sizeof(void*))
+           + map_.bucket_count() * sizeof(void*);
+  }
+
+ private:
+  std::unordered_map<Word, size_t, typename Rep::Hash> map_;
+};
+
+
+//! @class SortedArrayLookup
+//! @brief Binary search in a sorted contiguous array of the representations.
+template <size_t _RepSize, size_t _SiteSize, typename ... QNS>
+class SortedArrayLookup
+{
+ public:
+  static const size_t RepSize = _RepSize;
+  static const size_t SiteSize = _SiteSize;
+  static const size_t npos = static_cast<size_t>(-1);
+  static const bool CanUnrank = false;
+
+  using SystemType = System<QNS...>;
+  using QuantumNumberTuple = typename SystemType::QuantumNumberTuple;
+  using Rep = CompactRep<RepSize>;
+  using Word = typename Rep::type;
+  using BasisType = std::vector<Word>;
+
+  SortedArrayLookup() { }
+
+  SortedArrayLookup(const SystemType&, const QuantumNumberTuple&, const BasisType& basis)
+      : keys_(basis)
+  {
+    assert(std::is_sorted(keys_.begin(), keys_.end(), &Rep::less));
+  }
+
+  size_t size() const { return keys_.size(); }
+
+  size_t find(const Word& w) const {
+    auto found = std::lower_bound(keys_.begin(), keys_.end(), w, &Rep::less);
+    if (found == keys_.end() || !(*found == w)) { return npos; }
+    return static_cast<size_t>(found - keys_.begin());
+  }
+
+  size_t memory_usage() const { return keys_.size() * sizeof(Word); }
+
+ private:
+  BasisType keys_;
+};
+
+
+//! @class DirectTableLookup
+//! @brief Dense table indexed directly by the representation.
+//!
+//! The table has 2^n_digit() entries, so it is restricted to n_digit() <= MaxDigit.
+template <size_t _RepSize, size_t _SiteSize, typename ... QNS>
+class DirectTableLookup
+{
+ public:
+  static const size_t RepSize = _RepSize;
+  static const size_t SiteSize = _SiteSize;
+  static const size_t npos = static_cast<size_t>(-1);
+  static const bool CanUnrank = false;
+  static const size_t MaxDigit = 30;
+
+  using SystemType = System<QNS...>;
+  using QuantumNumberTuple = typename SystemType::QuantumNumberTuple;
+  using Rep = CompactRep<RepSize>;
+  using Word = typename Rep::type;
+  using BasisType = std::vector<Word>;
+
+  DirectTableLookup() : size_(0) { }
+
+  DirectTableLookup(const SystemType& system, const QuantumNumberTuple&, const BasisType& basis)
+      : size_(basis.size())
+  {
+    if (system.n_digit() > MaxDigit) {
+      throw std::length_error("DirectTableLookup(): representation too long");
+    }
+    table_.assign(size_t(1) << system.n_digit(), Absent);
+    for (size_t i = 0; i < basis.size(); ++i) {
+      table_[Rep::low_bits(basis[i], MaxDigit)] = static_cast<uint32_t>(i);
+    }
+  }
+
+  size_t size() const { return size_; }
+
+  size_t find(const Word& w) const {
+    if (!Rep::is_zero(w >> MaxDigit)) { return npos; }
+    uint64_t key = Rep::low_bits(w, MaxDigit);
+    if (key >= table_.size()) { return npos; }
+    uint32_t idx = table_[key];
+    return (idx == Absent) ? npos : idx;
+  }
+
+  size_t memory_usage() const { return table_.size() * sizeof(uint32_t); }
+
+ private:
+  static const uint32_t Absent = static_cast<uint32_t>(-1);
+  size_t size_;
+  std::vector<uint32_t> table_;
+};
+
+
+//! @class LinTableLookup
+//! @brief Lookup with a LinTable. Does not need the basis, and can unrank.
+//!
+//! The tables of a LinTable grow with the number of digits, not with the dimension, so given
+//! a basis this falls back to a binary search in the basis when the tables would have more
+//! than MaxTableRatio entries per basis state (beyond MinTableEntry), or could not be built
+//! at all. The basis is then kept by the index, and taken over if passed as an rvalue (as
+//! BasicSectorGenerator does, whose Sector then serves word() from unrank()), so that it is
+//! stored only once. Without a basis (generate_index) the LinTable is always built.
+template <size_t _RepSize, size_t _SiteSize, typename ... QNS>
+class LinTableLookup
+{
+ public:
+  using LinTableType = LinTable<_RepSize, _SiteSize, QNS...>;
+  using SystemType = typename LinTableType::SystemType;
+  using QuantumNumberTuple = typename LinTableType::QuantumNumberTuple;
+  using Rep = CompactRep<_RepSize>;
+  using Word = typename LinTableType::Word;
+  using BasisType = std::vector<Word>;
+  static const size_t npos = LinTableType::npos;
+  static const bool CanUnrank = true;
+
+  //! Largest number of table entries per basis state.
+  static const size_t MaxTableRatio = 4;
+
+  //! Number of table entries which is always acceptable.
+  static const size_t MinTableEntry = 1 << 16;
+
+  LinTableLookup() : use_table_(true) { }
+
+  LinTableLookup(const SystemType& system, const QuantumNumberTuple& qn)
+      : use_table_(true), table_(system, qn)
+  {
+  }
+
+  //! The basis is copied if the index falls back to it.
+  LinTableLookup(const SystemType& system, const QuantumNumberTuple& qn, const BasisType& basis)
+      : use_table_(use_table(system, basis.size()))
+  {
+    if (use_table_) {
+      table_ = LinTableType(system, qn);
+    } else {
+      keys_ = basis;
+    }
+  }
+
+  //! The basis is moved into the index if it falls back to it, and left unchanged otherwise.
+  LinTableLookup(const SystemType& system, const QuantumNumberTuple& qn, BasisType&& basis)
+      : use_table_(use_table(system, basis.size()))
+  {
+    if (use_table_) {
+      table_ = LinTableType(system, qn);
+    } else {
+      keys_.swap(basis);
+    }
+  }
+
+  //! Whether the index is a LinTable (otherwise the sorted basis).
+  bool uses_table() const { return use_table_; }
+
+  size_t size() const { return use_table_ ? table_.size() : keys_.size(); }
+
+  size_t find(const Word& w) const {
+    if (use_table_) { return table_.rank(w); }
+    auto found = std::lower_bound(keys_.begin(), keys_.end(), w, &Rep::less);
+    if (found == keys_.end() || !(*found == w)) { return npos; }
+    return static_cast<size_t>(found - keys_.begin());
+  }
+
+  //! Representation of the basis state of the given index.
+  Word unrank(size_t idx) const { return use_table_ ? table_.unrank(idx) : keys_[idx]; }
+
+  size_t memory_usage() const { return use_table_ ? table_.memory_usage() : keys_.size() * sizeof(Word); }
+
+ private:
+  static bool use_table(const SystemType& system, size_t n_basis) {
+    size_t half = LinTableType::max_half_digit(system);
+    if (half > LinTableType::MaxHalfDigit) { return false; }
+    return (size_t(2) << half) <= std::max<size_t>(MinTableEntry, MaxTableRatio * n_basis);
+  }
+
+  bool use_table_;
+  LinTableType table_;
+  BasisType keys_;     //!< sorted basis, if not use_table_
+};
+
+template <size_t _RepSize, size_t _SiteSize, typename ... QNS>
+const size_t HashLookup<_RepSize, _SiteSize, QNS...>::npos;
+
+template <size_t _RepSize, size_t _SiteSize, typename ... QNS>
+const size_t SortedArrayLookup<_RepSize, _SiteSize, QNS...>::npos;
+
+template <size_t _RepSize, size_t _SiteSize, typename ... QNS>
+const size_t DirectTableLookup<_RepSize, _SiteSize, QNS...>::npos;
+
+template <size_t _RepSize, size_t _SiteSize, typename ... QNS>
+const uint32_t DirectTableLookup<_RepSize, _SiteSize, QNS...>::Absent;
+
+template <size_t _RepSize, size_t _SiteSize, typename ... QNS>
+const size_t LinTableLookup<_RepSize, _SiteSize, QNS...>::npos;
+
+template <size_t _RepSize, size_t _SiteSize, typename ... QNS>
+const size_t LinTableLookup<_RepSize, _SiteSize, QNS...>::MaxTableRatio;
+
+template <size_t _RepSize, size_t _SiteSize, typename ... QNS>
+const size_t LinTableLookup<_RepSize, _SiteSize, QNS...>::MinTableEntry;
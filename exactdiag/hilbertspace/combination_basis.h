@@ -0,0 +1,286 @@
+#pragma once
+#include "../global.h"
+
+#include "../utility/parallel.h"
+#include "system.h"
+#include "compact_state.h"
+
+//! @class CombinationBasis
+//!
+//! @brief Basis of a sector of two-state sites, generated as products of combinations.
+//!
+//! If every site has two states (one digit), the sites fall into species of the sites with
+//! the same change of the quantum numbers from state 0 to state 1 (e.g. the up and the down
+//! orbitals of spinful fermions, or all the sites of spinless fermions or of a spin-1/2 chain).
+//! The quantum numbers of a basis state only depend on the numbers n_s of sites in state 1 in
+//! every species s,
+//!
+//!     Q = sum_i q_i(0) + sum_s n_s dq_s
+//!
+//! so the basis of a sector is the union, over the count vectors (n_s) which give Q, of the
+//! products of the combinations of n_s sites of every species. The combinations are generated
+//! with Gosper's next-combination bit trick, scattered to the digits of the sites, and the
+//! products are sorted (by a radix sort on the digits, for words of up to 64 bits), which
+//! gives the same ascending basis as BasisIterator without visiting any state outside of the
+//! sector.
+//!
+//! @tparam _RepSize Number of bits of the Rep
+//! @tparam QNS List of quantum number types.
+template <size_t _RepSize, typename ... QNS>
+class CombinationBasis
+{
+ public:
+  static const size_t RepSize = _RepSize;
+  using SystemType = System<QNS...>;
+  using QuantumNumberTuple = typename SystemType::QuantumNumberTuple;
+  using Rep = CompactRep<RepSize>;
+  using Word = typename Rep::type;
+  using BasisType = std::vector<Word>;
+
+  //! Largest number of sites of a species (the combinations are 64-bit masks).
+  static const size_t MaxSpeciesSite = 62;
+
+  //! Largest number of count vectors tried per sector (against many species of a few sites).
+  static const size_t MaxCountVector = 1 << 16;
+
+  //! Number of digits sorted per pass of the radix sort.
+  static const size_t RadixBits = 11;
+
+  //! Smallest number of words written per task of generate() (unless a task is a whole
+  //! count vector).
+  static const size_t MinTaskSize = 1 << 12;
+
+  //! Constructor
+  //! @param system %System
+  CombinationBasis(const SystemType& system)
+      : valid_(false), n_digit_(system.n_digit()), base_(std::make_tuple(QNS(0)...))
+  {
+    if (system.n_site() == 0 || n_digit_ > RepSize) { return; }
+    for (size_t i_site = 0; i_site < system.n_site(); ++i_site) {
+      auto const & site = system.site(i_site);
+      if (site.n_state() != 2) { return; }
+      QuantumNumberTuple q0 = site.state(0).quantum_number();
+      QuantumNumberTuple dq = elementwise(site.state(1).quantum_number()) - elementwise(q0);
+      base_ = elementwise(base_) + elementwise(q0);
+      size_t s = 0;
+      while (s < delta_.size() && !(delta_[s] == dq)) { ++s; }
+      if (s == delta_.size()) {
+        delta_.push_back(dq);
+        digit_.emplace_back();
+      }
+      if (digit_[s].size() == MaxSpeciesSite) { return; }
+      digit_[s].push_back(system.start_digit(i_site));
+    }
+    valid_ = true;
+  }
+
+  //! Whether all the sites have two states (and no species is too large).
+  bool valid() const { return valid_; }
+
+  //! Number of species.
+  size_t n_species() const { return delta_.size(); }
+
+  //! Digits of the sites of a species, ascending.
+  const std::vector<size_t> & species_digits(size_t s) const { return digit_[s]; }
+
+  //! Change of the quantum numbers of a site of the species from state 0 to state 1.
+  const QuantumNumberTuple & species_delta(size_t s) const { return delta_[s]; }
+
+  //! @brief Basis of the sector with the given quantum numbers, in ascending order.
+  //!
+  //! The products are written at precomputed offsets, in tasks of consecutive combinations of
+  //! the first species for one count vector, which run on n_thread threads. For words of up
+  //! to 64 bits the radix sort is split too: the words are scattered into buckets of their
+  //! highest digits, which are then sorted independently. Wider words are sorted serially.
+  //! @param n_thread Number of threads (0 for default_n_thread()).
+  //! @return false (and basis unchanged) if not valid(), or if there are too many count vectors.
+  bool generate(const QuantumNumberTuple& qn, BasisType& basis, size_t n_thread = 1) const
+  {
+    if (!valid_) { return false; }
+    if (n_thread == 0) { n_thread = default_n_thread(); }
+    size_t n_count_vector = 1;
+    for (auto const & digits : digit_) {
+      n_count_vector *= digits.size() + 1;
+      if (n_count_vector > MaxCountVector) { return false; }
+    }
+
+    std::vector<std::vector<size_t>> solutions;
+    std::vector<size_t> count(delta_.size(), 0);
+    solve(0, base_, qn, count, solutions);
+
+    std::vector<std::vector<BasisType>> combinations(solutions.size());
+    std::vector<ProductTask> tasks;
+    size_t n_basis = 0;
+    for (size_t i_solution = 0; i_solution < solutions.size(); ++i_solution) {
+      auto & species = combinations[i_solution];
+      size_t n_rest = 1;
+      for (size_t s = 0; s < delta_.size(); ++s) {
+        species.push_back(species_combinations(s, solutions[i_solution][s]));
+        if (s > 0) { n_rest *= species[s].size(); }
+      }
+      size_t n_first = std::max<size_t>(1, MinTaskSize / std::max<size_t>(1, n_rest));
+      for (size_t first = 0; first < species[0].size(); first += n_first) {
+        size_t last = std::min(species[0].size(), first + n_first);
+        tasks.push_back(ProductTask{i_solution, first, last, n_basis});
+        n_basis += (last - first) * n_rest;
+      }
+    }
+
+    BasisType ret(n_basis);
+    parallel_for(0, tasks.size(), n_thread, [&](size_t i_task) {
+      auto const & task = tasks[i_task];
+      auto const & species = combinations[task.solution];
+      Word* out = ret.data() + task.offset;
+      for (size_t i = task.first; i < task.last; ++i) { product(species, 1, species[0][i], out); }
+    });
+    // a single species and count vector is generated in ascending order already.
+    if (solutions.size() > 1 || delta_.size() > 1) {
+      sort(ret, n_thread, std::integral_constant<bool, (RepSize <= 64)>());
+    }
+    basis.swap(ret);
+    return true;
+  }
+
+ private:
+  //! Combinations first to last of the first species, for the count vector of the given
+  //! number, written from offset on.
+  struct ProductTask
+  {
+    size_t solution;
+    size_t first;
+    size_t last;
+    size_t offset;
+  };
+
+  //! Count vectors (n_s) with base + sum_s n_s dq_s = qn.
+  void solve(size_t s, const QuantumNumberTuple& partial, const QuantumNumberTuple& qn,
+             std::vector<size_t>& count, std::vector<std::vector<size_t>>& solutions) const
+  {
+    if (s == delta_.size()) {
+      if (partial == qn) { solutions.push_back(count); }
+      return;
+    }
+    QuantumNumberTuple q = partial;
+    for (count[s] = 0; count[s] <= digit_[s].size(); ++count[s]) {
+      solve(s + 1, q, qn, count, solutions);
+      q = elementwise(q) + elementwise(delta_[s]);
+    }
+  }
+
+  //! Words of all the combinations of n sites of species s, in ascending order (Gosper's hack).
+  BasisType species_combinations(size_t s, size_t n) const
+  {
+    auto const & digits = digit_[s];
+    size_t m = digits.size();
+    uint64_t end = uint64_t(1) << m;
+    BasisType ret;
+    for (uint64_t c = (uint64_t(1) << n) - 1; c < end;) {
+      Word w(0);
+      for (uint64_t bits = c; bits != 0; bits &= bits - 1) {
+        w |= Word(1) << digits[__builtin_ctzll(bits)];
+      }
+      ret.push_back(w);
+      if (c == 0) { break; }
+      uint64_t u = c & (~c + 1);
+      uint64_t v = c + u;
+      c = v + (((v ^ c) / u) >> 2);
+    }
+    return ret;
+  }
+
+  //! Sort the words of at most 64 bits, on n_thread threads.
+  void sort(BasisType& basis, size_t n_thread, std::true_type) const
+  {
+    const size_t n_bucket = size_t(1) << RadixBits;
+    size_t n = basis.size();
+    BasisType buffer(n);
+    if (n_thread == 1 || n_digit_ <= RadixBits) {
+      radix_sort(basis.data(), buffer.data(), n, n_digit_);
+      return;
+    }
+
+    // scatter on the highest RadixBits digits, each chunk to its own part of every bucket.
+    size_t top = n_digit_ - RadixBits;
+    size_t n_chunk = n_thread;
+    std::vector<std::vector<size_t>> position(n_chunk, std::vector<size_t>(n_bucket, 0));
+    parallel_for(0, n_chunk, n_thread, [&](size_t i_chunk) {
+      for (size_t i = i_chunk * n / n_chunk; i < (i_chunk + 1) * n / n_chunk; ++i) {
+        ++position[i_chunk][basis[i] >> top];
+      }
+    });
+    std::vector<size_t> bucket_start(n_bucket + 1);
+    size_t pos = 0;
+    for (size_t b = 0; b < n_bucket; ++b) {
+      bucket_start[b] = pos;
+      for (size_t i_chunk = 0; i_chunk < n_chunk; ++i_chunk) {
+        size_t n_word = position[i_chunk][b];
+        position[i_chunk][b] = pos;
+        pos += n_word;
+      }
+    }
+    bucket_start[n_bucket] = pos;
+    parallel_for(0, n_chunk, n_thread, [&](size_t i_chunk) {
+      for (size_t i = i_chunk * n / n_chunk; i < (i_chunk + 1) * n / n_chunk; ++i) {
+        buffer[position[i_chunk][basis[i] >> top]++] = basis[i];
+      }
+    });
+    parallel_for(0, n_bucket, n_thread, [&](size_t b) {
+      size_t first = bucket_start[b];
+      radix_sort(buffer.data() + first, basis.data() + first, bucket_start[b + 1] - first, top);
+    });
+    basis.swap(buffer);
+  }
+
+  void sort(BasisType& basis, size_t, std::false_type) const
+  {
+    std::sort(basis.begin(), basis.end(), &Rep::less);
+  }
+
+  //! @brief LSD radix sort of n words of at most 64 bits on their lowest n_sort_digit digits,
+  //! RadixBits digits at a time (the higher digits must be equal).
+  //! @param scratch Space for n words.
+  void radix_sort(Word* words, Word* scratch, size_t n, size_t n_sort_digit) const
+  {
+    if (n < 2) { return; }
+    const size_t n_bucket = size_t(1) << RadixBits;
+    std::vector<size_t> start(n_bucket + 1);
+    Word* from = words;
+    Word* to = scratch;
+    for (size_t shift = 0; shift < n_sort_digit; shift += RadixBits) {
+      std::fill(start.begin(), start.end(), 0);
+      for (size_t i = 0; i < n; ++i) { ++start[((from[i] >> shift) & (n_bucket - 1)) + 1]; }
+      for (size_t b = 0; b < n_bucket; ++b) { start[b + 1] += start[b]; }
+      for (size_t i = 0; i < n; ++i) { to[start[(from[i] >> shift) & (n_bucket - 1)]++] = from[i]; }
+      std::swap(from, to);
+    }
+    if (from != words) { std::copy(from, from + n, words); }
+  }
+
+  //! Write the ORs of one combination of every species from s on, advancing out.
+  void product(const std::vector<BasisType>& combinations, size_t s, const Word& w, Word*& out) const
+  {
+    if (s == combinations.size()) {
+      *out++ = w;
+      return;
+    }
+    for (auto const & c : combinations[s]) { product(combinations, s + 1, w | c, out); }
+  }
+
+  bool valid_;
+  size_t n_digit_;
+  QuantumNumberTuple base_;                   //!< quantum numbers with all the sites in state 0
+  std::vector<QuantumNumberTuple> delta_;     //!< of every species
+  std::vector<std::vector<size_t>> digit_;    //!< digits of the sites of every species
+};
+
+template <size_t _RepSize, typename ... QNS>
+const size_t CombinationBasis<_RepSize, QNS...>::MaxSpeciesSite;
+
+template <size_t _RepSize, typename ... QNS>
+const size_t CombinationBasis<_RepSize, QNS...>::MaxCountVector;
+
+template <size_t _RepSize, typename ... QNS>
+const size_t CombinationBasis<_RepSize, QNS...>::RadixBits;
+
+template <size_t _RepSize, typename ... QNS>
+const size_t CombinationBasis<_RepSize, QNS...>::MinTaskSize;
@@ -0,0 +1,204 @@
+#pragma once
+#include "../global.h"
+
+#include "system.h"
+
+namespace detail {
+__extension__ typedef unsigned __int128 uint128_t;
+}
+
+//! @class CompactRep
+//!
+//! @brief Machine-word type for a binary representation of RepSize bits.
+//!
+//! The type is chosen automatically: uint64_t for RepSize <= 64, unsigned __int128
+//! for RepSize <= 128, and std::bitset<RepSize> (which is a fixed array of words) otherwise.
+//! All of them support the bitwise operators, shifts and equality.
+//! @tparam RepSize Length of binary representation
+template <size_t RepSize, typename Enable = void>
+struct CompactRep
+{
+  using type = std::bitset<RepSize>;
+
+  static type from_bitset(const std::bitset<RepSize>& b) { return b; }
+  static std::bitset<RepSize> to_bitset(const type& w) { return w; }
+  static size_t popcount(const type& w) { return w.count(); }
+  static bool is_zero(const type& w) { return w.none(); }
+
+  //! Lowest n_bit (<= 64) bits as an integer.
+  static uint64_t low_bits(const type& w, size_t n_bit) {
+    assert(n_bit <= 64);
+    if (n_bit == 0) { return 0; }
+    return ((w << (RepSize - n_bit)) >> (RepSize - n_bit)).to_ullong();
+  }
+
+  //! Numerical order of the representations (the order of BasisIterator).
+  static bool less(const type& x, const type& y) {
+    for (size_t i = RepSize; i > 0; --i) {
+      if (x[i - 1] != y[i - 1]) { return y[i - 1]; }
+    }
+    return false;
+  }
+
+  struct Hash {
+    size_t operator()(const type& w) const { return std::hash<type>()(w); }
+  };
+};
+
+template <size_t RepSize>
+struct CompactRep<RepSize, detail::enable_if_t<(RepSize <= 64)>>
+{
+  using type = uint64_t;
+
+  static type from_bitset(const std::bitset<RepSize>& b) { return b.to_ullong(); }
+  static std::bitset<RepSize> to_bitset(const type& w) { return std::bitset<RepSize>(w); }
+  static size_t popcount(const type& w) { return static_cast<size_t>(__builtin_popcountll(w)); }
+  static bool is_zero(const type& w) { return w == 0; }
+
+  static uint64_t low_bits(const type& w, size_t n_bit) {
+    assert(n_bit <= 64);
+    return (n_bit == 64) ? w : (w & ((uint64_t(1) << n_bit) - 1));
+  }
+
+  static bool less(const type& x, const type& y) { return x < y; }
+
+  struct Hash {
+    size_t operator()(const type& w) const { return std::hash<uint64_t>()(w); }
+  };
+};
+
+template <size_t RepSize>
+struct CompactRep<RepSize, detail::enable_if_t<(RepSize > 64 && RepSize <= 128)>>
+{
+  using type = detail::uint128_t;
+
+  static type from_bitset(const std::bitset<RepSize>& b) {
+    uint64_t lo = (b & std::bitset<RepSize>(~uint64_t(0))).to_ullong();
+    uint64_t hi = (b >> 64).to_ullong();
+    return (type(hi) << 64) | type(lo);
+  }
+  static std::bitset<RepSize> to_bitset(const type& w) {
+    return (std::bitset<RepSize>(static_cast<uint64_t>(w >> 64)) << 64)
+           | std::bitset<RepSize>(static_cast<uint64_t>(w));
+  }
+  static size_t popcount(const type& w) {
+    return static_cast<size_t>(__builtin_popcountll(static_cast<uint64_t>(w))
+                               + __builtin_popcountll(static_cast<uint64_t>(w >> 64)));
+  }
+  static bool is_zero(const type& w) { return w == 0; }
+
+  static uint64_t low_bits(const type& w, size_t n_bit) {
+    assert(n_bit <= 64);
+    return (n_bit == 64) ? static_cast<uint64_t>(w)
+                         : (static_cast<uint64_t>(w) & ((uint64_t(1) << n_bit) - 1));
+  }
+
+  static bool less(const type& x, const type& y) { return x < y; }
+
+  struct Hash {
+    size_t operator()(const type& w) const {
+      return std::hash<uint64_t>()(static_cast<uint64_t>(w) ^ (static_cast<uint64_t>(w >> 64) * 0x9e3779b97f4a7c15ULL));
+    }
+  };
+};
+
+
+//! @class CompactCodec
+//!
+//! @brief Conversion between the compact representation of a basis state and its bitsets.
+//!
+//! A basis state is stored as the word of its representation only. Its fermion parity
+//! bitset is derived from the word: the parity of every site is the parity of the
+//! popcount of some of its digits (plus a constant), which is found from the %Site's states.
+//!
+//! @tparam _RepSize Length of binary representation
+//! @tparam _SiteSize Number of sites
+template <size_t _RepSize, size_t _SiteSize>
+class CompactCodec
+{
+ public:
+  static const size_t RepSize = _RepSize;
+  static const size_t SiteSize = _SiteSize;
+  using Rep = CompactRep<RepSize>;
+  using Word = typename Rep::type;
+  using BitRep = std::bitset<RepSize>;
+  using BitSite = std::bitset<SiteSize>;
+
+  //! Constructor of an empty codec.
+  CompactCodec() : fermion_mask_(0) { }
+
+  //! Constructor
+  //! @param system
+  //! @throw std::domain_error if the fermion parity of a site is not linear in its digits.
+  template <typename ... QNS>
+  CompactCodec(const System<QNS...>& system)
+      : fermion_mask_(0)
+  {
+    assert(system.n_digit() <= RepSize);
+    assert(system.n_site() <= SiteSize);
+    for (size_t i_site = 0; i_site < system.n_site(); ++i_site) {
+      auto const & site = system.site(i_site);
+      size_t nd = site.n_digit();
+      bool offset = site.state(0).fermion_parity();
+      bool found = false;
+      uint64_t parity_mask = 0;
+      for (uint64_t m = 0; m < (uint64_t(1) << nd) && !found; ++m) {
+        found = true;
+        for (size_t i_state = 0; i_state < site.n_state(); ++i_state) {
+          bool parity = ((__builtin_popcountll(i_state & m) & 1) != 0) != offset;
+          if (parity != site.state(i_state).fermion_parity()) { found = false; break; }
+        }
+        parity_mask = m;
+      }
+      if (!found) {
+        throw std::domain_error("CompactCodec(): fermion parity of a site is not linear in its digits");
+      }
+      Word m = Word(parity_mask) << system.start_digit(i_site);
+      site_parity_mask_.push_back(m);
+      site_parity_offset_.push_back(offset);
+      fermion_mask_ |= m;
+    }
+  }
+
+  //! Word of the given representation.
+  Word encode(const BitRep& rep) const { return Rep::from_bitset(rep); }
+
+  //! Representation of the given word.
+  BitRep rep(const Word& w) const { return Rep::to_bitset(w); }
+
+  //! Fermion parity of every site.
+  BitSite fermion_parity(const Word& w) const {
+    BitSite ret;
+    for (size_t i_site = 0; i_site < site_parity_mask_.size(); ++i_site) {
+      ret.set(i_site, ((Rep::popcount(w & site_parity_mask_[i_site]) & 1) != 0) != site_parity_offset_[i_site]);
+    }
+    return ret;
+  }
+
+  //! Representation and fermion parity, as used by PureOperator.
+  std::tuple<BitRep, BitSite> decode(const Word& w) const {
+    return std::make_tuple(rep(w), fermion_parity(w));
+  }
+
+  //! Digits whose popcount parity (plus the offset) is the total fermion parity of the given sites.
+  //! @return (digit mask, offset)
+  std::tuple<Word, bool> parity_check(const BitSite& sites) const {
+    Word mask(0);
+    bool offset = false;
+    for (size_t i_site = 0; i_site < site_parity_mask_.size(); ++i_site) {
+      if (sites.test(i_site)) {
+        mask |= site_parity_mask_[i_site];
+        offset = (offset != site_parity_offset_[i_site]);
+      }
+    }
+    return std::make_tuple(mask, offset);
+  }
+
+  //! Digits which carry fermion parity.
+  const Word & fermion_mask() const { return fermion_mask_; }
+
+ private:
+  Word fermion_mask_;
+  std::vector<Word> site_parity_mask_;
+  std::vector<bool> site_parity_offset_;
+};
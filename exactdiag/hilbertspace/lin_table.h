@@ -0,0 +1,222 @@
+#pragma once
+#include "../global.h"
+
+#include "system.h"
+#include "compact_state.h"
+
+//! @class LinTable
+//!
+//! @brief Combinatorial ranking of the basis of a sector (Lin table).
+//!
+//! The sites are split into a lower part (sites below n_lower_site()) and an upper part,
+//! and a representation is ranked with two table lookups
+//!
+//!     rank(rep) = upper[upper digits of rep].rank + lower[lower digits of rep].rank
+//!
+//! where the lower rank is the position of the lower configuration among all
+//! lower configurations with the same quantum numbers, and the upper rank is the
+//! number of basis states whose upper configuration is smaller.
+//! Both tables have 2^(n_digit/2) entries of two 32-bit integers, whatever the dimension
+//! of the sector, and the resulting order agrees with the one produced by BasisIterator
+//! (ascending representation). LinTableLookup falls back to the sorted basis when the tables
+//! would be much larger than the basis.
+//!
+//! @tparam _RepSize Length of binary representation
+//! @tparam _SiteSize Number of sites
+//! @tparam QNS List of quantum number types.
+template <size_t _RepSize, size_t _SiteSize, typename ... QNS>
+class LinTable
+{
+ public:
+  static const size_t RepSize = _RepSize;
+  static const size_t SiteSize = _SiteSize;
+  static const size_t npos = static_cast<size_t>(-1);
+
+  //! Maximum number of digits of each half (the tables have 2^MaxHalfDigit entries).
+  static const size_t MaxHalfDigit = 24;
+
+  using SystemType = System<QNS...>;
+  using QuantumNumberTuple = typename SystemType::QuantumNumberTuple;
+  using BitRep = std::bitset<RepSize>;
+  using BitSite = std::bitset<SiteSize>;
+  using Rep = CompactRep<RepSize>;
+  using Word = typename Rep::type;
+
+  //! Constructor of an empty table.
+  LinTable() : n_lower_site_(0), n_lower_digit_(0), n_upper_digit_(0), dimension_(0) { }
+
+  //! Constructor
+  //! @param system
+  //! @param quantum_number Tuple of quantum numbers of the sector.
+  LinTable(const SystemType& system, const QuantumNumberTuple& quantum_number)
+      : n_lower_site_(0), n_lower_digit_(0), n_upper_digit_(0), dimension_(0)
+  {
+    size_t ns = system.n_site();
+    assert(ns > 0);
+    assert(system.n_digit() <= RepSize);
+    assert(ns <= SiteSize);
+
+    std::vector<size_t> start = start_digits(system);
+    size_t nd = start[ns];
+    n_lower_site_ = split(start);
+    n_lower_digit_ = start[n_lower_site_];
+    n_upper_digit_ = nd - n_lower_digit_;
+    if (n_lower_digit_ > MaxHalfDigit || n_upper_digit_ > MaxHalfDigit) {
+      throw std::length_error("LinTable(): representation too long");
+    }
+
+    // lower table: rank among the lower configurations with the same quantum numbers.
+    std::map<QuantumNumberTuple, uint32_t> group_map;
+    lower_.assign(size_t(1) << n_lower_digit_, Entry{Absent, Absent});
+    for_each_configuration(system, start, 0, n_lower_site_,
+      [&](uint64_t digits, const QuantumNumberTuple& qn) {
+        auto found = group_map.find(qn);
+        uint32_t group;
+        if (found == group_map.end()) {
+          group = static_cast<uint32_t>(lower_configuration_.size());
+          group_map[qn] = group;
+          lower_configuration_.emplace_back();
+        } else {
+          group = found->second;
+        }
+        lower_[digits] = Entry{static_cast<uint32_t>(lower_configuration_[group].size()), group};
+        lower_configuration_[group].push_back(digits);
+      });
+
+    // upper table: number of basis states with smaller upper configuration.
+    upper_.assign(size_t(1) << n_upper_digit_, Entry{Absent, Absent});
+    for_each_configuration(system, start, n_lower_site_, ns,
+      [&](uint64_t digits, const QuantumNumberTuple& qn) {
+        QuantumNumberTuple lower_qn = elementwise(quantum_number) - elementwise(qn);
+        auto found = group_map.find(lower_qn);
+        if (found == group_map.end()) { return; }
+        if (dimension_ >= Absent) {
+          throw std::length_error("LinTable(): sector too large for 32-bit ranks");
+        }
+        upper_[digits] = Entry{static_cast<uint32_t>(dimension_), found->second};
+        upper_configuration_.push_back(digits);
+        upper_rank_.push_back(dimension_);
+        dimension_ += lower_configuration_[found->second].size();
+      });
+    if (dimension_ > Absent) {
+      throw std::length_error("LinTable(): sector too large for 32-bit ranks");
+    }
+  }
+
+  //! Number of digits of the larger of the two tables of the system (without building them).
+  static size_t max_half_digit(const SystemType& system) {
+    std::vector<size_t> start = start_digits(system);
+    size_t k = split(start);
+    return std::max(start[k], start.back() - start[k]);
+  }
+
+  //! Dimension of the sector.
+  size_t size() const { return dimension_; }
+
+  //! Number of sites in the lower part.
+  size_t n_lower_site() const { return n_lower_site_; }
+
+  //! Index of the given representation in the sector.
+  //! @return npos if the representation does not belong to the sector.
+  size_t rank(const Word& w) const {
+    Word upper_word = w >> n_lower_digit_;
+    if (!Rep::is_zero(upper_word >> n_upper_digit_)) { return npos; }
+    const Entry& lower = lower_[Rep::low_bits(w, n_lower_digit_)];
+    const Entry& upper = upper_[Rep::low_bits(upper_word, n_upper_digit_)];
+    if (upper.group == Absent || upper.group != lower.group) { return npos; }
+    return size_t(upper.rank) + lower.rank;
+  }
+
+  //! Representation of the basis state of the given index.
+  Word unrank(size_t idx) const {
+    assert(idx < dimension_);
+    size_t i_upper = static_cast<size_t>(
+        std::upper_bound(upper_rank_.begin(), upper_rank_.end(), idx) - upper_rank_.begin()) - 1;
+    uint64_t upper_digits = upper_configuration_[i_upper];
+    uint64_t lower_digits = lower_configuration_[upper_[upper_digits].group][idx - upper_rank_[i_upper]];
+    return (Word(upper_digits) << n_lower_digit_) | Word(lower_digits);
+  }
+
+  //! Number of bytes used by the tables.
+  size_t memory_usage() const {
+    size_t n_byte = (lower_.size() + upper_.size()) * sizeof(Entry)
+                    + upper_configuration_.size() * sizeof(uint64_t)
+                    + upper_rank_.size() * sizeof(size_t);
+    for (auto const & conf : lower_configuration_) { n_byte += conf.size() * sizeof(uint64_t); }
+    return n_byte;
+  }
+
+ private:
+  static const uint32_t Absent = static_cast<uint32_t>(-1);
+
+  struct Entry {
+    uint32_t rank;
+    uint32_t group;
+  };
+
+  //! First digit of every site, n_site + 1 entries.
+  static std::vector<size_t> start_digits(const SystemType& system) {
+    std::vector<size_t> start(system.n_site() + 1, 0);
+    for (size_t i_site = 0; i_site < system.n_site(); ++i_site) {
+      start[i_site + 1] = start[i_site] + system.site(i_site).n_digit();
+    }
+    return start;
+  }
+
+  //! Number of lower sites of the split which balances the two tables.
+  static size_t split(const std::vector<size_t>& start) {
+    size_t nd = start.back();
+    size_t ret = 0;
+    for (size_t k = 1; k < start.size(); ++k) {
+      if (std::max(start[k], nd - start[k]) < std::max(start[ret], nd - start[ret])) { ret = k; }
+    }
+    return ret;
+  }
+
+  //! Visit all configurations of the sites [site_begin, site_end) in ascending order of their digits.
+  //! The digits passed to func are relative to the start digit of site_begin.
+  template <typename Function>
+  static void for_each_configuration(const SystemType& system, const std::vector<size_t>& start,
+                                     size_t site_begin, size_t site_end, Function&& func)
+  {
+    for_each_configuration_rec(system, start, site_begin, site_end, 0,
+                               std::make_tuple(QNS(0)...), func);
+  }
+
+  template <typename Function>
+  static void for_each_configuration_rec(const SystemType& system, const std::vector<size_t>& start,
+                                         size_t site_begin, size_t site, uint64_t digits,
+                                         const QuantumNumberTuple& qn, Function& func)
+  {
+    if (site == site_begin) {
+      func(digits, qn);
+      return;
+    }
+    size_t i_site = site - 1;
+    auto const & s = system.site(i_site);
+    size_t shift = start[i_site] - start[site_begin];
+    for (size_t i_state = 0; i_state < s.n_state(); ++i_state) {
+      QuantumNumberTuple next_qn = elementwise(qn) + elementwise(s.state(i_state).quantum_number());
+      for_each_configuration_rec(system, start, site_begin, i_site,
+                                 digits | (uint64_t(i_state) << shift), next_qn, func);
+    }
+  }
+
+  size_t n_lower_site_;
+  size_t n_lower_digit_, n_upper_digit_;
+  size_t dimension_;
+
+  std::vector<Entry> lower_, upper_;
+  std::vector<std::vector<uint64_t>> lower_configuration_;   // per group, ascending
+  std::vector<uint64_t> upper_configuration_;                // compatible ones, ascending
+  std::vector<size_t> upper_rank_;
+};
+
+template <size_t _RepSize, size_t _SiteSize, typename ... QNS>
+const size_t LinTable<_RepSize, _SiteSize, QNS...>::npos;
+
+template <size_t _RepSize, size_t _SiteSize, typename ... QNS>
+const size_t LinTable<_RepSize, _SiteSize, QNS...>::MaxHalfDigit;
+
+template <size_t _RepSize, size_t _SiteSize, typename ... QNS>
+const uint32_t LinTable<_RepSize, _SiteSize, QNS...>::Absent;
@@ -0,0 +1,156 @@
+#pragma once
+#include "../global.h"
+
+#include <array>
+#include <initializer_list>
+
+#include "../utility/tuple_stream.h"
+#include "quantumnumber.h"
+
+//! @class QuantumNumberPacking
+//!
+//! @brief Quantum numbers of the basis enumeration, packed into the lanes of one 64-bit word.
+//!
+//! Every U(1) quantum number gets a lane of b bits, with a guard bit above it. A state of a
+//! site is stored as its offset from the minimum of the site, q - min >= 0, so the sum of
+//! the offsets of any group of sites is in [0, range of the system] and never carries into
+//! the next lane (b is the width of that range). Adding the quantum numbers of a state is one
+//! integer addition, and the bounds of all the lanes are checked at once: for lanes x, y < 2^b,
+//!
+//!     ((y | guard) - x) & guard == guard   iff   x <= y in every lane
+//!
+//! since only a lane with x > y borrows its guard bit.
+//!
+//! In offsets, a partial state of the sites >= i with the sum p can be completed to the target
+//! t (both relative to the sum of the minima of all the sites) if and only if
+//!
+//!     t - range(sites < i) <= p <= t
+//!
+//! in every lane, which is the U(1) bound of QuantumNumberReach.
+//!
+//! The packing is only valid() if all the quantum numbers are U(1) and the lanes fit in 64
+//! bits. Otherwise BasisIterator enumerates with the tuples of quantum numbers.
+//!
+//! @tparam QNS List of quantum number types.
+template <typename ... QNS>
+class QuantumNumberPacking
+{
+ public:
+  using QuantumNumberTuple = std::tuple<QNS...>;
+  using LaneArray = std::array<std::int64_t, sizeof...(QNS)>;
+
+  //! Number of lanes.
+  static const size_t NumLane = sizeof...(QNS);
+
+  QuantumNumberPacking() : valid_(false), guard_(0) { }
+
+  //! Constructor
+  //! @param sites Sites of the %System.
+  template <typename SiteType>
+  explicit QuantumNumberPacking(const std::vector<SiteType>& sites)
+      : valid_(false), guard_(0)
+  {
+    for (bool u1 : std::initializer_list<bool>{(QNS::Modulus == 0)...}) {
+      if (!u1) { return; }
+    }
+    LaneArray range;
+    range.fill(0);
+    min_total_.fill(0);
+    range_below_.push_back(range);
+    for (auto const & site : sites) {
+      LaneArray lo = lanes(site.min_quantum_number());
+      LaneArray hi = lanes(site.max_quantum_number());
+      for (size_t k = 0; k < NumLane; ++k) {
+        range[k] += hi[k] - lo[k];
+        min_total_[k] += lo[k];
+      }
+      range_below_.push_back(range);
+    }
+
+    size_t n_bit = 0;
+    for (size_t k = 0; k < NumLane; ++k) {
+      size_t width = 1;
+      while ((std::int64_t(1) << width) <= range[k]) {
+        if (++width > 62) { return; }
+      }
+      shift_[k] = n_bit;
+      n_bit += width + 1;
+      if (n_bit > 64) { return; }
+      guard_ |= uint64_t(1) << (n_bit - 1);
+    }
+
+    site_start_.push_back(0);
+    for (auto const & site : sites) {
+      LaneArray lo = lanes(site.min_quantum_number());
+      for (size_t i_state = 0; i_state < site.n_state(); ++i_state) {
+        LaneArray q = lanes(site.state(i_state).quantum_number());
+        for (size_t k = 0; k < NumLane; ++k) { q[k] -= lo[k]; }
+        offset_.push_back(pack(q));
+      }
+      site_start_.push_back(offset_.size());
+    }
+    valid_ = true;
+  }
+
+  //! Whether the quantum numbers could be packed.
+  bool valid() const { return valid_; }
+
+  //! Guard bits of all the lanes.
+  uint64_t guard() const { return guard_; }
+
+  //! Packed offset of a state of a site from the minimum of the site.
+  uint64_t offset(size_t i_site, size_t i_state) const { return offset_[site_start_[i_site] + i_state]; }
+
+  //! @brief Packed target, and the lower bounds of the partial sums.
+  //! @param target Quantum numbers of the sector.
+  //! @param packed_target Sum of the offsets of the states of the sector.
+  //! @param lower For every i_site, the smallest sum of the offsets of the sites >= i_site
+  //! which the sites < i_site can complete to packed_target.
+  //! @return false if the target is out of range (the sector is empty).
+  bool bounds(const QuantumNumberTuple& target, uint64_t& packed_target, std::vector<uint64_t>& lower) const {
+    assert(valid_);
+    LaneArray t = lanes(target);
+    for (size_t k = 0; k < NumLane; ++k) {
+      t[k] -= min_total_[k];
+      if (t[k] < 0 || t[k] > range_below_.back()[k]) { return false; }
+    }
+    packed_target = pack(t);
+    lower.resize(range_below_.size());
+    for (size_t i_site = 0; i_site < range_below_.size(); ++i_site) {
+      LaneArray lo;
+      for (size_t k = 0; k < NumLane; ++k) { lo[k] = std::max<std::int64_t>(0, t[k] - range_below_[i_site][k]); }
+      lower[i_site] = pack(lo);
+    }
+    return true;
+  }
+
+  //! Whether lo <= x <= hi in every lane.
+  bool within(uint64_t x, uint64_t lo, uint64_t hi) const {
+    return ((((hi | guard_) - x) & ((x | guard_) - lo)) & guard_) == guard_;
+  }
+
+ private:
+  static LaneArray lanes(const QuantumNumberTuple& qn) { return lanes(qn, aux::gen_seq<NumLane>()); }
+
+  template <size_t ... Is>
+  static LaneArray lanes(const QuantumNumberTuple& qn, aux::seq<Is...>) {
+    return LaneArray{{static_cast<std::int64_t>(std::get<Is>(qn).value())...}};
+  }
+
+  uint64_t pack(const LaneArray& values) const {
+    uint64_t ret = 0;
+    for (size_t k = 0; k < NumLane; ++k) { ret |= static_cast<uint64_t>(values[k]) << shift_[k]; }
+    return ret;
+  }
+
+  bool valid_;
+  uint64_t guard_;
+  std::array<size_t, NumLane> shift_;
+  LaneArray min_total_;                  //!< sum of the minima of all the sites
+  std::vector<LaneArray> range_below_;   //!< range of the sites < i_site, n_site + 1 entries
+  std::vector<size_t> site_start_;       //!< n_site + 1 entries
+  std::vector<uint64_t> offset_;         //!< of every state of every site
+};
+
+template <typename ... QNS>
+const size_t QuantumNumberPacking<QNS...>::NumLane;
@@ -0,0 +1,95 @@
+#pragma once
+#include "../global.h"
+
+#include <array>
+
+#include "../utility/tuple_tools.h"
+#include "quantumnumber.h"
+
+//! @class QuantumNumberReach
+//!
+//! @brief Total quantum numbers which a group of sites can reach, used to prune the
+//! enumeration of a sector.
+//!
+//! A U(1) quantum number is bounded by the interval [min, max] of the sums of the minima and
+//! maxima of the sites. A Z_n quantum number (see ModularQuantumNumber) wraps around, so such
+//! bounds would be wrong; its reachable residues are kept exactly instead, as a mask of n bits:
+//! adding a site ORs the mask rotated by the residue of every state of the site. A partial
+//! state can be completed by the group if every quantum number which the group still has to
+//! contribute is reachable.
+//!
+//! @tparam QNS List of quantum number types.
+template <typename ... QNS>
+class QuantumNumberReach
+{
+ public:
+  using QuantumNumberTuple = std::tuple<QNS...>;
+  using MaskType = std::array<uint64_t, sizeof...(QNS)>;
+
+  //! Reach of no sites: only zero.
+  QuantumNumberReach()
+      : min_(std::make_tuple(QNS(0)...)), max_(std::make_tuple(QNS(0)...))
+  {
+    mask_.fill(1);
+  }
+
+  //! Reach of this group and the given site.
+  template <typename SiteType>
+  QuantumNumberReach add(const SiteType& site) const {
+    QuantumNumberReach ret;
+    ret.min_ = elementwise(min_) + elementwise(site.min_quantum_number());
+    ret.max_ = elementwise(max_) + elementwise(site.max_quantum_number());
+    ret.mask_.fill(0);
+    for (size_t i_state = 0; i_state < site.n_state(); ++i_state) {
+      add_state(site.state(i_state).quantum_number(), ret.mask_, std::integral_constant<size_t, 0>());
+    }
+    return ret;
+  }
+
+  //! Bounds of the U(1) quantum numbers (the entries of the Z_n ones are meaningless).
+  const QuantumNumberTuple & min_quantum_number() const { return min_; }
+  const QuantumNumberTuple & max_quantum_number() const { return max_; }
+
+  //! Reachable residues of every Z_n quantum number (bit r for the residue r).
+  const MaskType & residue_mask() const { return mask_; }
+
+  //! Whether partial plus a quantum number of the group can be target.
+  bool reachable(const QuantumNumberTuple& partial, const QuantumNumberTuple& target) const {
+    return reachable(partial, target, std::integral_constant<size_t, 0>());
+  }
+
+ private:
+  template <size_t I>
+  void add_state(const QuantumNumberTuple& qn, MaskType& mask, std::integral_constant<size_t, I>) const {
+    using QN = typename std::tuple_element<I, QuantumNumberTuple>::type;
+    if (QN::Modulus != 0) { mask[I] |= rotate(mask_[I], std::get<I>(qn).value(), QN::Modulus); }
+    add_state(qn, mask, std::integral_constant<size_t, I + 1>());
+  }
+  void add_state(const QuantumNumberTuple&, MaskType&, std::integral_constant<size_t, sizeof...(QNS)>) const { }
+
+  template <size_t I>
+  bool reachable(const QuantumNumberTuple& partial, const QuantumNumberTuple& target,
+                 std::integral_constant<size_t, I>) const {
+    using QN = typename std::tuple_element<I, QuantumNumberTuple>::type;
+    const QN & p = std::get<I>(partial);
+    const QN & t = std::get<I>(target);
+    bool ok = (QN::Modulus != 0) ? (((mask_[I] >> (t - p).value()) & 1) != 0)
+                                 : (p + std::get<I>(min_) <= t && t <= p + std::get<I>(max_));
+    return ok && reachable(partial, target, std::integral_constant<size_t, I + 1>());
+  }
+  bool reachable(const QuantumNumberTuple&, const QuantumNumberTuple&,
+                 std::integral_constant<size_t, sizeof...(QNS)>) const {
+    return true;
+  }
+
+  //! Residues r of the mask moved to r + shift (mod modulus).
+  static uint64_t rotate(uint64_t mask, std::int64_t shift, std::int64_t modulus) {
+    if (shift == 0) { return mask; }
+    uint64_t full = (modulus == 64) ? ~uint64_t(0) : ((uint64_t(1) << modulus) - 1);
+    return ((mask << shift) | (mask >> (modulus - shift))) & full;
+  }
+
+  QuantumNumberTuple min_;
+  QuantumNumberTuple max_;
+  MaskType mask_;   //!< only used for the Z_n quantum numbers
+};
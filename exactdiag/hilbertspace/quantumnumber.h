@@ -28,6 +28,9 @@ class QuantumNumber {
 
   static constexpr const char * name = "GenericQuantumNumber";
 
+  //! Modulus of a Z_n quantum number, 0 for an unbounded U(1) one (see ModularQuantumNumber).
+  static constexpr std::int64_t Modulus = 0;
+
   QuantumNumber(const ValueType& value) : value_(value) { }
   const ValueType & value() const { return value_; }
 
@@ -38,6 +41,35 @@ class QuantumNumber {
 
 
 
+template <typename _ValueType>
+constexpr std::int64_t QuantumNumber<_ValueType>::Modulus;
+
+
+//! @class ModularQuantumNumber
+//! @brief A Z_n quantum number type, conserved only modulo n (e.g. the charge of a clock
+//! model, or the total momentum of modes on a ring).
+//!
+//! The value is kept in [0, n), and the arithmetic of QuantumNumber wraps around, since every
+//! result is constructed from the plain sum or difference. The order is that of the values,
+//! which is only used to sort the sectors. Derive a named type from it, as ZnCharge.
+//! @tparam _Modulus n, at most 64 (so that a set of residues fits in one word, see QuantumNumberReach).
+template <std::int64_t _Modulus>
+class ModularQuantumNumber : public QuantumNumber<std::int64_t> {
+ public:
+  static_assert(_Modulus > 0 && _Modulus <= 64, "ModularQuantumNumber: modulus must be in [1, 64]");
+  static constexpr std::int64_t Modulus = _Modulus;
+
+  static constexpr const char * name = "ModularQuantumNumber";
+
+  ModularQuantumNumber(std::int64_t value) : QuantumNumber<std::int64_t>(((value % Modulus) + Modulus) % Modulus) { }
+
+  ModularQuantumNumber& operator++() { value_ = (value_ + 1) % Modulus; return *this; }
+};
+
+template <std::int64_t _Modulus>
+constexpr std::int64_t ModularQuantumNumber<_Modulus>::Modulus;
+
+
 template <typename QN,
           detail::enable_if_t<
                   std::is_base_of<QuantumNumber<typename QN::ValueType>, QN>::value,
@@ -129,3 +161,13 @@ class Spin : public QuantumNumber<std::int64_t>
   Spin(std::int64_t value) : QuantumNumber<std::int64_t>(value) { }
 };
 
+
+//! Z_n charge, e.g. of a clock model.
+template <std::int64_t N>
+class ZnCharge : public ModularQuantumNumber<N>
+{
+ public:
+  static constexpr const char * name = "ZnCharge";
+  ZnCharge() : ModularQuantumNumber<N>(0) { }
+  ZnCharge(std::int64_t value) : ModularQuantumNumber<N>(value) { }
+};
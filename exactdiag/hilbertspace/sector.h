@@ -4,35 +4,85 @@
 
 #include "../global.h"
 
-//! @class SectorGenerator.
+#include "../utility/parallel.h"
+#include "basis_iterator.h"
+#include "basis_lookup.h"
+#include "combination_basis.h"
+#include "compact_state.h"
+
+//! @class BasicSectorGenerator.
 //!
 //! @brief Generator of Sector defined by QuantumNumbers.
 //!
+//! @tparam LookupPolicy  Index which maps a BitRep to its index (see basis_lookup.h).
 //! @tparam _RepSize  Number of bits of representation (for basis representation).
 //! @tparam _SiteSize  Number of sites (for site representation)
 //! @tparam QuantumNumbers List of U(1) quantum numbers.
 //!
-//! A Sector class contains a vector of tuple of BitRep and BitSite, and unordered map of BitRep to ...
-//! (forward and backward map between representation and index)
-template <size_t _RepSize, size_t _SiteSize, typename ...QuantumNumbers>
-class SectorGenerator {
+//! A Sector class contains a vector of compact representations (see CompactRep), and an index which maps
+//! a representation to its position. (forward and backward map between representation and index)
+//! The fermion parity bitset of a basis state is derived from its representation by the CompactCodec.
+//!
+//! If all the sites have two states (spin-1/2, spinless or spinful fermions), generate() and
+//! generate_parallel() build the basis from the combinations of every species (see
+//! CombinationBasis) instead of searching the states with BasisIterator.
+template <template <size_t, size_t, typename...> class LookupPolicy,
+          size_t _RepSize, size_t _SiteSize, typename ...QuantumNumbers>
+class BasicSectorGenerator {
  public:
   using SystemType = System<QuantumNumbers...>;
   static const size_t RepSize = _RepSize;
   static const size_t SiteSize = _SiteSize;
   using BitRep = std::bitset<RepSize>;
   using BitSite = std::bitset<SiteSize>;
+  using IndexType = LookupPolicy<RepSize, SiteSize, QuantumNumbers...>;
+  using QuantumNumberTuple = typename SystemType::QuantumNumberTuple;
+  using CodecType = CompactCodec<RepSize, SiteSize>;
+  using Word = typename CodecType::Word;
+  using BasisType = std::vector<Word>;
 
  public:
   struct Sector
   {
-    std::vector<std::tuple<BitRep, BitSite>> basis;
-    std::unordered_map<BitRep, size_t> basismap;
+    static const size_t npos = static_cast<size_t>(-1);
+
+    BasisType basis; //!< empty if generated by generate_index, or if kept by the index (use word())
+    IndexType index;
+    CodecType codec;
+
+    //! Dimension of the sector.
+    size_t size() const { return index.size(); }
+
+    //! Index of the basis state with the given representation.
+    //! @return npos if the representation does not belong to the sector.
+    size_t find(const BitRep& rep) const { return index.find(codec.encode(rep)); }
+
+    //! Index of the basis state with the given compact representation.
+    //! @return npos if the representation does not belong to the sector.
+    size_t find_word(const Word& w) const { return index.find(w); }
+
+    //! Compact representation of the basis state of the given index.
+    Word word(size_t idx) const {
+      return word(idx, std::integral_constant<bool, IndexType::CanUnrank>());
+    }
+
+    //! Basis state of the given index, as used by PureOperator and MixedOperator.
+    std::tuple<BitRep, BitSite> state(size_t idx) const {
+      return codec.decode(word(idx));
+    }
+
+   private:
+    Word word(size_t idx, std::true_type) const {
+      return basis.empty() ? index.unrank(idx) : basis[idx];
+    }
+    Word word(size_t idx, std::false_type) const {
+      return basis[idx];
+    }
   };
 
   //! Constructor with the given System.
   //! @param system %System
-  SectorGenerator(const SystemType& system)
+  BasicSectorGenerator(const SystemType& system)
       : system_(system)
   {
   }
@@ -42,17 +92,255 @@ class SectorGenerator {
   Sector generate(QuantumNumbers... qns) const
   {
     Sector sector;
+    if (generate_combinations(std::make_tuple(qns...), 1, sector)) { return sector; }
     for (auto iter = system_. template cbegin<RepSize, SiteSize>(qns...);
          iter.valid();
          ++iter) {
-      sector.basis.push_back(iter.get());
+      sector.basis.push_back(iter.word());
     }
-    for (size_t i = 0; i < sector.basis.size(); ++i) {
-      sector.basismap[std::get<0>(sector.basis[i])] = i;
+    sector.index = IndexType(system_, std::make_tuple(qns...), std::move(sector.basis));
+    sector.codec = CodecType(system_);
+    return sector;
+  }
+
+  //! @brief Generate a sector of the Hilbertspace with the given quantum numbers on multiple threads.
+  //!
+  //! The search tree is split on the states of the highest few sites. Each subtree is
+  //! enumerated into its own buffer, and the buffers are concatenated in order, so the
+  //! basis is identical to the one from generate(). With two-state sites, CombinationBasis
+  //! builds the basis on the threads instead.
+  //! @param n_thread Number of threads (0 for default_n_thread()).
+  //! @param qns List of quantum numbers.
+  Sector generate_parallel(size_t n_thread, QuantumNumbers... qns) const
+  {
+    if (n_thread == 0) { n_thread = default_n_thread(); }
+    QuantumNumberTuple qn(qns...);
+    Sector sector;
+    if (generate_combinations(qn, n_thread, sector)) { return sector; }
+    auto prefixes = split(&qn, 8 * n_thread);
+
+    std::vector<BasisType> buffers(prefixes.size());
+    parallel_for(0, prefixes.size(), n_thread, [&](size_t i_prefix) {
+      for (BasisIterator<RepSize, SiteSize, QuantumNumbers...> iter(system_, qn, prefixes[i_prefix]);
+           iter.valid();
+           ++iter) {
+        buffers[i_prefix].push_back(iter.word());
+      }
+    });
+
+    size_t n_basis = 0;
+    for (auto const & buffer : buffers) { n_basis += buffer.size(); }
+    sector.basis.reserve(n_basis);
+    for (auto & buffer : buffers) {
+      sector.basis.insert(sector.basis.end(), buffer.begin(), buffer.end());
+      BasisType().swap(buffer);
     }
+    sector.index = IndexType(system_, qn, std::move(sector.basis));
+    sector.codec = CodecType(system_);
     return sector;
   }
 
+  //! @brief Generate all the nonempty sectors in a single pass over the Hilbert space.
+  //!
+  //! The configuration space is traversed once (split on the states of the highest
+  //! few sites, as in generate_parallel), and every state is put into the bucket of
+  //! its quantum numbers. The bases are identical to those from generate().
+  //! @param n_thread Number of threads (0 for default_n_thread()).
+  //! @return Map from the tuple of quantum numbers to the sector. Sector::size() gives its dimension.
+  std::map<QuantumNumberTuple, Sector> generate_all(size_t n_thread = 0) const
+  {
+    if (n_thread == 0) { n_thread = default_n_thread(); }
+    auto prefixes = split(nullptr, 8 * n_thread);
+
+    // number the sectors once, and the partial sums of the sites above every level, so that the
+    // traversal carries an id and the leaves index a vector of buckets.
+    std::vector<QuantumNumberTuple> sector_qn;
+    std::vector<size_t> sector_dim;
+    for (auto const & dim : system_.sector_dimensions()) {
+      sector_qn.push_back(dim.first);
+      sector_dim.push_back(dim.second);
+    }
+    BucketTable table = bucket_table(sector_qn);
+
+    std::vector<std::vector<BasisType>> buckets(prefixes.size());
+    parallel_for(0, prefixes.size(), n_thread, [&](size_t i_prefix) {
+      auto const & prefix = prefixes[i_prefix];
+      size_t n_free = system_.n_site() - prefix.size();
+      Word w(0);
+      size_t id = 0;
+      for (size_t i = prefix.size(); i > 0; --i) {
+        size_t i_site = n_free + i - 1;
+        w |= Word(prefix[i - 1]) << table.start_digit[i_site];
+        id = table.next_id[i_site][id * table.n_state[i_site] + prefix[i - 1]];
+      }
+      buckets[i_prefix].resize(sector_qn.size());
+      bucket_rec(table, n_free, w, id, buckets[i_prefix]);
+    });
+
+    std::vector<BasisType> bases(sector_qn.size());
+    for (size_t i_sector = 0; i_sector < sector_qn.size(); ++i_sector) {
+      bases[i_sector].reserve(sector_dim[i_sector]);
+    }
+    for (auto & bucket : buckets) {
+      for (size_t i_sector = 0; i_sector < bucket.size(); ++i_sector) {
+        auto & basis = bases[i_sector];
+        basis.insert(basis.end(), bucket[i_sector].begin(), bucket[i_sector].end());
+      }
+      std::vector<BasisType>().swap(bucket);
+    }
+    std::map<QuantumNumberTuple, Sector> sectors;
+    for (size_t i_sector = 0; i_sector < sector_qn.size(); ++i_sector) {
+      sectors[sector_qn[i_sector]].basis.swap(bases[i_sector]);
+    }
+
+    CodecType codec(system_);
+    std::vector<std::pair<const QuantumNumberTuple, Sector>*> sector_list;
+    for (auto & s : sectors) { sector_list.push_back(&s); }
+    parallel_for(0, sector_list.size(), n_thread, [&](size_t i_sector) {
+      auto & s = *sector_list[i_sector];
+      s.second.index = IndexType(system_, s.first, std::move(s.second.basis));
+      s.second.codec = codec;
+    });
+    return sectors;
+  }
+
+  //! @brief Generate a sector without storing its basis.
+  //!
+  //! Basis states are unranked from the index on demand (see Sector::state).
+  //! Only available for lookup policies which can unrank (LinTableLookup).
+  //! @param qns List of quantum numbers.
+  Sector generate_index(QuantumNumbers... qns) const
+  {
+    static_assert(IndexType::CanUnrank, "generate_index requires a lookup policy which can unrank");
+    Sector sector;
+    sector.index = IndexType(system_, std::make_tuple(qns...));
+    sector.codec = CodecType(system_);
+    return sector;
+  }
+
+  //! @brief Feasible states of the highest few sites, in the order of enumeration.
+  //!
+  //! Prefixes are extended one site at a time until there are at least n_min_prefix
+  //! of them (or only one site is left), skipping those which cannot reach *qn. Every
+  //! prefix is the root of a subtree for the BasisIterator constructor, and the subtrees
+  //! enumerate the sector in order.
+  //! @param qn Target quantum numbers, or nullptr to keep every prefix.
+  std::vector<std::vector<size_t>> split(const QuantumNumberTuple* qn, size_t n_min_prefix) const
+  {
+    size_t ns = system_.n_site();
+    std::vector<std::pair<std::vector<size_t>, QuantumNumberTuple>> prefixes;
+    prefixes.emplace_back(std::vector<size_t>(), std::make_tuple(QuantumNumbers(0)...));
+
+    for (size_t level = ns - 1; level > 0 && prefixes.size() < n_min_prefix; --level) {
+      auto const & site = system_.site(level);
+      auto reach = system_.reach(level);
+      std::vector<std::pair<std::vector<size_t>, QuantumNumberTuple>> next_prefixes;
+      for (auto const & prefix : prefixes) {
+        for (size_t i_state = 0; i_state < site.n_state(); ++i_state) {
+          QuantumNumberTuple cqn = elementwise(prefix.second)
+                                   + elementwise(site.state(i_state).quantum_number());
+          if (qn && !reach.reachable(cqn, *qn)) { continue; }
+          std::vector<size_t> states(1, i_state);
+          states.insert(states.end(), prefix.first.begin(), prefix.first.end());
+          next_prefixes.emplace_back(states, cqn);
+        }
+      }
+      prefixes.swap(next_prefixes);
+    }
+
+    std::vector<std::vector<size_t>> ret;
+    for (auto const & prefix : prefixes) { ret.push_back(prefix.first); }
+    return ret;
+  }
+
  private:
+  //! @brief Fill the sector from the combinations of the species of two-state sites.
+  //! @param n_thread Number of threads of CombinationBasis::generate.
+  //! @return false if CombinationBasis does not apply (the sector is unchanged).
+  bool generate_combinations(const QuantumNumberTuple& qn, size_t n_thread, Sector& sector) const
+  {
+    CombinationBasis<RepSize, QuantumNumbers...> combinations(system_);
+    if (!combinations.generate(qn, sector.basis, n_thread)) { return false; }
+    sector.index = IndexType(system_, qn, std::move(sector.basis));
+    sector.codec = CodecType(system_);
+    return true;
+  }
+
+  //! @brief Transitions between the numbered partial sums of the quantum numbers (see generate_all).
+  //!
+  //! The partial sums of the sites >= i_site are numbered for every i_site; those of all the
+  //! sites are the sectors. next_id[i_site][id * n_state[i_site] + i_state] is the number of
+  //! the partial sum of the sites >= i_site, given the number id of that of the sites > i_site.
+  struct BucketTable
+  {
+    std::vector<size_t> start_digit;
+    std::vector<size_t> n_state;
+    std::vector<std::vector<size_t>> next_id;
+  };
+
+  //! @param sector_qn Quantum numbers of all the nonempty sectors, in the order of their numbers.
+  BucketTable bucket_table(const std::vector<QuantumNumberTuple>& sector_qn) const
+  {
+    size_t ns = system_.n_site();
+    BucketTable table;
+    table.next_id.resize(ns);
+    for (size_t i_site = 0; i_site < ns; ++i_site) {
+      table.start_digit.push_back(system_.start_digit(i_site));
+      table.n_state.push_back(system_.site(i_site).n_state());
+    }
+
+    // partial sums of the sites >= i_site, from the top.
+    std::vector<std::vector<QuantumNumberTuple>> partial(ns + 1);
+    partial[ns].push_back(std::make_tuple(QuantumNumbers(0)...));
+    for (size_t i_site = ns; i_site > 0; --i_site) {
+      auto const & site = system_.site(i_site - 1);
+      std::map<QuantumNumberTuple, size_t> numbering;
+      if (i_site == 1) {
+        for (size_t i = 0; i < sector_qn.size(); ++i) { numbering[sector_qn[i]] = i; }
+        partial[0] = sector_qn;
+      }
+      auto & next_id = table.next_id[i_site - 1];
+      for (auto const & p : partial[i_site]) {
+        for (size_t i_state = 0; i_state < site.n_state(); ++i_state) {
+          QuantumNumberTuple qn = elementwise(p) + elementwise(site.state(i_state).quantum_number());
+          auto found = numbering.find(qn);
+          if (found == numbering.end()) {
+            found = numbering.emplace(qn, partial[i_site - 1].size()).first;
+            partial[i_site - 1].push_back(qn);
+          }
+          next_id.push_back(found->second);
+        }
+      }
+    }
+    return table;
+  }
+
+  //! Put all the configurations of the sites below level into the buckets of their sector
+  //! numbers, in ascending order.
+  //! @param id Number of the partial sum of the quantum numbers of the sites >= level.
+  void bucket_rec(const BucketTable& table, size_t level, const Word& w, size_t id,
+                  std::vector<BasisType>& buckets) const
+  {
+    if (level == 0) {
+      buckets[id].push_back(w);
+      return;
+    }
+    size_t i_site = level - 1;
+    size_t n_state = table.n_state[i_site];
+    const size_t* next_id = &table.next_id[i_site][id * n_state];
+    size_t sdig = table.start_digit[i_site];
+    for (size_t i_state = 0; i_state < n_state; ++i_state) {
+      bucket_rec(table, i_site, w | (Word(i_state) << sdig), next_id[i_state], buckets);
+    }
+  }
+
   const SystemType& system_;
 };
+
+template <template <size_t, size_t, typename...> class LookupPolicy,
+          size_t _RepSize, size_t _SiteSize, typename ...QuantumNumbers>
+const size_t BasicSectorGenerator<LookupPolicy, _RepSize, _SiteSize, QuantumNumbers...>::Sector::npos;
+
+//! SectorGenerator with the default lookup policy (LinTableLookup).
+template <size_t RepSize, size_t SiteSize, typename ...QuantumNumbers>
+using SectorGenerator = BasicSectorGenerator<LinTableLookup, RepSize, SiteSize, QuantumNumbers...>;
@@ -2,6 +2,8 @@
 #include "../global.h"
 
 #include "quantumnumber.h"
+#include "quantum_number_reach.h"
+#include "quantum_number_packing.h"
 #include "state.h"
 #include "site.h"
 #include "operator.h"
@@ -20,6 +22,53 @@ class System {
   using StateType = State<QNS...>;
   using SiteType = Site<QNS...>;
   using QuantumNumberTuple = std::tuple<QNS...>;
+  using ReachType = QuantumNumberReach<QNS...>;
+  using PackingType = QuantumNumberPacking<QNS...>;
+
+  //! @class Layout
+  //! @brief Flat tables of the site layout of a finalized %System.
+  //!
+  //! Prefix bounds are indexed like max_quantum_number(i_site): entry i covers the sites 0 to < i.
+  struct Layout {
+    std::vector<size_t> start_digit;   //!< n_site + 1 entries, the last one is n_digit.
+    std::vector<size_t> n_digit;
+    std::vector<uint64_t> digit_mask;  //!< mask of the digits of a site, before shifting by start_digit
+    std::vector<std::vector<QuantumNumberTuple>> state_quantum_number;
+    std::vector<std::vector<bool>> state_fermion_parity;
+    std::vector<QuantumNumberTuple> min_quantum_number;  //!< n_site + 1 entries
+    std::vector<QuantumNumberTuple> max_quantum_number;  //!< n_site + 1 entries
+    std::vector<ReachType> reach;                        //!< n_site + 1 entries
+    std::shared_ptr<const PackingType> packing;
+
+    Layout(const std::vector<SiteType>& sites)
+        : start_digit(1, 0)
+        , min_quantum_number(1, std::make_tuple(QNS(0)...))
+        , max_quantum_number(1, std::make_tuple(QNS(0)...))
+        , reach(1)
+    {
+      for (auto const & site : sites) {
+        size_t nd = site.n_digit();
+        assert(nd < 64);
+        start_digit.push_back(start_digit.back() + nd);
+        n_digit.push_back(nd);
+        digit_mask.push_back((uint64_t(1) << nd) - 1);
+        std::vector<QuantumNumberTuple> qns;
+        std::vector<bool> fps;
+        for (size_t i_state = 0; i_state < site.n_state(); ++i_state) {
+          qns.push_back(site.state(i_state).quantum_number());
+          fps.push_back(site.state(i_state).fermion_parity());
+        }
+        state_quantum_number.push_back(qns);
+        state_fermion_parity.push_back(fps);
+        QuantumNumberTuple qmin = elementwise(min_quantum_number.back()) + elementwise(site.min_quantum_number());
+        QuantumNumberTuple qmax = elementwise(max_quantum_number.back()) + elementwise(site.max_quantum_number());
+        min_quantum_number.push_back(qmin);
+        max_quantum_number.push_back(qmax);
+        reach.push_back(reach.back().add(site));
+      }
+      packing = std::make_shared<const PackingType>(sites);
+    }
+  };
 
   //! @class Default Constructor
   System() { }
@@ -36,10 +85,30 @@ public:
   //! Add sites.
   template<typename ... Args>
   System & add_site(const SiteType &site, Args ... args) {
+    if (layout_) { throw std::logic_error("System::add_site(): system is finalized"); }
     sites_.push_back(site);
     return add_site(args...);
   }
 
+  //! @brief Freeze the sites and precompute the Layout tables.
+  //!
+  //! Afterwards the layout queries (start_digit, mask_digit, min/max_quantum_number, ...)
+  //! are table lookups instead of loops over the preceding sites, and no sites can be added.
+  //! Sites must not be modified through site() after finalizing.
+  System & finalize() {
+    if (!layout_) { layout_ = std::make_shared<const Layout>(sites_); }
+    return *this;
+  }
+
+  //! Whether finalize() has been called.
+  bool finalized() const { return static_cast<bool>(layout_); }
+
+  //! Layout tables of a finalized system.
+  const Layout & layout() const {
+    if (!layout_) { throw std::logic_error("System::layout(): system is not finalized"); }
+    return *layout_;
+  }
+
   //! Get site of the given index.
   SiteType & site(size_t idx_site) {
     assert(idx_site < n_site());
@@ -61,6 +130,7 @@ public:
 
   //! Number of digits required for a binary representation of the basis.
   size_t n_digit() const {
+    if (layout_) { return layout_->start_digit.back(); }
     size_t n_dig = 0;
     for (auto const &site : sites_) {
       n_dig += site.n_digit();
@@ -71,6 +141,7 @@ public:
   //! Start digit of the site with the given index
   size_t start_digit(size_t idx_site) const {
     assert(idx_site < n_site());
+    if (layout_) { return layout_->start_digit[idx_site]; }
     size_t n_dig = 0;
     for (size_t j = 0; j < idx_site; ++j) {
       n_dig += sites_[j].n_digit();
@@ -82,6 +153,9 @@ public:
   template<size_t RepSize>
   std::bitset<RepSize> mask_digit(size_t idx_site) const {
     assert(idx_site < n_site());
+    if (layout_) {
+      return std::bitset<RepSize>(layout_->digit_mask[idx_site]) << layout_->start_digit[idx_site];
+    }
     size_t sdig = start_digit(idx_site);
     size_t mdig = sites_[idx_site].n_digit();
     std::bitset<RepSize> mask;
@@ -95,6 +169,10 @@ public:
   template<size_t RepSize>
   void mask_digit(size_t idx_site, std::bitset<RepSize>& mask) const {
     assert(idx_site < n_site());
+    if (layout_) {
+      mask = std::bitset<RepSize>(layout_->digit_mask[idx_site]) << layout_->start_digit[idx_site];
+      return;
+    }
     size_t sdig = start_digit(idx_site);
     size_t mdig = sites_[idx_site].n_digit();
     mask.reset();
@@ -107,6 +185,7 @@ public:
   // not inclusive
   QuantumNumberTuple max_quantum_number(size_t i_site) const {
     assert(i_site < sites_.size());
+    if (layout_) { return layout_->max_quantum_number[i_site]; }
     QuantumNumberTuple c;
     for (size_t j = 0; j < i_site; ++j) {
       c = elementwise(c) + elementwise(sites_[j].max_quantum_number());
@@ -118,6 +197,7 @@ public:
   // not inclusive
   QuantumNumberTuple min_quantum_number(size_t i_site) const {
     assert(i_site < sites_.size());
+    if (layout_) { return layout_->min_quantum_number[i_site]; }
     QuantumNumberTuple c;
     for (size_t j = 0; j < i_site; ++j) {
       c = elementwise(c) + elementwise(sites_[j].min_quantum_number());
@@ -125,8 +205,27 @@ public:
     return c;
   }
 
+  //! @brief Quantum numbers reachable by the subsystem consisting of sites 0 to < i_site.
+  //!
+  //! Generalizes min_quantum_number(i_site) and max_quantum_number(i_site) to the Z_n
+  //! quantum numbers, for which such bounds do not exist (see QuantumNumberReach).
+  ReachType reach(size_t i_site) const {
+    assert(i_site < sites_.size());
+    if (layout_) { return layout_->reach[i_site]; }
+    ReachType c;
+    for (size_t j = 0; j < i_site; ++j) { c = c.add(sites_[j]); }
+    return c;
+  }
+
+  //! Quantum numbers of the sites packed into one word, for the enumeration (see QuantumNumberPacking).
+  std::shared_ptr<const PackingType> packing() const {
+    if (layout_) { return layout_->packing; }
+    return std::make_shared<const PackingType>(sites_);
+  }
+
   //! Tuple of maximum quantum numbers
   QuantumNumberTuple max_quantum_number() const {
+    if (layout_) { return layout_->max_quantum_number.back(); }
     QuantumNumberTuple c;
     for (size_t j = 0; j < n_site(); ++j) {
       c = elementwise(c) + elementwise(sites_[j].max_quantum_number());
@@ -136,6 +235,7 @@ public:
 
   //! Tuple of minimum quantum numbers
   QuantumNumberTuple min_quantum_number() const {
+    if (layout_) { return layout_->min_quantum_number.back(); }
     QuantumNumberTuple c;
     for (size_t j = 0; j < n_site(); ++j) {
       c = elementwise(c) + elementwise(sites_[j].min_quantum_number());
@@ -143,6 +243,59 @@ public:
     return c;
   }
 
+  //! @brief Dimensions of all the sectors.
+  //!
+  //! Computed by dynamic programming over sites on histograms of the quantum numbers,
+  //! without enumerating the basis.
+  //! @return Map from the tuple of quantum numbers to the number of states (nonempty sectors only).
+  std::map<QuantumNumberTuple, size_t> sector_dimensions() const {
+    std::map<QuantumNumberTuple, size_t> histogram;
+    histogram[std::make_tuple(QNS(0)...)] = 1;
+    for (auto const & site : sites_) {
+      std::map<QuantumNumberTuple, size_t> next_histogram;
+      for (auto const & h : histogram) {
+        for (size_t i_state = 0; i_state < site.n_state(); ++i_state) {
+          QuantumNumberTuple qn = elementwise(h.first) + elementwise(site.state(i_state).quantum_number());
+          next_histogram[qn] += h.second;
+        }
+      }
+      histogram.swap(next_histogram);
+    }
+    return histogram;
+  }
+
+  //! @brief Dimension of the sector with the given quantum numbers.
+  //!
+  //! Same as sector_dimensions(), but the histogram entries which cannot reach
+  //! the given quantum numbers with the remaining sites are dropped.
+  size_t sector_dimension(QNS... qns) const {
+    QuantumNumberTuple target(qns...);
+    size_t ns = n_site();
+
+    // reach of the sites i_site, ..., ns-1
+    std::vector<ReachType> rest(ns + 1);
+    for (size_t i_site = ns; i_site > 0; --i_site) {
+      rest[i_site - 1] = rest[i_site].add(sites_[i_site - 1]);
+    }
+
+    std::map<QuantumNumberTuple, size_t> histogram;
+    histogram[std::make_tuple(QNS(0)...)] = 1;
+    for (size_t i_site = 0; i_site < ns; ++i_site) {
+      auto const & site = sites_[i_site];
+      std::map<QuantumNumberTuple, size_t> next_histogram;
+      for (auto const & h : histogram) {
+        for (size_t i_state = 0; i_state < site.n_state(); ++i_state) {
+          QuantumNumberTuple qn = elementwise(h.first) + elementwise(site.state(i_state).quantum_number());
+          if (!rest[i_site + 1].reachable(qn, target)) { continue; }
+          next_histogram[qn] += h.second;
+        }
+      }
+      histogram.swap(next_histogram);
+    }
+    auto found = histogram.find(target);
+    return (found == histogram.end()) ? 0 : found->second;
+  }
+
   //! Check whether the given operator's binary representations are large enough. 
   template <typename PureOperatorType>
   bool comply(const PureOperatorType& op) {
@@ -280,5 +433,6 @@ private:
 
 private:
   std::vector<SiteType> sites_;
+  std::shared_ptr<const Layout> layout_; //!< null unless finalized.
 }; // class System
 
@@ -3,4 +3,7 @@
 
 #include "operator/generic_operator.h"
 #include "operator/pure_operator.h"
-#include "operator/raw_rep_operator.h"
\ No newline at end of file
+#include "operator/raw_rep_operator.h"
+#include "operator/term_index.h"
+#include "operator/compiled_operator.h"
+#include "operator/compact_operator.h"
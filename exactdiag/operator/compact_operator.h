@@ -0,0 +1,126 @@
+#pragma once
+#include "../global.h"
+
+#include "../hilbertspace/compact_state.h"
+#include "generic_operator.h"
+#include "pure_operator.h"
+#include "term_index.h"
+
+//! @class CompactOperator
+//!
+//! @brief MixedOperator acting on compact representations (see CompactRep).
+//!
+//! Every term is stored as words of the representation. The fermion sign is the parity
+//! of the popcount of the state and the digits of the fp_check sites (see CompactCodec),
+//! so no fermion parity bitset is needed, neither for the input nor for the results.
+//! The terms are looked up with a TermIndex, so the results are grouped by mask and col
+//! rather than in the order of the terms. The index is built once from all the terms in the
+//! constructor (build the MixedOperator first), and apply is safe to call from many threads.
+//!
+//! @tparam _Scalar Scalar(Field) type of the coefficient.
+//! @tparam _RepSize Number of bits of the Rep
+//! @tparam _SiteSize Number of bits of the Site (for fermion parity counting).
+template <typename _Scalar, size_t _RepSize, size_t _SiteSize>
+class CompactOperator : public GenericOperator<_Scalar>
+{
+ public:
+  static const size_t RepSize = _RepSize;
+  static const size_t SiteSize = _SiteSize;
+
+  using Scalar = _Scalar;
+  using Rep = CompactRep<RepSize>;
+  using Word = typename Rep::type;
+  using CodecType = CompactCodec<RepSize, SiteSize>;
+  using MixedOperatorType = MixedOperator<Scalar, RepSize, SiteSize>;
+  using PureOperatorType = PureOperator<Scalar, RepSize, SiteSize>;
+
+  struct Term {
+    Word mask, row, col;
+    Word check;         //!< digits whose popcount parity gives the fermion sign
+    bool check_offset;  //!< constant part of the fermion sign
+    Scalar coefficient;
+
+    bool match(const Word& w) const { return (w & mask) == col; }
+
+    std::tuple<Word, Scalar> apply(const Word& w) const {
+      assert(match(w));
+      bool odd = ((Rep::popcount(w & check) & 1) != 0) != check_offset;
+      return std::make_tuple((w & ~mask) | row, odd ? -coefficient : coefficient);
+    }
+  };
+
+  CompactOperator() { }
+
+  //! Constructor
+  //! @param op Operator
+  //! @param codec Codec of the System which op is defined on.
+  CompactOperator(const MixedOperatorType& op, const CodecType& codec)
+  {
+    for (size_t i_term = 0; i_term < op.n_term(); ++i_term) {
+      push_back(op.term(i_term), codec);
+    }
+    build_index();
+  }
+
+  const Term & term(size_t i_term) const {
+    assert(i_term < terms_.size());
+    return terms_[i_term];
+  }
+
+  //! Number of terms.
+  size_t n_term() const { return terms_.size(); }
+
+  //! Number of distinct masks.
+  size_t n_mask() const { return index_.n_group(); }
+
+  std::vector<std::tuple<Word, Scalar>> apply(const Word& w) const {
+    std::vector<std::tuple<Word, Scalar>> ret;
+    apply(w, ret);
+    return ret;
+  }
+
+  //! Append the results to a caller-owned buffer (which is not cleared).
+  void apply(const Word& w, std::vector<std::tuple<Word, Scalar>>& out) const {
+    for_each_match(w, [&](const Term& term) {
+      out.push_back(term.apply(w));
+    });
+  }
+
+  //! Call visit(word, value) for every matching term, without allocation.
+  template <typename Visitor>
+  void apply(const Word& w, Visitor&& visit) const {
+    for_each_match(w, [&](const Term& term) {
+      auto r = term.apply(w);
+      visit(std::get<0>(r), std::get<1>(r));
+    });
+  }
+
+ private:
+  //! Call func(term) for every term which matches the state.
+  template <typename Function>
+  void for_each_match(const Word& w, Function&& func) const {
+    index_.for_each_match(w, [&](size_t i_term) { func(terms_[i_term]); });
+  }
+
+  void push_back(const PureOperatorType& op, const CodecType& codec) {
+    Term term;
+    term.mask = codec.encode(op.mask());
+    term.row = codec.encode(op.row());
+    term.col = codec.encode(op.col());
+    std::tie(term.check, term.check_offset) = codec.parity_check(op.fp_check());
+    term.coefficient = op.coefficient();
+    terms_.push_back(term);
+  }
+
+  void build_index() {
+    std::vector<Word> masks, cols;
+    for (auto const & term : terms_) {
+      masks.push_back(term.mask);
+      cols.push_back(term.col);
+    }
+    index_ = TermIndex<Word, typename Rep::Hash>(masks, cols, RepSize);
+  }
+
+  std::vector<Term> terms_;
+  TermIndex<Word, typename Rep::Hash> index_;
+};
@@ -0,0 +1,89 @@
+#pragma once
+#include "../global.h"
+
+#include "generic_operator.h"
+#include "pure_operator.h"
+#include "term_index.h"
+
+//! @class CompiledMixedOperator
+//!
+//! @brief Read-only MixedOperator with a TermIndex.
+//!
+//! apply() visits only the terms which match the state, at the cost of one table lookup
+//! per distinct mask. The results are the same as those of MixedOperator::apply,
+//! but grouped by mask and col rather than in the order of the terms.
+//!
+//! @tparam _Scalar Scalar(Field) type of the coefficient.
+//! @tparam _RepSize Number of bits of the Rep
+//! @tparam _SiteSize Number of bits of the Site (for fermion parity counting).
+template <typename _Scalar, size_t _RepSize, size_t _SiteSize>
+class CompiledMixedOperator : public GenericOperator<_Scalar>
+{
+ public:
+  static const size_t RepSize = _RepSize;
+  static const size_t SiteSize = _SiteSize;
+
+  using Scalar = _Scalar;
+  using Rep = std::bitset<RepSize>;
+  using SiteRep = std::bitset<SiteSize>;
+  using PureOperatorType = PureOperator<Scalar, RepSize, SiteSize>;
+  using MixedOperatorType = MixedOperator<Scalar, RepSize, SiteSize>;
+
+  CompiledMixedOperator() { }
+
+  CompiledMixedOperator(const MixedOperatorType& op)
+  {
+    std::vector<Rep> masks, cols;
+    for (size_t i_term = 0; i_term < op.n_term(); ++i_term) {
+      terms_.push_back(op.term(i_term));
+      masks.push_back(op.term(i_term).mask());
+      cols.push_back(op.term(i_term).col());
+    }
+    index_ = TermIndex<Rep>(masks, cols, RepSize);
+  }
+
+  const PureOperatorType & term(size_t i_term) const {
+    assert(i_term < terms_.size());
+    return terms_[i_term];
+  }
+
+  //! Number of terms.
+  size_t n_term() const { return terms_.size(); }
+
+  //! Number of distinct masks.
+  size_t n_mask() const { return index_.n_group(); }
+
+  std::vector<std::tuple<Rep, SiteRep, Scalar>>
+  apply(const Rep& bvec, const SiteRep& fvec) const {
+    std::vector<std::tuple<Rep, SiteRep, Scalar>> ret;
+    apply(bvec, fvec, ret);
+    return ret;
+  }
+
+  //! Append the results to a caller-owned buffer (which is not cleared).
+  void apply(const Rep& bvec, const SiteRep& fvec,
+             std::vector<std::tuple<Rep, SiteRep, Scalar>>& out) const {
+    for_each_match(bvec, [&](const PureOperatorType& term) {
+      out.push_back(term.apply(bvec, fvec));
+    });
+  }
+
+  //! Call visit(rep, site_rep, value) for every matching term, without allocation.
+  template <typename Visitor>
+  void apply(const Rep& bvec, const SiteRep& fvec, Visitor&& visit) const {
+    for_each_match(bvec, [&](const PureOperatorType& term) {
+      auto r = term.apply(bvec, fvec);
+      visit(std::get<0>(r), std::get<1>(r), std::get<2>(r));
+    });
+  }
+
+ private:
+  //! Call func(term) for every term which matches the state.
+  template <typename Function>
+  void for_each_match(const Rep& bvec, Function&& func) const {
+    index_.for_each_match(bvec, [&](size_t i_term) { func(terms_[i_term]); });
+  }
+
+  std::vector<PureOperatorType> terms_;
+  TermIndex<Rep> index_;
+};
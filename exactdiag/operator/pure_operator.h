@@ -121,6 +121,11 @@ class PureOperator : public GenericOperator<_Scalar>
     return ((bvec & mask_) == col_);
   }
 
+  //! Whether the operator maps every matching state to itself.
+  bool is_diagonal() const {
+    return (row_ == col_) && (fp_row_ == fp_col_);
+  }
+
   std::tuple<Rep, SiteRep, Scalar> apply(const Rep& bvec, const SiteRep& fvec) const {
     assert(match(bvec));
     std::tuple<Rep, SiteRep, Scalar> ret;
@@ -210,6 +215,80 @@ class MixedOperator : public GenericOperator<_Scalar>
     return terms_[i_term];
   }
 
+  //! Number of terms.
+  size_t n_term() const { return terms_.size(); }
+
+  //! Diagonal terms (see PureOperator::is_diagonal).
+  MixedOperator diagonal() const {
+    MixedOperator ret;
+    for (auto const & term : terms_) {
+      if (term.is_diagonal()) { ret.add(term); }
+    }
+    return ret;
+  }
+
+  //! Off-diagonal terms, which change the state they act on.
+  MixedOperator off_diagonal() const {
+    MixedOperator ret;
+    for (auto const & term : terms_) {
+      if (!term.is_diagonal()) { ret.add(term); }
+    }
+    return ret;
+  }
+
+  //! @brief Merge the terms with the same structure, and remove the zero terms.
+  //!
+  //! Terms are the same if all of their bitsets (mask, row, col, and the fermion parity ones)
+  //! agree. Their coefficients are summed into the first of them, and terms whose
+  //! coefficient is smaller than epsilon are dropped.
+  //! @return Number of terms eliminated.
+  size_t simplify() {
+    struct TermHash {
+      size_t operator()(const PureOperatorType* op) const {
+        size_t h = std::hash<Rep>()(op->mask());
+        for (size_t v : {std::hash<Rep>()(op->row()), std::hash<Rep>()(op->col()),
+                         std::hash<SiteRep>()(op->fp_mask()), std::hash<SiteRep>()(op->fp_row()),
+                         std::hash<SiteRep>()(op->fp_col()), std::hash<SiteRep>()(op->fp_check())}) {
+          h ^= v + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2);
+        }
+        return h;
+      }
+    };
+    struct TermEqual {
+      bool operator()(const PureOperatorType* x, const PureOperatorType* y) const {
+        return x->mask() == y->mask() && x->row() == y->row() && x->col() == y->col()
+               && x->fp_mask() == y->fp_mask() && x->fp_row() == y->fp_row()
+               && x->fp_col() == y->fp_col() && x->fp_check() == y->fp_check();
+      }
+    };
+
+    std::unordered_map<const PureOperatorType*, size_t, TermHash, TermEqual> position;
+    std::vector<Scalar> coefficients;
+    for (auto const & term : terms_) {
+      auto found = position.find(&term);
+      if (found == position.end()) {
+        position[&term] = coefficients.size();
+        coefficients.push_back(term.coefficient());
+      } else {
+        coefficients[found->second] += term.coefficient();
+      }
+    }
+
+    std::vector<PureOperatorType> simplified;
+    for (auto const & term : terms_) {
+      auto found = position.find(&term);
+      if (found->first != &term) { continue; }   // merged into an earlier term
+      auto const & coefficient = coefficients[found->second];
+      if (std::abs(coefficient) < std::numeric_limits<Scalar>::epsilon()) { continue; }
+      simplified.emplace_back(term.mask(), term.row(), term.col(),
+                              term.fp_mask(), term.fp_row(), term.fp_col(), term.fp_check(),
+                              coefficient);
+    }
+    size_t n_eliminated = terms_.size() - simplified.size();
+    terms_.swap(simplified);
+    return n_eliminated;
+  }
+
 
   void display(std::ostream& os = std::cout, std::string prefix = "") const
   {
@@ -222,12 +301,31 @@ class MixedOperator : public GenericOperator<_Scalar>
   std::vector<std::tuple<Rep, SiteRep, Scalar>>
   apply(const Rep& bvec, const SiteRep& fvec) const {
     std::vector<std::tuple<Rep, SiteRep, Scalar>> ret;
+    apply(bvec, fvec, ret);
+    return ret;
+  }
+
+  //! Append the results to a caller-owned buffer.
+  //! The buffer is not cleared, so that its capacity can be reused from row to row
+  //! without any allocation in steady state.
+  void apply(const Rep& bvec, const SiteRep& fvec,
+             std::vector<std::tuple<Rep, SiteRep, Scalar>>& out) const {
     for (auto const & term : terms_) {
       if (term.match(bvec)) {
-        ret.push_back(term.apply(bvec, fvec));
+        out.push_back(term.apply(bvec, fvec));
+      }
+    }
+  }
+
+  //! Call visit(rep, site_rep, value) for every matching term, without allocation.
+  template <typename Visitor>
+  void apply(const Rep& bvec, const SiteRep& fvec, Visitor&& visit) const {
+    for (auto const & term : terms_) {
+      if (term.match(bvec)) {
+        auto r = term.apply(bvec, fvec);
+        visit(std::get<0>(r), std::get<1>(r), std::get<2>(r));
       }
     }
-    return ret;
   }
 
  private:
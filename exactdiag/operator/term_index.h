@@ -0,0 +1,198 @@
+#pragma once
+#include "../global.h"
+
+namespace detail {
+
+template <size_t N> inline
+bool test_bit(const std::bitset<N>& b, size_t pos) { return b[pos]; }
+
+template <typename Word> inline
+bool test_bit(const Word& w, size_t pos) { return ((w >> pos) & Word(1)) != Word(0); }
+
+} // namespace detail
+
+
+//! @class TermIndex
+//!
+//! @brief Index of the terms of an operator by their mask and col.
+//!
+//! A term matches a state when (state & mask) == col. The terms are grouped by their mask.
+//! For a mask of at most MaxTableBit bits, the masked bits of the state are gathered into
+//! a small integer, which indexes a table of the terms with that col; longer masks are
+//! compared against the list of their cols. Applying an operator then costs one lookup
+//! per distinct mask plus one visit per matching term, instead of one match() per term.
+//!
+//! A mask with at most two cols of one term each, such as a hopping term and its Hermitian
+//! conjugate, is stored inline as a pair: one AND and at most two comparisons, without a
+//! table or a list, so hopping Hamiltonians cost one test per pair of sites.
+//!
+//! @tparam Key Type of the representation (bitset or machine word).
+//! @tparam Hash Hash function of Key.
+template <typename Key, typename Hash = std::hash<Key>>
+class TermIndex
+{
+ public:
+  //! Maximum number of bits of a mask with a lookup table.
+  static const size_t MaxTableBit = 8;
+  //! Maximum number of distinct cols of a mask which are compared one by one instead.
+  static const size_t MaxListCol = 4;
+  static const size_t npos = static_cast<size_t>(-1);
+
+  TermIndex() : n_group_(0) { }
+
+  //! Constructor
+  //! @param masks Mask of every term.
+  //! @param cols Col of every term.
+  //! @param n_bit Number of bits of the representation.
+  //! Terms with the same mask and col are visited in their original order.
+  TermIndex(const std::vector<Key>& masks, const std::vector<Key>& cols, size_t n_bit)
+      : n_group_(0)
+  {
+    assert(masks.size() == cols.size());
+    std::unordered_map<Key, size_t, Hash> group_of_mask;
+    std::vector<std::vector<Key>> group_cols;
+    std::vector<std::vector<std::vector<size_t>>> group_terms;
+    for (size_t i_term = 0; i_term < masks.size(); ++i_term) {
+      auto found = group_of_mask.find(masks[i_term]);
+      size_t i_group;
+      if (found == group_of_mask.end()) {
+        i_group = groups_.size();
+        group_of_mask[masks[i_term]] = i_group;
+        groups_.emplace_back();
+        groups_.back().mask = masks[i_term];
+        group_cols.emplace_back();
+        group_terms.emplace_back();
+      } else {
+        i_group = found->second;
+      }
+      auto & gc = group_cols[i_group];
+      size_t i_col = static_cast<size_t>(std::find(gc.begin(), gc.end(), cols[i_term]) - gc.begin());
+      if (i_col == gc.size()) {
+        gc.push_back(cols[i_term]);
+        group_terms[i_group].emplace_back();
+      }
+      group_terms[i_group][i_col].push_back(i_term);
+    }
+
+    n_group_ = groups_.size();
+    std::vector<Group> all_groups;
+    all_groups.swap(groups_);
+
+    // lay out the terms of each (mask, col) contiguously, except for the pairs.
+    for (size_t i_group = 0; i_group < all_groups.size(); ++i_group) {
+      auto const & col_terms = group_terms[i_group];
+      bool pair = col_terms.size() <= 2;
+      for (auto const & terms : col_terms) { pair = pair && terms.size() == 1; }
+      if (pair) {
+        size_t last = col_terms.size() - 1;   // a single col is stored twice
+        pairs_.push_back(Pair{all_groups[i_group].mask,
+                              {group_cols[i_group][0], group_cols[i_group][last]},
+                              {col_terms[0][0], col_terms[last][0]}});
+        continue;
+      }
+      groups_.push_back(all_groups[i_group]);
+      auto & group = groups_.back();
+      std::vector<size_t> positions;
+      for (size_t pos = 0; pos < n_bit; ++pos) {
+        if (detail::test_bit(group.mask, pos)) { positions.push_back(pos); }
+      }
+      bool use_table = positions.size() <= MaxTableBit && group_cols[i_group].size() > MaxListCol;
+      group.n_position = 0;
+      group.table_offset = npos;
+      if (use_table) {
+        group.n_position = positions.size();
+        std::copy(positions.begin(), positions.end(), group.positions);
+        group.table_offset = table_.size();
+        table_.resize(table_.size() + (size_t(1) << positions.size()), Range{0, 0});
+      }
+      group.col_begin = cols_.size();
+      for (size_t i_col = 0; i_col < group_cols[i_group].size(); ++i_col) {
+        auto const & terms = group_terms[i_group][i_col];
+        Range range{order_.size(), order_.size() + terms.size()};
+        order_.insert(order_.end(), terms.begin(), terms.end());
+        if (use_table) {
+          table_[group.table_offset + gather(group, group_cols[i_group][i_col])] = range;
+        } else {
+          cols_.emplace_back(group_cols[i_group][i_col], range);
+        }
+      }
+      group.col_end = cols_.size();
+    }
+  }
+
+  //! Number of distinct masks.
+  size_t n_group() const { return n_group_; }
+
+  //! Number of masks stored as pairs.
+  size_t n_pair() const { return pairs_.size(); }
+
+  //! Call visit(i_term) for every term which matches the state.
+  template <typename Visitor>
+  void for_each_match(const Key& state, Visitor&& visit) const {
+    for (auto const & pair : pairs_) {
+      Key col = state & pair.mask;
+      if (col == pair.col[0]) {
+        visit(pair.term[0]);
+      } else if (col == pair.col[1]) {
+        visit(pair.term[1]);
+      }
+    }
+    for (auto const & group : groups_) {
+      Range range{0, 0};
+      if (group.table_offset != npos) {
+        range = table_[group.table_offset + gather(group, state)];
+      } else {
+        Key col = state & group.mask;
+        for (size_t i_col = group.col_begin; i_col < group.col_end; ++i_col) {
+          if (cols_[i_col].first == col) { range = cols_[i_col].second; break; }
+        }
+      }
+      for (size_t i = range.begin; i < range.end; ++i) {
+        visit(order_[i]);
+      }
+    }
+  }
+
+ private:
+  struct Range {
+    size_t begin, end;
+  };
+
+  struct Pair {
+    Key mask;
+    Key col[2];
+    size_t term[2];
+  };
+
+  struct Group {
+    Key mask;
+    size_t n_position;                             //!< number of bits of the mask, if <= MaxTableBit
+    uint16_t positions[MaxTableBit];               //!< bits of the mask
+    size_t table_offset;                           //!< position of its table in table_
+    size_t col_begin, col_end;                     //!< its cols in cols_, if it has no table
+  };
+
+  static size_t gather(const Group& group, const Key& state) {
+    size_t key = 0;
+    for (size_t i = 0; i < group.n_position; ++i) {
+      key |= size_t(detail::test_bit(state, group.positions[i])) << i;
+    }
+    return key;
+  }
+
+  size_t n_group_;
+  std::vector<Pair> pairs_;
+  std::vector<Group> groups_;                    //!< masks which are not pairs
+  std::vector<Range> table_;
+  std::vector<std::pair<Key, Range>> cols_;
+  std::vector<size_t> order_;
+};
+
+template <typename Key, typename Hash>
+const size_t TermIndex<Key, Hash>::MaxTableBit;
+
+template <typename Key, typename Hash>
+const size_t TermIndex<Key, Hash>::MaxListCol;
+
+template <typename Key, typename Hash>
+const size_t TermIndex<Key, Hash>::npos;
@@ -0,0 +1,9 @@
+#pragma once
+#include "global.h"
+
+#include "symmetry/site_permutation.h"
+#include "symmetry/bit_permutation.h"
+#include "symmetry/permutation_group.h"
+#include "symmetry/translation.h"
+#include "symmetry/z2.h"
+#include "symmetry/symmetric_sector.h"
@@ -0,0 +1,68 @@
+#pragma once
+#include "../global.h"
+
+#include "../hilbertspace/compact_state.h"
+
+//! @class BitPermutation
+//!
+//! @brief Permutation of the bits of a compact representation, with one lookup table per byte.
+//!
+//! The image of every byte of the input, for each of its 256 values, is tabulated as a word,
+//! so that
+//!
+//!     apply(w) = table[0][byte 0 of w] | table[1][byte 1 of w] | ...
+//!
+//! costs one load per byte (8 for a 64-bit representation), independent of the number of
+//! sites and of how the digits are scattered. The tables take 256 words per byte of the
+//! representation (16 KiB for 64 bits). A constant mask can be XORed to the result
+//! (e.g. to flip the occupations for a particle-hole transformation).
+//!
+//! @tparam _RepSize Number of bits of the Rep
+template <size_t _RepSize>
+class BitPermutation
+{
+ public:
+  static const size_t RepSize = _RepSize;
+  using Rep = CompactRep<RepSize>;
+  using Word = typename Rep::type;
+
+  BitPermutation() : n_byte_(0), flip_(0) { }
+
+  //! Constructor
+  //! @param bit_image Bit which every bit of the representation is moved to (the bits
+  //! beyond its size are dropped).
+  //! @param flip Mask XORed to the permuted representation.
+  explicit BitPermutation(const std::vector<size_t>& bit_image, const Word& flip = Word(0))
+      : n_byte_((bit_image.size() + 7) / 8), flip_(flip), table_(n_byte_ * 256, Word(0))
+  {
+    assert(bit_image.size() <= RepSize);
+    for (size_t i_bit = 0; i_bit < bit_image.size(); ++i_bit) {
+      assert(bit_image[i_bit] < RepSize);
+      size_t i_byte = i_bit / 8;
+      size_t bit = i_bit % 8;
+      for (size_t value = 0; value < 256; ++value) {
+        if ((value >> bit) & 1) { table_[i_byte * 256 + value] |= Word(1) << bit_image[i_bit]; }
+      }
+    }
+  }
+
+  //! Number of bytes of the representation which are permuted.
+  size_t n_byte() const { return n_byte_; }
+
+  const Word & flip() const { return flip_; }
+
+  //! Representation with its bits permuted (and flipped).
+  Word apply(const Word& w) const {
+    Word ret(0);
+    const Word* table = table_.data();
+    for (size_t i_byte = 0; i_byte < n_byte_; ++i_byte, table += 256) {
+      ret |= table[Rep::low_bits(w >> (8 * i_byte), 8)];
+    }
+    return ret ^ flip_;
+  }
+
+ private:
+  size_t n_byte_;
+  Word flip_;
+  std::vector<Word> table_;   //!< n_byte x 256 images
+};
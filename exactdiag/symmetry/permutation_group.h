@@ -0,0 +1,117 @@
+#pragma once
+#include "../global.h"
+
+#include <complex>
+#include <map>
+
+#include "site_permutation.h"
+
+//! @class PermutationGroup
+//!
+//! @brief Finite group of site permutations, generated by the given permutations
+//! (e.g. translations, rotations and reflections of a lattice).
+//!
+//! The elements are found by closing the generators under composition. The identity is
+//! the first element. The multiplication by the generators (g_a * h for every element h)
+//! is tabulated, which determines a one-dimensional representation from the characters of
+//! the generators: characters() propagates them to all the elements, and checks that they
+//! are consistent, i.e. that they satisfy every relation of the group.
+//!
+//! Only one-dimensional representations are supported (see SymmetricSectorGenerator),
+//! e.g. the momenta of a translation group, or the characters of A1, A2, B1, B2 of a point group.
+//!
+//! @tparam _RepSize Number of bits of the Rep
+//! @tparam _SiteSize Number of bits of the Site (for fermion parity counting).
+template <size_t _RepSize, size_t _SiteSize>
+class PermutationGroup
+{
+ public:
+  static const size_t RepSize = _RepSize;
+  static const size_t SiteSize = _SiteSize;
+  using PermutationType = SitePermutation<RepSize, SiteSize>;
+  using Complex = std::complex<double>;
+
+  //! Largest number of elements, against generators of a huge group by mistake.
+  static const size_t MaxElement = 1 << 16;
+
+  //! Constructor
+  //! @param generators Generators of the group.
+  //! @throw std::length_error if there are no generators, or the group has more than MaxElement elements.
+  PermutationGroup(const std::vector<PermutationType>& generators)
+      : generators_(generators)
+  {
+    if (generators_.empty()) {
+      throw std::length_error("PermutationGroup(): no generators");
+    }
+    std::map<std::vector<size_t>, size_t> position;
+    elements_.push_back(generators_[0] * generators_[0].inverse());
+    position[elements_[0].image()] = 0;
+    for (size_t i_element = 0; i_element < elements_.size(); ++i_element) {
+      std::vector<size_t> products;
+      for (auto const & generator : generators_) {
+        PermutationType g = generator * elements_[i_element];
+        auto found = position.find(g.image());
+        if (found == position.end()) {
+          if (elements_.size() == MaxElement) {
+            throw std::length_error("PermutationGroup(): too many elements");
+          }
+          found = position.insert(std::make_pair(g.image(), elements_.size())).first;
+          elements_.push_back(g);
+        }
+        products.push_back(found->second);
+      }
+      product_.push_back(products);
+    }
+  }
+
+  //! Number of generators.
+  size_t n_generator() const { return generators_.size(); }
+
+  const PermutationType & generator(size_t a) const { return generators_[a]; }
+
+  //! Order of the group.
+  size_t n_element() const { return elements_.size(); }
+
+  const std::vector<PermutationType> & elements() const { return elements_; }
+
+  //! Index of the element g_a * h.
+  size_t product(size_t a, size_t i_element) const { return product_[i_element][a]; }
+
+  //! @brief Characters of the one-dimensional representation with the given characters of the generators.
+  //! @return chi(g) of every element, in the order of elements().
+  //! @throw std::length_error if there is not one character per generator.
+  //! @throw std::domain_error if the characters are not a representation of the group.
+  std::vector<Complex> characters(const std::vector<Complex>& generator_characters) const {
+    const double epsilon = 1E-8;
+    if (generator_characters.size() != generators_.size()) {
+      throw std::length_error("PermutationGroup::characters(): one character per generator is required");
+    }
+    std::vector<Complex> ret(elements_.size(), Complex(0));
+    std::vector<bool> known(elements_.size(), false);
+    ret[0] = Complex(1);
+    known[0] = true;
+    // the elements are in the order of their discovery, so every element is known before its products.
+    for (size_t i_element = 0; i_element < elements_.size(); ++i_element) {
+      assert(known[i_element]);
+      for (size_t a = 0; a < generators_.size(); ++a) {
+        size_t j = product_[i_element][a];
+        Complex c = generator_characters[a] * ret[i_element];
+        if (!known[j]) {
+          ret[j] = c;
+          known[j] = true;
+        } else if (std::abs(ret[j] - c) > epsilon) {
+          throw std::domain_error("PermutationGroup::characters(): not a representation of the group");
+        }
+      }
+    }
+    return ret;
+  }
+
+ private:
+  std::vector<PermutationType> generators_;
+  std::vector<PermutationType> elements_;
+  std::vector<std::vector<size_t>> product_;   //!< index of g_a * h, for every h and a
+};
+
+template <size_t _RepSize, size_t _SiteSize>
+const size_t PermutationGroup<_RepSize, _SiteSize>::MaxElement;
@@ -0,0 +1,152 @@
+#pragma once
+#include "../global.h"
+
+#include "../hilbertspace.h"
+#include "bit_permutation.h"
+
+//! @class SitePermutation
+//!
+//! @brief Permutation of the sites of a System, acting on compact representations.
+//!
+//! The permutation g moves the state of site i to site image(i). As an operator,
+//! g c_i^dagger g^-1 = c_image(i)^dagger, so a basis state, which is a product of the
+//! fermion operators of its occupied sites in the order of the sites, is mapped to
+//!
+//!     g |w> = (-1)^n |g w>
+//!
+//! where n is the number of inversions of the permutation restricted to the sites with
+//! odd fermion parity (pairs i < j with image(i) > image(j)). The inversions are counted
+//! with one mask per site, of the lower sites which are mapped above it.
+//!
+//! Permutations compose as operators: (g * h) is h followed by g.
+//!
+//! @tparam _RepSize Number of bits of the Rep
+//! @tparam _SiteSize Number of bits of the Site (for fermion parity counting).
+template <size_t _RepSize, size_t _SiteSize>
+class SitePermutation
+{
+ public:
+  static const size_t RepSize = _RepSize;
+  static const size_t SiteSize = _SiteSize;
+  using Rep = CompactRep<RepSize>;
+  using Word = typename Rep::type;
+  using BitSite = std::bitset<SiteSize>;
+
+  SitePermutation() { }
+
+  //! Constructor
+  //! @param system %System
+  //! @param image Site which the state of every site is moved to.
+  //! @throw std::length_error if image does not have one entry per site.
+  //! @throw std::domain_error if image is not a permutation, or maps a site to a different kind of site.
+  template <typename ... QNS>
+  SitePermutation(const System<QNS...>& system, const std::vector<size_t>& image)
+      : image_(image)
+  {
+    size_t ns = system.n_site();
+    if (image.size() != ns) {
+      throw std::length_error("SitePermutation(): image must have one entry per site");
+    }
+    std::vector<bool> seen(ns, false);
+    for (size_t i_site = 0; i_site < ns; ++i_site) {
+      if (image[i_site] >= ns || seen[image[i_site]]) {
+        throw std::domain_error("SitePermutation(): image is not a permutation");
+      }
+      seen[image[i_site]] = true;
+      if (system.site(i_site) != system.site(image[i_site])) {
+        throw std::domain_error("SitePermutation(): site mapped to a different kind of site");
+      }
+      start_digit_.push_back(system.start_digit(i_site));
+      n_digit_.push_back(system.site(i_site).n_digit());
+    }
+    init();
+  }
+
+  //! Number of sites.
+  size_t n_site() const { return image_.size(); }
+
+  //! Site which the state of the given site is moved to.
+  size_t image(size_t i_site) const { return image_[i_site]; }
+  const std::vector<size_t> & image() const { return image_; }
+
+  //! Digit which every digit of the representation is moved to.
+  std::vector<size_t> digit_image() const {
+    std::vector<size_t> ret;
+    for (size_t i_site = 0; i_site < image_.size(); ++i_site) {
+      for (size_t d = 0; d < n_digit_[i_site]; ++d) { ret.push_back(start_digit_[image_[i_site]] + d); }
+    }
+    return ret;
+  }
+
+  //! Table-driven kernel of apply().
+  BitPermutation<RepSize> kernel() const { return BitPermutation<RepSize>(digit_image()); }
+
+  bool is_identity() const {
+    for (size_t i_site = 0; i_site < image_.size(); ++i_site) {
+      if (image_[i_site] != i_site) { return false; }
+    }
+    return true;
+  }
+
+  //! Representation of the permuted state.
+  Word apply(const Word& w) const {
+    Word ret(0);
+    for (size_t i_site = 0; i_site < image_.size(); ++i_site) {
+      uint64_t digits = Rep::low_bits(w >> start_digit_[i_site], n_digit_[i_site]);
+      ret |= Word(digits) << start_digit_[image_[i_site]];
+    }
+    return ret;
+  }
+
+  //! @brief Whether the fermion sign of the permutation is -1.
+  //! @param fermion_parity Fermion parity of every site of the state (see CompactCodec::fermion_parity).
+  bool odd(const BitSite& fermion_parity) const {
+    bool ret = false;
+    for (size_t i_site = 0; i_site < image_.size(); ++i_site) {
+      if (fermion_parity.test(i_site)) {
+        ret = (ret != (((fermion_parity & inversion_[i_site]).count() & 1) != 0));
+      }
+    }
+    return ret;
+  }
+
+  //! Composition: rhs first, then this.
+  SitePermutation operator*(const SitePermutation& rhs) const {
+    assert(rhs.n_site() == n_site());
+    SitePermutation ret(*this);
+    for (size_t i_site = 0; i_site < image_.size(); ++i_site) {
+      ret.image_[i_site] = image_[rhs.image_[i_site]];
+    }
+    ret.init();
+    return ret;
+  }
+
+  SitePermutation inverse() const {
+    SitePermutation ret(*this);
+    for (size_t i_site = 0; i_site < image_.size(); ++i_site) {
+      ret.image_[image_[i_site]] = i_site;
+    }
+    ret.init();
+    return ret;
+  }
+
+  bool operator==(const SitePermutation& rhs) const { return image_ == rhs.image_; }
+  bool operator!=(const SitePermutation& rhs) const { return image_ != rhs.image_; }
+  bool operator<(const SitePermutation& rhs) const { return image_ < rhs.image_; }
+
+ private:
+  //! Masks of the inversions.
+  void init() {
+    inversion_.assign(image_.size(), BitSite());
+    for (size_t j = 0; j < image_.size(); ++j) {
+      for (size_t i = 0; i < j; ++i) {
+        if (image_[i] > image_[j]) { inversion_[j].set(i); }
+      }
+    }
+  }
+
+  std::vector<size_t> image_;
+  std::vector<size_t> start_digit_;
+  std::vector<size_t> n_digit_;
+  std::vector<BitSite> inversion_;   //!< sites i < j with image(i) > image(j), for every j
+};
@@ -0,0 +1,248 @@
+#pragma once
+#include "../global.h"
+
+#include <complex>
+
+#include "../hilbertspace.h"
+#include "../utility/parallel.h"
+#include "bit_permutation.h"
+#include "site_permutation.h"
+
+//! @class BasicSymmetricSectorGenerator
+//!
+//! @brief Generator of the symmetry-adapted basis of a sector, for a group of symmetry
+//! operations and a one-dimensional representation chi of it.
+//!
+//! The basis state of a representative r (the smallest representation in its orbit) is
+//!
+//!     |r> = P |r> / norm(r),   P = (1/N) sum_g conj(chi(g)) g
+//!
+//! which satisfies g |r> = chi(g) |r>. Its squared norm <r|P|r> is the sum of
+//! conj(chi(g)) (+-1) over the stabilizer of r, i.e. |stabilizer| / N, or zero if the
+//! representation is not compatible with the state (including the fermion signs of the
+//! stabilizer); such orbits have no basis state.
+//!
+//! A state w is mapped to its representative r = g w by the element g which minimizes g w,
+//! with g |w> = (-1)^n |r>. Then P |w> = (-1)^n conj(chi(g)) P |r>, which gives the matrix
+//! elements of an operator which commutes with the group (see SymmetricHamiltonianBuilder).
+//!
+//! The representatives are found with the BitPermutation kernel of every element (a few
+//! table lookups per element, rather than a loop over the sites). The fermion sign is only
+//! evaluated for the element which gives the representative, and for the stabilizer.
+//!
+//! An element of the group is any type with
+//!
+//!     BitPermutation<RepSize> kernel() const;          // g w
+//!     bool odd(const std::bitset<SiteSize>&) const;    // sign of g |w>, from the fermion parity of w
+//!
+//! such as SitePermutation and Z2Operation.
+//!
+//! @tparam ElementType Type of the elements of the group.
+//! @tparam QuantumNumbers List of U(1) quantum numbers.
+template <typename ElementType, typename ...QuantumNumbers>
+class BasicSymmetricSectorGenerator
+{
+ public:
+  using SystemType = System<QuantumNumbers...>;
+  static const size_t RepSize = ElementType::RepSize;
+  static const size_t SiteSize = ElementType::SiteSize;
+  using BitRep = std::bitset<RepSize>;
+  using BitSite = std::bitset<SiteSize>;
+  using QuantumNumberTuple = typename SystemType::QuantumNumberTuple;
+  using CodecType = CompactCodec<RepSize, SiteSize>;
+  using Rep = CompactRep<RepSize>;
+  using Word = typename CodecType::Word;
+  using BasisType = std::vector<Word>;
+  using PermutationType = ElementType;
+  using BitPermutationType = BitPermutation<RepSize>;
+  using Complex = std::complex<double>;
+
+  //! Tolerance for the norm of a compatible orbit.
+  static constexpr double Epsilon = 1E-8;
+
+  //! Representative of a state, see Sector::representative.
+  struct Representative
+  {
+    Word word;          //!< representation of the representative
+    size_t index;       //!< index of the basis state, or npos
+    size_t element;     //!< g with g w = word
+    bool odd;           //!< g |w> = -|word>
+  };
+
+  struct Sector
+  {
+    static const size_t npos = static_cast<size_t>(-1);
+
+    BasisType basis;             //!< representatives, ascending
+    std::vector<double> norms;   //!< sqrt(<r|P|r>) of every representative
+    CodecType codec;
+    std::vector<PermutationType> elements;
+    std::vector<BitPermutationType> kernels;   //!< of the elements
+    std::vector<Complex> characters;
+
+    //! Dimension of the sector.
+    size_t size() const { return basis.size(); }
+
+    //! Compact representation of the representative of the given index.
+    Word word(size_t idx) const { return basis[idx]; }
+
+    //! Representative of the given index, as used by PureOperator and MixedOperator.
+    std::tuple<BitRep, BitSite> state(size_t idx) const { return codec.decode(basis[idx]); }
+
+    //! Norm of the projection of the representative of the given index.
+    double norm(size_t idx) const { return norms[idx]; }
+
+    //! Index of the given representative.
+    //! @return npos if the representation is not a representative in the sector.
+    size_t find_word(const Word& w) const {
+      auto found = std::lower_bound(basis.begin(), basis.end(), w, &Rep::less);
+      return (found != basis.end() && *found == w) ? static_cast<size_t>(found - basis.begin()) : npos;
+    }
+
+    //! @brief Representative of any state, and the element which maps the state to it.
+    //!
+    //! The index is npos if the orbit is not compatible with the representation (or if the
+    //! state is not in the sector).
+    Representative representative(const Word& w) const {
+      BitSite parity = codec.fermion_parity(w);
+      Representative ret{kernels[0].apply(w), npos, 0, false};
+      for (size_t i_element = 1; i_element < kernels.size(); ++i_element) {
+        Word gw = kernels[i_element].apply(w);
+        if (Rep::less(gw, ret.word)) {
+          ret.word = gw;
+          ret.element = i_element;
+        }
+      }
+      ret.odd = elements[ret.element].odd(parity);
+      ret.index = find_word(ret.word);
+      return ret;
+    }
+  };
+
+  //! Constructor
+  //! @param system %System
+  //! @param elements All the elements of the group (see PermutationGroup, TranslationGroup and Z2Group).
+  //! @param characters chi(g) of every element, of a one-dimensional representation.
+  //! @throw std::length_error if there is not one character per element.
+  BasicSymmetricSectorGenerator(const SystemType& system,
+                                const std::vector<PermutationType>& elements,
+                                const std::vector<Complex>& characters)
+      : system_(system), elements_(elements), characters_(characters)
+  {
+    if (elements_.size() != characters_.size()) {
+      throw std::length_error("SymmetricSectorGenerator(): one character per element is required");
+    }
+    for (auto const & g : elements_) { kernels_.push_back(g.kernel()); }
+  }
+
+  //! @brief Generate the symmetry-adapted basis of the sector with the given quantum numbers.
+  //!
+  //! The states of the sector are enumerated on the subtrees of
+  //! BasicSectorGenerator::split, on n_thread threads, and only the
+  //! representatives of compatible orbits are kept, so neither the basis nor the index of
+  //! the whole sector is built. The group must map the sector onto itself (e.g. a spin flip
+  //! only conserves Spin(0)), which is checked on a state of the sector.
+  //! @param n_thread Number of threads (0 for default_n_thread()).
+  //! @param qns List of quantum numbers.
+  //! @throw std::domain_error if an element maps the sector to another one.
+  Sector generate_parallel(size_t n_thread, QuantumNumbers... qns) const
+  {
+    if (n_thread == 0) { n_thread = default_n_thread(); }
+    QuantumNumberTuple qn(qns...);
+    Sector sector;
+    sector.codec = CodecType(system_);
+    sector.elements = elements_;
+    sector.kernels = kernels_;
+    sector.characters = characters_;
+
+    using Iterator = BasisIterator<RepSize, SiteSize, QuantumNumbers...>;
+    Iterator first(system_, qn);
+    if (!first.valid()) { return sector; }
+    check_invariance(first.word(), qn);
+
+    auto prefixes = SectorGenerator<RepSize, SiteSize, QuantumNumbers...>(system_).split(&qn, 8 * n_thread);
+    std::vector<BasisType> buffers(prefixes.size());
+    std::vector<std::vector<double>> norm_buffers(prefixes.size());
+    parallel_for(0, prefixes.size(), n_thread, [&](size_t i_prefix) {
+      std::vector<size_t> stabilizer;   // reused for all the states of the subtree
+      for (Iterator iter(system_, qn, prefixes[i_prefix]); iter.valid(); ++iter) {
+        Word w = iter.word();
+        double norm = 0;
+        if (is_representative(sector.codec, w, stabilizer, norm)) {
+          buffers[i_prefix].push_back(w);
+          norm_buffers[i_prefix].push_back(norm);
+        }
+      }
+    });
+
+    size_t n_basis = 0;
+    for (auto const & buffer : buffers) { n_basis += buffer.size(); }
+    sector.basis.reserve(n_basis);
+    sector.norms.reserve(n_basis);
+    for (size_t i_prefix = 0; i_prefix < prefixes.size(); ++i_prefix) {
+      sector.basis.insert(sector.basis.end(), buffers[i_prefix].begin(), buffers[i_prefix].end());
+      sector.norms.insert(sector.norms.end(), norm_buffers[i_prefix].begin(), norm_buffers[i_prefix].end());
+    }
+    return sector;
+  }
+
+  //! @brief Generate the symmetry-adapted basis of the sector with the given quantum numbers.
+  //! @param qns List of quantum numbers.
+  Sector generate(QuantumNumbers... qns) const { return generate_parallel(1, qns...); }
+
+ private:
+  //! Quantum numbers of the state of the given representation.
+  QuantumNumberTuple quantum_number(const Word& w) const {
+    QuantumNumberTuple ret = std::make_tuple(QuantumNumbers(0)...);
+    for (size_t i_site = 0; i_site < system_.n_site(); ++i_site) {
+      auto const & site = system_.site(i_site);
+      size_t i_state = static_cast<size_t>(Rep::low_bits(w >> system_.start_digit(i_site), site.n_digit()));
+      ret = elementwise(ret) + elementwise(site.state(i_state).quantum_number());
+    }
+    return ret;
+  }
+
+  //! @throw std::domain_error if g w is not in the sector qn of w, for some element g.
+  void check_invariance(const Word& w, const QuantumNumberTuple& qn) const {
+    for (auto const & kernel : kernels_) {
+      if (!(quantum_number(kernel.apply(w)) == qn)) {
+        throw std::domain_error("SymmetricSectorGenerator::generate(): the group does not conserve the sector");
+      }
+    }
+  }
+
+  //! Whether w is the smallest in its orbit, and its orbit compatible with the representation.
+  //! @param stabilizer Scratch space for the elements which fix w (reused between states).
+  bool is_representative(const CodecType& codec, const Word& w, std::vector<size_t>& stabilizer, double& norm) const {
+    stabilizer.clear();
+    for (size_t i_element = 0; i_element < elements_.size(); ++i_element) {
+      Word gw = kernels_[i_element].apply(w);
+      if (Rep::less(gw, w)) { return false; }
+      if (gw == w) { stabilizer.push_back(i_element); }
+    }
+    BitSite parity = codec.fermion_parity(w);
+    Complex sum(0);
+    for (size_t i_element : stabilizer) {
+      Complex c = std::conj(characters_[i_element]);
+      sum += elements_[i_element].odd(parity) ? -c : c;
+    }
+    if (std::abs(sum) < Epsilon) { return false; }
+    norm = std::sqrt(sum.real() / static_cast<double>(elements_.size()));
+    return true;
+  }
+
+  const SystemType& system_;
+  std::vector<PermutationType> elements_;
+  std::vector<BitPermutationType> kernels_;
+  std::vector<Complex> characters_;
+};
+
+template <typename ElementType, typename ...QuantumNumbers>
+constexpr double BasicSymmetricSectorGenerator<ElementType, QuantumNumbers...>::Epsilon;
+
+template <typename ElementType, typename ...QuantumNumbers>
+const size_t BasicSymmetricSectorGenerator<ElementType, QuantumNumbers...>::Sector::npos;
+
+//! SymmetricSectorGenerator for groups of site permutations.
+template <size_t RepSize, size_t SiteSize, typename ...QuantumNumbers>
+using SymmetricSectorGenerator = BasicSymmetricSectorGenerator<SitePermutation<RepSize, SiteSize>, QuantumNumbers...>;
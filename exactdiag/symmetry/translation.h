@@ -0,0 +1,110 @@
+#pragma once
+#include "../global.h"
+
+#include <complex>
+
+#include "site_permutation.h"
+
+//! @class TranslationGroup
+//!
+//! @brief Abelian group generated by commuting translations of a periodic lattice.
+//!
+//! The elements are T_1^n_1 T_2^n_2 ... with 0 <= n_a < L_a, where L_a is the order of the
+//! generator T_a (e.g. the translations T_x, T_y of an nx x ny torus, with L = nx, ny).
+//! The momentum sector (k_1, k_2, ...) with 0 <= k_a < L_a is the irreducible
+//! representation
+//!
+//!     chi(T_1^n_1 T_2^n_2 ...) = exp(2 pi i sum_a k_a n_a / L_a)
+//!
+//! i.e. the states with T_a |psi> = exp(2 pi i k_a / L_a) |psi>.
+//!
+//! @tparam _RepSize Number of bits of the Rep
+//! @tparam _SiteSize Number of bits of the Site (for fermion parity counting).
+template <size_t _RepSize, size_t _SiteSize>
+class TranslationGroup
+{
+ public:
+  static const size_t RepSize = _RepSize;
+  static const size_t SiteSize = _SiteSize;
+  using PermutationType = SitePermutation<RepSize, SiteSize>;
+  using Complex = std::complex<double>;
+
+  //! Constructor
+  //! @param generators Translations along the independent directions.
+  //! @throw std::length_error if there are no generators.
+  //! @throw std::domain_error if the generators do not commute, or are not independent.
+  TranslationGroup(const std::vector<PermutationType>& generators)
+      : generators_(generators)
+  {
+    if (generators_.empty()) {
+      throw std::length_error("TranslationGroup(): no generators");
+    }
+    for (size_t a = 0; a < generators_.size(); ++a) {
+      for (size_t b = 0; b < a; ++b) {
+        if (generators_[a] * generators_[b] != generators_[b] * generators_[a]) {
+          throw std::domain_error("TranslationGroup(): generators do not commute");
+        }
+      }
+      size_t order = 1;
+      for (PermutationType g = generators_[a]; !g.is_identity(); g = g * generators_[a]) { ++order; }
+      length_.push_back(order);
+    }
+
+    elements_.assign(1, generators_[0] * generators_[0].inverse());
+    exponents_.assign(1, std::vector<size_t>(generators_.size(), 0));
+    for (size_t a = 0; a < generators_.size(); ++a) {
+      size_t n_previous = elements_.size();
+      for (size_t n = 1; n < length_[a]; ++n) {
+        for (size_t i = 0; i < n_previous; ++i) {
+          elements_.push_back(generators_[a] * elements_[elements_.size() - n_previous]);
+          exponents_.push_back(exponents_[exponents_.size() - n_previous]);
+          exponents_.back()[a] = n;
+        }
+      }
+    }
+    std::vector<PermutationType> sorted(elements_);
+    std::sort(sorted.begin(), sorted.end());
+    if (std::adjacent_find(sorted.begin(), sorted.end()) != sorted.end()) {
+      throw std::domain_error("TranslationGroup(): generators are not independent");
+    }
+  }
+
+  //! Number of generators.
+  size_t n_generator() const { return generators_.size(); }
+
+  //! Order L_a of the generator a.
+  size_t length(size_t a) const { return length_[a]; }
+
+  //! Number of elements (prod_a L_a).
+  size_t n_element() const { return elements_.size(); }
+
+  const std::vector<PermutationType> & elements() const { return elements_; }
+
+  //! Powers n_a of the generators of every element.
+  const std::vector<size_t> & exponents(size_t i_element) const { return exponents_[i_element]; }
+
+  //! @brief Characters of the momentum sector, in the order of elements().
+  //! @param momentum k_a for every generator (in units of 2 pi / L_a).
+  //! @throw std::length_error if there is not one momentum per generator.
+  std::vector<Complex> characters(const std::vector<size_t>& momentum) const {
+    if (momentum.size() != generators_.size()) {
+      throw std::length_error("TranslationGroup::characters(): one momentum per generator is required");
+    }
+    const double two_pi = 2.0 * std::acos(-1.0);
+    std::vector<Complex> ret;
+    for (auto const & n : exponents_) {
+      double phase = 0;
+      for (size_t a = 0; a < n.size(); ++a) {
+        phase += two_pi * static_cast<double>((momentum[a] * n[a]) % length_[a]) / static_cast<double>(length_[a]);
+      }
+      ret.push_back(std::polar(1.0, phase));
+    }
+    return ret;
+  }
+
+ private:
+  std::vector<PermutationType> generators_;
+  std::vector<size_t> length_;
+  std::vector<PermutationType> elements_;
+  std::vector<std::vector<size_t>> exponents_;
+};
@@ -0,0 +1,319 @@
+#pragma once
+#include "../global.h"
+
+#include <complex>
+
+#include "../hilbertspace.h"
+#include "bit_permutation.h"
+
+//! @class Z2Operation
+//!
+//! @brief Spin flip, particle-hole transformation, or a product of them, acting on
+//! compact representations.
+//!
+//! The operations map every basis state to one basis state with a sign, U |w> = +-|u(w)>,
+//! where u permutes the digits and flips some of them, so u is applied with a single
+//! BitPermutation kernel (e.g. a swap of the bits of the up and down sites).
+//!
+//! - The spin flip exchanges the states of the two sites of every given pair (e.g. the up and
+//!   down sites of a cell, which may be different Site%s with the same structure). The sign
+//!   is that of the permutation of the occupied fermion sites, as for SitePermutation.
+//! - The particle-hole transformation c_i^dagger -> eta_i c_i of two-state sites flips their
+//!   digit. With the fermion sites in order, it maps the empty state to the filled one, and
+//!
+//!     C |w> = prod_{i occupied} eta_i (-1)^pos_i |flipped w>
+//!
+//!   where pos_i is the number of fermion sites below i.
+//!
+//! The signs only depend on the fermion parities of the sites, so odd() takes the fermion
+//! parity bitset of the state (see CompactCodec::fermion_parity), as SitePermutation::odd.
+//! Products are kept as a sequence of factors, applied right to left.
+//!
+//! @tparam _RepSize Number of bits of the Rep
+//! @tparam _SiteSize Number of bits of the Site (for fermion parity counting).
+template <size_t _RepSize, size_t _SiteSize>
+class Z2Operation
+{
+ public:
+  static const size_t RepSize = _RepSize;
+  static const size_t SiteSize = _SiteSize;
+  using Rep = CompactRep<RepSize>;
+  using Word = typename Rep::type;
+  using BitSite = std::bitset<SiteSize>;
+  using BitPermutationType = BitPermutation<RepSize>;
+
+  Z2Operation() { }
+
+  //! Identity of the given system.
+  template <typename ... QNS>
+  static Z2Operation identity(const System<QNS...>& system) {
+    Z2Operation ret(system);
+    ret.init();
+    return ret;
+  }
+
+  //! @brief Exchange of the states of the sites of every pair.
+  //! @throw std::domain_error if a site is in two pairs, or the sites of a pair have different
+  //! numbers of states or different fermion parities.
+  template <typename ... QNS>
+  static Z2Operation spin_flip(const System<QNS...>& system, const std::vector<std::pair<size_t, size_t>>& pairs) {
+    Z2Operation ret(system);
+    Factor factor;
+    factor.flip = Word(0);
+    for (size_t i_site = 0; i_site < system.n_site(); ++i_site) { factor.site_image.push_back(i_site); }
+    std::vector<bool> used(system.n_site(), false);
+    for (auto const & p : pairs) {
+      size_t a = p.first, b = p.second;
+      if (a >= system.n_site() || b >= system.n_site() || a == b || used[a] || used[b]) {
+        throw std::domain_error("Z2Operation::spin_flip(): invalid pair of sites");
+      }
+      auto const & site_a = system.site(a);
+      auto const & site_b = system.site(b);
+      if (site_a.n_state() != site_b.n_state()) {
+        throw std::domain_error("Z2Operation::spin_flip(): sites with different numbers of states");
+      }
+      for (size_t i_state = 0; i_state < site_a.n_state(); ++i_state) {
+        if (site_a.state(i_state).fermion_parity() != site_b.state(i_state).fermion_parity()) {
+          throw std::domain_error("Z2Operation::spin_flip(): states with different fermion parities");
+        }
+      }
+      used[a] = used[b] = true;
+      factor.site_image[a] = b;
+      factor.site_image[b] = a;
+    }
+    factor.inversion.assign(system.n_site(), BitSite());
+    for (size_t j = 0; j < system.n_site(); ++j) {
+      for (size_t i = 0; i < j; ++i) {
+        if (factor.site_image[i] > factor.site_image[j]) { factor.inversion[j].set(i); }
+      }
+    }
+    ret.factors_.push_back(factor);
+    ret.init();
+    return ret;
+  }
+
+  //! @brief Particle-hole transformation of all the sites.
+  //! @param eta Sign eta_i = +-1 of every site (only used for the fermion sites).
+  //! @throw std::length_error if there is not one sign per site.
+  //! @throw std::domain_error if a site does not have exactly two states, one of them even.
+  template <typename ... QNS>
+  static Z2Operation particle_hole(const System<QNS...>& system, const std::vector<int>& eta) {
+    if (eta.size() != system.n_site()) {
+      throw std::length_error("Z2Operation::particle_hole(): one sign per site is required");
+    }
+    Z2Operation ret(system);
+    Factor factor;
+    factor.flip = Word(0);
+    size_t position = 0;
+    for (size_t i_site = 0; i_site < system.n_site(); ++i_site) {
+      auto const & site = system.site(i_site);
+      if (site.n_state() != 2) {
+        throw std::domain_error("Z2Operation::particle_hole(): site without exactly two states");
+      }
+      bool p0 = site.state(0).fermion_parity(), p1 = site.state(1).fermion_parity();
+      if (p0 && p1) {
+        throw std::domain_error("Z2Operation::particle_hole(): site without an even state");
+      }
+      factor.flip |= Word(1) << system.start_digit(i_site);
+      if (p0 != p1) {
+        factor.hole.set(i_site);
+        factor.hole_sign.set(i_site, (eta[i_site] < 0) != (position % 2 == 1));
+        ++position;
+      }
+    }
+    ret.factors_.push_back(factor);
+    ret.init();
+    return ret;
+  }
+
+  //! Representation of the transformed state.
+  Word apply(const Word& w) const { return kernel_.apply(w); }
+
+  //! Table-driven kernel of apply().
+  const BitPermutationType & kernel() const { return kernel_; }
+
+  //! @brief Whether the sign of U |w> is -1.
+  //! @param fermion_parity Fermion parity of every site of w.
+  bool odd(const BitSite& fermion_parity) const {
+    bool ret = false;
+    BitSite parity = fermion_parity;
+    for (auto const & factor : factors_) {
+      if (!factor.site_image.empty()) {
+        BitSite image;
+        for (size_t i_site = 0; i_site < factor.site_image.size(); ++i_site) {
+          if (!parity.test(i_site)) { continue; }
+          ret = (ret != (((parity & factor.inversion[i_site]).count() & 1) != 0));
+          image.set(factor.site_image[i_site]);
+        }
+        parity = image;
+      }
+      ret = (ret != (((parity & factor.hole_sign).count() & 1) != 0));
+      parity ^= factor.hole;
+    }
+    return ret;
+  }
+
+  //! Product: rhs first, then this.
+  Z2Operation operator*(const Z2Operation& rhs) const {
+    Z2Operation ret(rhs);
+    ret.factors_.insert(ret.factors_.end(), factors_.begin(), factors_.end());
+    ret.init();
+    return ret;
+  }
+
+ private:
+  struct Factor {
+    std::vector<size_t> site_image;   //!< site permutation, or empty
+    std::vector<BitSite> inversion;   //!< sites i < j with image(i) > image(j), for every j
+    Word flip;                        //!< digits flipped after the permutation
+    BitSite hole;                     //!< fermion sites whose parity is flipped
+    BitSite hole_sign;                //!< fermion sites with eta_i (-1)^pos_i = -1
+  };
+
+  template <typename ... QNS>
+  explicit Z2Operation(const System<QNS...>& system) {
+    for (size_t i_site = 0; i_site < system.n_site(); ++i_site) {
+      start_digit_.push_back(system.start_digit(i_site));
+      n_digit_.push_back(system.site(i_site).n_digit());
+    }
+  }
+
+  //! Transformed representation, one factor and one site at a time.
+  Word apply_factors(const Word& w) const {
+    Word ret(w);
+    for (auto const & factor : factors_) {
+      if (!factor.site_image.empty()) {
+        Word image(0);
+        for (size_t i_site = 0; i_site < factor.site_image.size(); ++i_site) {
+          uint64_t digits = Rep::low_bits(ret >> start_digit_[i_site], n_digit_[i_site]);
+          image |= Word(digits) << start_digit_[factor.site_image[i_site]];
+        }
+        ret = image;
+      }
+      ret ^= factor.flip;
+    }
+    return ret;
+  }
+
+  //! Kernel of the product of the factors: u(w) = (permutation of w) ^ u(0).
+  void init() {
+    size_t n_digit = 0;
+    for (size_t nd : n_digit_) { n_digit += nd; }
+    Word flip = apply_factors(Word(0));
+    std::vector<size_t> bit_image(n_digit);
+    for (size_t i_bit = 0; i_bit < n_digit; ++i_bit) {
+      Word image = apply_factors(Word(1) << i_bit) ^ flip;
+      for (size_t j_bit = 0; j_bit < n_digit; ++j_bit) {
+        if (Rep::low_bits(image >> j_bit, 1) != 0) { bit_image[i_bit] = j_bit; }
+      }
+    }
+    kernel_ = BitPermutationType(bit_image, flip);
+  }
+
+  std::vector<size_t> start_digit_;
+  std::vector<size_t> n_digit_;
+  std::vector<Factor> factors_;
+  BitPermutationType kernel_;
+};
+
+
+//! @class Z2Group
+//!
+//! @brief Group generated by commuting Z2 operations (e.g. spin flip and particle-hole).
+//!
+//! The element of index m is the product of the generators of the bits of m, so there are
+//! 2^n_generator elements, and the sector with eigenvalues e_a = +-1 of the generators has
+//! the characters chi(m) = prod_{a in m} e_a. The generators must square to one and commute,
+//! including the fermion signs: e.g. the particle-hole transformation of M fermion sites
+//! squares to prod_i eta_i (-1)^(M(M-1)/2), and anticommutes with the spin flip of an odd
+//! number of pairs. This is checked on the states with at most one site not in its state 0
+//! (which determine the relative sign of two such products on all the states).
+//!
+//! Use the elements and characters with BasicSymmetricSectorGenerator. The operations
+//! change some U(1) quantum numbers (e.g. Spin -> -Spin, or the charge N -> M - N), so only
+//! the sectors which they map onto themselves can be used (e.g. Spin(0), half filling).
+//!
+//! @tparam _RepSize Number of bits of the Rep
+//! @tparam _SiteSize Number of bits of the Site (for fermion parity counting).
+template <size_t _RepSize, size_t _SiteSize>
+class Z2Group
+{
+ public:
+  static const size_t RepSize = _RepSize;
+  static const size_t SiteSize = _SiteSize;
+  using OperationType = Z2Operation<RepSize, SiteSize>;
+  using Word = typename OperationType::Word;
+  using Complex = std::complex<double>;
+
+  //! Constructor
+  //! @param system %System
+  //! @param generators Z2 operations.
+  //! @throw std::length_error if there are no generators, or more than 16.
+  //! @throw std::domain_error if the generators do not square to one or do not commute.
+  template <typename ... QNS>
+  Z2Group(const System<QNS...>& system, const std::vector<OperationType>& generators)
+      : generators_(generators)
+  {
+    if (generators_.empty() || generators_.size() > 16) {
+      throw std::length_error("Z2Group(): between 1 and 16 generators are required");
+    }
+    CompactCodec<RepSize, SiteSize> codec(system);
+    std::vector<Word> states(1, Word(0));
+    for (size_t i_site = 0; i_site < system.n_site(); ++i_site) {
+      for (size_t i_state = 1; i_state < system.site(i_site).n_state(); ++i_state) {
+        states.push_back(Word(i_state) << system.start_digit(i_site));
+      }
+    }
+    for (size_t a = 0; a < generators_.size(); ++a) {
+      for (size_t b = 0; b <= a; ++b) {
+        OperationType ab = generators_[a] * generators_[b];
+        OperationType ba = generators_[b] * generators_[a];
+        for (auto const & w : states) {
+          auto parity = codec.fermion_parity(w);
+          bool fail = (a == b) ? (ab.apply(w) != w || ab.odd(parity))
+                               : (ab.apply(w) != ba.apply(w) || ab.odd(parity) != ba.odd(parity));
+          if (fail) {
+            throw std::domain_error("Z2Group(): generators must square to one and commute");
+          }
+        }
+      }
+    }
+
+    elements_.push_back(OperationType::identity(system));
+    for (auto const & generator : generators_) {
+      size_t n = elements_.size();
+      for (size_t i = 0; i < n; ++i) { elements_.push_back(generator * elements_[i]); }
+    }
+  }
+
+  size_t n_generator() const { return generators_.size(); }
+
+  size_t n_element() const { return elements_.size(); }
+
+  const std::vector<OperationType> & elements() const { return elements_; }
+
+  //! @brief Characters of the sector with the given eigenvalues of the generators.
+  //! @throw std::length_error if there is not one eigenvalue per generator.
+  //! @throw std::domain_error if an eigenvalue is not +-1.
+  std::vector<Complex> characters(const std::vector<int>& eigenvalues) const {
+    if (eigenvalues.size() != generators_.size()) {
+      throw std::length_error("Z2Group::characters(): one eigenvalue per generator is required");
+    }
+    for (int e : eigenvalues) {
+      if (e != 1 && e != -1) { throw std::domain_error("Z2Group::characters(): eigenvalues must be +-1"); }
+    }
+    std::vector<Complex> ret;
+    for (size_t m = 0; m < elements_.size(); ++m) {
+      int chi = 1;
+      for (size_t a = 0; a < generators_.size(); ++a) {
+        if ((m >> a) & 1) { chi *= eigenvalues[a]; }
+      }
+      ret.push_back(Complex(chi));
+    }
+    return ret;
+  }
+
+ private:
+  std::vector<OperationType> generators_;
+  std::vector<OperationType> elements_;
+};
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//! Number of threads used when zero is requested (number of hardware threads).
+inline size_t default_n_thread()
+{
+  size_t n = std::thread::hardware_concurrency();
+  return (n == 0) ? 1 : n;
+}
+
+//! @brief Call func(i) for every i in [begin, end) on n_thread threads.
+//!
+//! Indices are handed out one at a time in increasing order, so the loop balances
+//! itself when the iterations have very different costs.
+//! The first exception thrown by func is rethrown in the calling thread.
+//! @param n_thread Number of threads (0 for default_n_thread()).
+template <typename Function>
+void parallel_for(size_t begin, size_t end, size_t n_thread, Function&& func)
+{
+  if (n_thread == 0) { n_thread = default_n_thread(); }
+  if (end <= begin) { return; }
+  n_thread = std::min(n_thread, end - begin);
+  if (n_thread == 1) {
+    for (size_t i = begin; i < end; ++i) { func(i); }
+    return;
+  }
+
+  std::atomic<size_t> next(begin);
+  std::exception_ptr error;
+  std::mutex error_mutex;
+  auto worker = [&]() {
+    try {
+      for (size_t i = next++; i < end; i = next++) { func(i); }
+    } catch (...) {
+      std::lock_guard<std::mutex> lock(error_mutex);
+      if (!error) { error = std::current_exception(); }
+      next = end;
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for (size_t i_thread = 1; i_thread < n_thread; ++i_thread) {
+    threads.emplace_back(worker);
+  }
+  worker();
+  for (auto & t : threads) { t.join(); }
+  if (error) { std::rethrow_exception(error); }
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <complex>
+
+namespace detail {
+
+//! Complex conjugate, which keeps real scalars real (unlike std::conj).
+template <typename T> inline
+T conjugate(const T& v) { return v; }
+
+template <typename T> inline
+std::complex<T> conjugate(const std::complex<T>& v) { return std::conj(v); }
+
+//! Real part, for real and complex scalars.
+template <typename T> inline
+T real_part(const T& v) { return v; }
+
+template <typename T> inline
+T real_part(const std::complex<T>& v) { return v.real(); }
+
+} // namespace detail
@@ -0,0 +1,145 @@
+#pragma once
+
+#include <cassert>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "parallel.h"
+
+//! @class ThreadPool
+//!
+//! @brief Fixed set of worker threads with one task queue per worker (work stealing).
+//!
+//! Submitted tasks are dealt to the queues in turn. A worker takes the tasks of its own
+//! queue from the front, and when it is empty, steals from the front of the other queues.
+//! Tasks submitted in order of decreasing cost are therefore started (approximately)
+//! largest first, and the workers which finish early take over the remaining work.
+//!
+//! The first exception thrown by a task is rethrown by wait().
+class ThreadPool
+{
+ public:
+  using Task = std::function<void()>;
+
+  //! Constructor
+  //! @param n_thread Number of worker threads (0 for default_n_thread()).
+  explicit ThreadPool(size_t n_thread = 0)
+      : n_thread_(n_thread == 0 ? default_n_thread() : n_thread),
+        queues_(new Queue[n_thread_]),
+        next_queue_(0), n_queued_(0), n_pending_(0), stop_(false)
+  {
+    for (size_t i_thread = 0; i_thread < n_thread_; ++i_thread) {
+      threads_.emplace_back([this, i_thread]() { run(i_thread); });
+    }
+  }
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  //! Waits for the running tasks, and discards the queued ones.
+  ~ThreadPool() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    work_available_.notify_all();
+    for (auto & t : threads_) { t.join(); }
+  }
+
+  size_t n_thread() const { return n_thread_; }
+
+  //! Queue a task.
+  void submit(Task task) {
+    size_t i_queue;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      i_queue = next_queue_++ % n_thread_;
+    }
+    {
+      std::lock_guard<std::mutex> lock(queues_[i_queue].mutex);
+      queues_[i_queue].tasks.push_back(std::move(task));
+    }
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      ++n_queued_;
+      ++n_pending_;
+    }
+    work_available_.notify_one();
+  }
+
+  //! @brief Block until all the submitted tasks are finished.
+  //! @throw The first exception thrown by a task since the last wait().
+  void wait() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    all_done_.wait(lock, [this]() { return n_pending_ == 0; });
+    if (error_) {
+      std::exception_ptr error = error_;
+      error_ = nullptr;
+      std::rethrow_exception(error);
+    }
+  }
+
+ private:
+  struct Queue {
+    std::mutex mutex;
+    std::deque<Task> tasks;
+  };
+
+  //! Take a task from the own queue, or steal one from the others.
+  bool pop(size_t i_thread, Task& task) {
+    for (size_t k = 0; k < n_thread_; ++k) {
+      Queue& queue = queues_[(i_thread + k) % n_thread_];
+      std::lock_guard<std::mutex> lock(queue.mutex);
+      if (!queue.tasks.empty()) {
+        task = std::move(queue.tasks.front());
+        queue.tasks.pop_front();
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void run(size_t i_thread) {
+    while (true) {
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        work_available_.wait(lock, [this]() { return stop_ || n_queued_ > 0; });
+        if (stop_) { return; }
+        --n_queued_;   // claims one of the queued tasks
+      }
+      Task task;
+      bool found = pop(i_thread, task);
+      assert(found);
+      (void) found;
+      try {
+        task();
+      } catch (...) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!error_) { error_ = std::current_exception(); }
+      }
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (--n_pending_ == 0) { all_done_.notify_all(); }
+      }
+    }
+  }
+
+  size_t n_thread_;
+  std::unique_ptr<Queue[]> queues_;
+  std::vector<std::thread> threads_;
+  size_t next_queue_;
+
+  std::mutex mutex_;
+  std::condition_variable work_available_, all_done_;
+  size_t n_queued_;    //!< tasks in the queues
+  size_t n_pending_;   //!< tasks queued or running
+  bool stop_;
+  std::exception_ptr error_;
+};
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+//! @class UnionFind
+//!
+//! @brief Disjoint sets of the integers [0, n), with path halving and union by size.
+class UnionFind
+{
+ public:
+  explicit UnionFind(size_t n = 0) : parent_(n), size_(n, 1) {
+    for (size_t i = 0; i < n; ++i) { parent_[i] = i; }
+  }
+
+  size_t size() const { return parent_.size(); }
+
+  //! Representative of the set containing i.
+  size_t find(size_t i) {
+    while (parent_[i] != i) {
+      parent_[i] = parent_[parent_[i]];
+      i = parent_[i];
+    }
+    return i;
+  }
+
+  //! Merge the sets containing i and j.
+  //! @return Whether they were different.
+  bool unite(size_t i, size_t j) {
+    i = find(i);
+    j = find(j);
+    if (i == j) { return false; }
+    if (size_[i] < size_[j]) { std::swap(i, j); }
+    parent_[j] = i;
+    size_[i] += size_[j];
+    return true;
+  }
+
+  //! Label of the set of every element, numbered 0, 1, ... in the order of their smallest element.
+  std::vector<size_t> labels() {
+    std::vector<size_t> label(parent_.size(), size_t(-1)), root_label(parent_.size(), size_t(-1));
+    size_t n_label = 0;
+    for (size_t i = 0; i < parent_.size(); ++i) {
+      size_t r = find(i);
+      if (root_label[r] == size_t(-1)) { root_label[r] = n_label++; }
+      label[i] = root_label[r];
+    }
+    return label;
+  }
+
+ private:
+  std::vector<size_t> parent_;
+  std::vector<size_t> size_;
+};
+
+
+//! @class ConcurrentUnionFind
+//!
+//! @brief Disjoint sets of the integers [0, n), which several threads can merge at once.
+//!
+//! Lock-free: a root is linked under the other root with a compare-and-swap, which only
+//! succeeds while it is still a root (otherwise the roots are searched again), and find()
+//! halves the paths with compare-and-swap as well. The larger root is always linked under
+//! the smaller one, so the parents decrease along every path and no cycle can form.
+class ConcurrentUnionFind
+{
+ public:
+  explicit ConcurrentUnionFind(size_t n = 0) : parent_(n) {
+    for (size_t i = 0; i < n; ++i) { parent_[i].store(i, std::memory_order_relaxed); }
+  }
+
+  size_t size() const { return parent_.size(); }
+
+  //! Representative of the set containing i (at the time of the call).
+  size_t find(size_t i) {
+    while (true) {
+      size_t p = parent_[i].load();
+      if (p == i) { return i; }
+      size_t g = parent_[p].load();
+      if (g != p) { parent_[i].compare_exchange_weak(p, g); }
+      i = g;
+    }
+  }
+
+  //! Merge the sets containing i and j.
+  //! @return Whether they were different.
+  bool unite(size_t i, size_t j) {
+    while (true) {
+      i = find(i);
+      j = find(j);
+      if (i == j) { return false; }
+      if (i < j) { std::swap(i, j); }
+      size_t expected = i;
+      if (parent_[i].compare_exchange_strong(expected, j)) { return true; }
+    }
+  }
+
+  //! Label of the set of every element, numbered 0, 1, ... in the order of their smallest element.
+  //! Not to be called while other threads are merging.
+  std::vector<size_t> labels() {
+    std::vector<size_t> label(parent_.size(), size_t(-1));
+    size_t n_label = 0;
+    for (size_t i = 0; i < parent_.size(); ++i) {
+      // the root of a set is its smallest element, so it is labelled first.
+      size_t r = find(i);
+      label[i] = (r == i) ? n_label++ : label[r];
+    }
+    return label;
+  }
+
+ private:
+  std::vector<std::atomic<size_t>> parent_;
+};
@@ -0,0 +1,147 @@
+//
+// Micro-benchmark of the MixedOperator::apply overloads on the Hubbard sectors of free_fermion.cc
+//
+// usage: apply_benchmark [nx] [ny]
+//
+// Compares the vector-returning apply (one allocation per row), the caller-owned buffer,
+// and the visitor, for MixedOperator, CompiledMixedOperator and CompactOperator.
+//
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include "hilbertspace.h"
+#include "operator.h"
+
+static const size_t RepSize = 64;
+static const size_t SiteSize = 64;
+
+using SystemType = System<Charge, Spin>;
+using MixedOperatorType = MixedOperator<double, RepSize, SiteSize>;
+using CompactOperatorType = CompactOperator<double, RepSize, SiteSize>;
+using SectorType = SectorGenerator<RepSize, SiteSize, Charge, Spin>::Sector;
+
+template <typename Function>
+void benchmark(const char* name, const SectorType& sector, Function&& func)
+{
+  using namespace std;
+  size_t n_repeat = std::max<size_t>(1, 1000000 / (sector.size() + 1));
+  double checksum = 0;
+  auto start = chrono::steady_clock::now();
+  for (size_t i_repeat = 0; i_repeat < n_repeat; ++i_repeat) {
+    for (size_t i = 0; i < sector.size(); ++i) {
+      checksum += func(i);
+    }
+  }
+  auto stop = chrono::steady_clock::now();
+  double seconds = chrono::duration<double>(stop - start).count();
+  double rate = static_cast<double>(n_repeat * sector.size()) / seconds;
+  cout << "  " << setw(16) << left << name << right
+       << setw(14) << scientific << setprecision(3) << rate << " rows/s"
+       << "  (checksum " << fixed << setprecision(1) << checksum << ")" << endl;
+}
+
+int main(int argc, char** argv)
+{
+  using namespace std;
+  size_t nx = (argc > 1) ? static_cast<size_t>(atoi(argv[1])) : 3;
+  size_t ny = (argc > 2) ? static_cast<size_t>(atoi(argv[2])) : 3;
+
+  SystemType system;
+  {
+    State<Charge, Spin> f0("FEm", false, Charge(0), Spin(0));
+    State<Charge, Spin> fu("FUp", true, Charge(1), Spin(1));
+    State<Charge, Spin> fd("FDn", true, Charge(1), Spin(-1));
+    Site<Charge, Spin> fup_site(f0, fu);
+    Site<Charge, Spin> fdn_site(f0, fd);
+    for (size_t i = 0; i < nx * ny; ++i) {
+      system.add_site(fup_site);
+      system.add_site(fdn_site);
+    }
+    system.finalize();
+  }
+
+  MixedOperatorType hop;
+  for (size_t ix = 0; ix < nx; ++ix) {
+    for (size_t iy = 0; iy < ny; ++iy) {
+      for (size_t i_spin = 0; i_spin < 2; ++i_spin) {
+        size_t i_site = (ix * ny + iy) * 2 + i_spin;
+        size_t jx_site = (((ix + 1) % nx) * ny + iy) * 2 + i_spin;
+        size_t jy_site = (ix * ny + (iy + 1) % ny) * 2 + i_spin;
+        for (size_t j_site : {jx_site, jy_site}) {
+          hop.add(-1.0 * system.get_operator<double, RepSize, SiteSize>(i_site, 1, 0)
+                       * system.get_operator<double, RepSize, SiteSize>(j_site, 0, 1));
+          hop.add(-1.0 * system.get_operator<double, RepSize, SiteSize>(j_site, 1, 0)
+                       * system.get_operator<double, RepSize, SiteSize>(i_site, 0, 1));
+        }
+      }
+    }
+  }
+  CompiledMixedOperator<double, RepSize, SiteSize> compiled_hop(hop);
+  CompactOperatorType compact_hop(hop, CompactCodec<RepSize, SiteSize>(system));
+
+  SectorGenerator<RepSize, SiteSize, Charge, Spin> sector_gen(system);
+  int64_t n_half = static_cast<int64_t>(nx * ny);
+  int64_t spin = n_half % 2;
+  auto sector = sector_gen.generate(Charge(n_half), Spin(spin));
+  cout << "Sector Charge(" << n_half << "), Spin(" << spin << ") : " << sector.size() << " states, "
+       << hop.n_term() << " terms, " << compiled_hop.n_mask() << " masks" << endl;
+
+  std::vector<std::tuple<MixedOperatorType::Rep, MixedOperatorType::SiteRep, double>> buffer;
+  std::vector<std::tuple<CompactOperatorType::Word, double>> compact_buffer;
+
+  benchmark("mixed/vector", sector, [&](size_t i) {
+    auto s = sector.state(i);
+    double sum = 0;
+    for (auto const & r : hop.apply(std::get<0>(s), std::get<1>(s))) { sum += std::abs(std::get<2>(r)); }
+    return sum;
+  });
+  benchmark("mixed/buffer", sector, [&](size_t i) {
+    auto s = sector.state(i);
+    double sum = 0;
+    buffer.clear();
+    hop.apply(std::get<0>(s), std::get<1>(s), buffer);
+    for (auto const & r : buffer) { sum += std::abs(std::get<2>(r)); }
+    return sum;
+  });
+  benchmark("mixed/visitor", sector, [&](size_t i) {
+    auto s = sector.state(i);
+    double sum = 0;
+    hop.apply(std::get<0>(s), std::get<1>(s),
+              [&](const MixedOperatorType::Rep&, const MixedOperatorType::SiteRep&, double v) { sum += std::abs(v); });
+    return sum;
+  });
+  benchmark("compiled/buffer", sector, [&](size_t i) {
+    auto s = sector.state(i);
+    double sum = 0;
+    buffer.clear();
+    compiled_hop.apply(std::get<0>(s), std::get<1>(s), buffer);
+    for (auto const & r : buffer) { sum += std::abs(std::get<2>(r)); }
+    return sum;
+  });
+  benchmark("compiled/visitor", sector, [&](size_t i) {
+    auto s = sector.state(i);
+    double sum = 0;
+    compiled_hop.apply(std::get<0>(s), std::get<1>(s),
+                       [&](const MixedOperatorType::Rep&, const MixedOperatorType::SiteRep&, double v) { sum += std::abs(v); });
+    return sum;
+  });
+  benchmark("compact/vector", sector, [&](size_t i) {
+    double sum = 0;
+    for (auto const & r : compact_hop.apply(sector.word(i))) { sum += std::abs(std::get<1>(r)); }
+    return sum;
+  });
+  benchmark("compact/buffer", sector, [&](size_t i) {
+    double sum = 0;
+    compact_buffer.clear();
+    compact_hop.apply(sector.word(i), compact_buffer);
+    for (auto const & r : compact_buffer) { sum += std::abs(std::get<1>(r)); }
+    return sum;
+  });
+  benchmark("compact/visitor", sector, [&](size_t i) {
+    double sum = 0;
+    compact_hop.apply(sector.word(i), [&](const CompactOperatorType::Word&, double v) { sum += std::abs(v); });
+    return sum;
+  });
+  return 0;
+}
@@ -0,0 +1,109 @@
+//
+// Benchmark of the basis lookup policies on the Hubbard sectors of free_fermion.cc
+//
+// usage: basis_lookup_benchmark [nx] [ny]
+//
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include "hilbertspace.h"
+#include "operator.h"
+
+static const size_t RepSize = 32;
+static const size_t SiteSize = 32;
+
+using SystemType = System<Charge, Spin>;
+using MixedOperatorType = MixedOperator<double, RepSize, SiteSize>;
+using BitRep = std::bitset<RepSize>;
+
+template <template <size_t, size_t, typename...> class LookupPolicy>
+void benchmark(const char* name, const SystemType& system,
+               Charge charge, Spin spin, const std::vector<BitRep>& targets)
+{
+  using namespace std;
+  BasicSectorGenerator<LookupPolicy, RepSize, SiteSize, Charge, Spin> sector_gen(system);
+  auto sector = sector_gen.generate(charge, spin);
+
+  size_t n_repeat = std::max<size_t>(1, 10000000 / (targets.size() + 1));
+  size_t checksum = 0;
+  auto start = chrono::steady_clock::now();
+  for (size_t i_repeat = 0; i_repeat < n_repeat; ++i_repeat) {
+    for (auto const & t : targets) {
+      checksum += sector.find(t);
+    }
+  }
+  auto stop = chrono::steady_clock::now();
+  double seconds = chrono::duration<double>(stop - start).count();
+  double rate = static_cast<double>(n_repeat * targets.size()) / seconds;
+  double bytes = static_cast<double>(sector.index.memory_usage()) / static_cast<double>(sector.size());
+
+  cout << "  " << setw(12) << left << name << right
+       << setw(14) << scientific << setprecision(3) << rate << " lookups/s"
+       << setw(10) << fixed << setprecision(2) << bytes << " bytes/state"
+       << "  (checksum " << checksum << ")" << endl;
+}
+
+int main(int argc, char** argv)
+{
+  using namespace std;
+  size_t nx = (argc > 1) ? static_cast<size_t>(atoi(argv[1])) : 3;
+  size_t ny = (argc > 2) ? static_cast<size_t>(atoi(argv[2])) : 3;
+
+  SystemType system;
+  {
+    State<Charge, Spin> f0("FEm", false, Charge(0), Spin(0));
+    State<Charge, Spin> fu("FUp", true, Charge(1), Spin(1));
+    State<Charge, Spin> fd("FDn", true, Charge(1), Spin(-1));
+    Site<Charge, Spin> fup_site(f0, fu);
+    Site<Charge, Spin> fdn_site(f0, fd);
+    for (size_t i = 0; i < nx * ny; ++i) {
+      system.add_site(fup_site);
+      system.add_site(fdn_site);
+    }
+  }
+
+  MixedOperatorType hop;
+  for (size_t ix = 0; ix < nx; ++ix) {
+    for (size_t iy = 0; iy < ny; ++iy) {
+      for (size_t i_spin = 0; i_spin < 2; ++i_spin) {
+        size_t i_site = (ix * ny + iy) * 2 + i_spin;
+        size_t jx_site = (((ix + 1) % nx) * ny + iy) * 2 + i_spin;
+        size_t jy_site = (ix * ny + (iy + 1) % ny) * 2 + i_spin;
+        for (size_t j_site : {jx_site, jy_site}) {
+          hop.add(-1.0 * system.get_operator<double, RepSize, SiteSize>(i_site, 1, 0)
+                       * system.get_operator<double, RepSize, SiteSize>(j_site, 0, 1));
+          hop.add(-1.0 * system.get_operator<double, RepSize, SiteSize>(j_site, 1, 0)
+                       * system.get_operator<double, RepSize, SiteSize>(i_site, 0, 1));
+        }
+      }
+    }
+  }
+
+  int64_t n_half = static_cast<int64_t>(nx * ny);
+  for (int64_t charge = n_half - 2; charge <= n_half; charge += 2) {
+    for (int64_t spin = charge % 2; spin <= 2; spin += 2) {
+      SectorGenerator<RepSize, SiteSize, Charge, Spin> sector_gen(system);
+      auto sector = sector_gen.generate(Charge(charge), Spin(spin));
+      if (sector.size() == 0) { continue; }
+
+      std::vector<BitRep> targets;
+      for (size_t i = 0; i < sector.size(); ++i) {
+        auto b = sector.state(i);
+        for (auto const & r : hop.apply(std::get<0>(b), std::get<1>(b))) {
+          targets.push_back(std::get<0>(r));
+        }
+      }
+
+      cout << "Sector Charge(" << charge << "), Spin(" << spin << ") : "
+           << sector.size() << " states, " << targets.size() << " lookups" << endl;
+      benchmark<HashLookup>("hash", system, Charge(charge), Spin(spin), targets);
+      benchmark<SortedArrayLookup>("sorted", system, Charge(charge), Spin(spin), targets);
+      if (system.n_digit() <= DirectTableLookup<RepSize, SiteSize, Charge, Spin>::MaxDigit) {
+        benchmark<DirectTableLookup>("direct", system, Charge(charge), Spin(spin), targets);
+      }
+      benchmark<LinTableLookup>("lintable", system, Charge(charge), Spin(spin), targets);
+    }
+  }
+  return 0;
+}
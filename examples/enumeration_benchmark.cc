@@ -0,0 +1,60 @@
+//
+// Benchmark of the basis enumeration with and without the finalized System layout.
+//
+// usage: enumeration_benchmark [n_site ...]
+//
+// Spinless fermion chains at quarter filling (default 24, 28 and 32 sites).
+//
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include "hilbertspace.h"
+
+static const size_t RepSize = 64;
+static const size_t SiteSize = 64;
+
+using SystemType = System<Charge>;
+
+double enumerate(const SystemType& system, Charge charge, size_t& count)
+{
+  auto start = std::chrono::steady_clock::now();
+  count = 0;
+  for (auto iter = system.cbegin<RepSize, SiteSize>(charge); iter.valid(); ++iter) {
+    ++count;
+  }
+  auto stop = std::chrono::steady_clock::now();
+  return std::chrono::duration<double>(stop - start).count();
+}
+
+int main(int argc, char** argv)
+{
+  using namespace std;
+  std::vector<size_t> n_sites;
+  for (int i = 1; i < argc; ++i) { n_sites.push_back(static_cast<size_t>(atoi(argv[i]))); }
+  if (n_sites.empty()) { n_sites = {24, 28, 32}; }
+
+  State<Charge> f0("FEm", false, Charge(0));
+  State<Charge> f1("FOc", true, Charge(1));
+  Site<Charge> site(f0, f1);
+
+  for (size_t n_site : n_sites) {
+    SystemType system;
+    for (size_t i = 0; i < n_site; ++i) { system.add_site(site); }
+    SystemType frozen(system);
+    frozen.finalize();
+
+    Charge charge(static_cast<int64_t>(n_site / 4));
+    size_t count, frozen_count;
+    double t = enumerate(system, charge, count);
+    double frozen_t = enumerate(frozen, charge, frozen_count);
+    assert(count == frozen_count);
+
+    cout << setw(3) << n_site << " sites, " << charge << " : " << setw(10) << count << " states"
+         << fixed << setprecision(3)
+         << "   plain " << setw(8) << t << " s"
+         << "   finalized " << setw(8) << frozen_t << " s"
+         << "   speedup " << setw(6) << setprecision(1) << (t / frozen_t) << "x" << endl;
+  }
+  return 0;
+}
@@ -9,6 +9,8 @@
 #include <kore/array/array.h>
 #include "hilbertspace.h"
 #include "operator.h"
+#include "hamiltonian.h"
+#include "eigensolver.h"
 #include <Eigen/Eigen>
 #include <Eigen/SparseCore>
 
@@ -71,6 +73,7 @@ int main(int argc, char** argv)
         system.add_site(fdn_site);
       }
     }
+    system.finalize();
   }
 
   std::vector<PureOperatorType> ann_data, cre_data;
@@ -114,49 +117,19 @@ int main(int argc, char** argv)
     }
   }
 
-  SectorGenerator<RepSize, SiteSize, Charge, Spin> sector_gen(system);
-  auto max_qn = system.max_quantum_number();
-  auto min_qn = system.min_quantum_number();
-
-  std::ofstream outfile("basis.txt");
-  for (auto charge = std::get<0>(min_qn); charge <= std::get<0>(max_qn); ++charge) {
-    for (auto spin = std::get<1>(min_qn); spin <= std::get<1>(max_qn); ++spin) {
-      auto sector = sector_gen.generate(charge, spin);
-      size_t n_basis = sector.basis.size();
-      if (n_basis ==  0) { continue; }
-
-      cout << charge << "," << spin << endl;
-      outfile << charge << "," << spin << endl;
-      outfile << "=======================" << endl;
-      for (auto v: sector.basis) { outfile << v << endl; }
-      outfile << endl;
-
-      Eigen::SparseMatrix<double> hamiltonian_matrix(n_basis, n_basis);
-      {
-        std::vector<Eigen::Triplet<double> > coefficients;
-
-        for (size_t i_basis = 0; i_basis < n_basis; ++i_basis) {
-          auto const &bvec_fvec = sector.basis[i_basis];
-          auto row = hop.apply(std::get<0>(bvec_fvec), std::get<1>(bvec_fvec));
-          for (auto const &r : row) {
-            auto match_iter = sector.basismap.find(std::get<0>(r));
-            if (match_iter == sector.basismap.end()) {
-              cout << "ERROR!" << endl;
-            } else {
-              coefficients.emplace_back(match_iter->second, i_basis, std::get<2>(r));
-            }
-          } // for r in row (all resulting rows after applying H to col.
-        } // for i_basis
-        hamiltonian_matrix.setFromTriplets(coefficients.begin(), coefficients.end());
-      }
+  size_t n_eliminated = hop.simplify();
+  cout << "Hamiltonian: " << hop.n_term() << " terms (" << n_eliminated << " merged or zero)" << endl;
 
-      cout << endl;
-      cout << hamiltonian_matrix;
-      cout << endl;
-      cout << endl;
-    }
+  // lowest energy of the sectors of smallest |Sz| up to quarter filling; the sectors are
+  // diagonalized in parallel. (The half-filled sector alone has 165,636,900 states.)
+  std::vector<std::tuple<Charge, Spin>> targets;
+  for (int64_t charge = 0; charge <= static_cast<int64_t>(nx * ny / 2); ++charge) {
+    targets.push_back(std::make_tuple(Charge(charge), Spin(charge % 2)));
+  }
+  SectorDriver<double, RepSize, SiteSize, Charge, Spin> driver(system, hop);
+  for (auto const & row : driver.run(targets)) {
+    cout << row << endl;
   }
-  outfile.close();
   return 0;
 
 #if 0
@@ -0,0 +1,326 @@
+#define CATCH_CONFIG_MAIN
+
+#include "catch.hpp"
+
+#include "hilbertspace.h"
+#include "operator.h"
+#include "hamiltonian.h"
+#include "eigensolver.h"
+#include "models.h"
+
+namespace {
+
+static const size_t RepSize = 16;
+static const size_t SiteSize = 16;
+using MixedOperatorType = MixedOperator<double, RepSize, SiteSize>;
+using HubbardChain = HubbardModel<RepSize, SiteSize>;
+
+//! Eigenvalues of the dense matrix.
+template <typename SparseType>
+Eigen::VectorXd dense_eigenvalues(const SparseType& sparse)
+{
+  Eigen::MatrixXd dense = Eigen::MatrixXd(sparse.matrix());
+  Eigen::SelfAdjointEigenSolver<Eigen::MatrixXd> solver(dense, Eigen::EigenvaluesOnly);
+  return solver.eigenvalues();
+}
+
+} // namespace
+
+TEST_CASE("Lanczos ground state", "[lanczos]") {
+  HubbardChain model(6);
+  SectorGenerator<RepSize, SiteSize, Charge, Spin> sector_gen(model.system);
+  auto sector = sector_gen.generate(Charge(6), Spin(0));
+  auto sparse = HamiltonianBuilder<double, RepSize, SiteSize>(model.hamiltonian).build(sector);
+  auto matrix_free = make_matrix_free_hamiltonian(model.hamiltonian, sector);
+  double expected = dense_eigenvalues(sparse)(0);
+
+  for (auto reorth : {Reorthogonalization::None, Reorthogonalization::Partial, Reorthogonalization::Full}) {
+    for (bool low_memory : {false, true}) {
+      Lanczos<double> lanczos;
+      lanczos.set_reorthogonalization(reorth).set_low_memory(low_memory).set_tolerance(1E-12);
+
+      lanczos.compute(sparse);
+      REQUIRE(lanczos.converged());
+      REQUIRE(lanczos.eigenvalue() == Approx(expected).epsilon(1E-10));
+      REQUIRE(lanczos.residual() < 1E-6);
+      REQUIRE(lanczos.eigenvector().norm() == Approx(1.0));
+      REQUIRE(lanczos.residuals().size() == lanczos.n_iteration());
+      REQUIRE(lanczos.residuals().back() < 1E-12 * std::abs(expected));
+
+      double eigenvalue = lanczos.eigenvalue();
+      lanczos.compute(matrix_free);
+      REQUIRE(lanczos.eigenvalue() == Approx(eigenvalue).epsilon(1E-12));
+    }
+  }
+
+  SECTION("two-pass mode reproduces the eigenvector") {
+    Lanczos<double> full, low_memory;
+    full.set_reorthogonalization(Reorthogonalization::None).compute(sparse);
+    low_memory.set_low_memory(true).compute(sparse);
+    REQUIRE(low_memory.n_iteration() == full.n_iteration());
+    REQUIRE(low_memory.n_apply() == 2 * full.n_iteration());
+    REQUIRE((low_memory.eigenvector() - full.eigenvector()).norm() < 1E-8);
+  }
+
+  SECTION("a solver is reused with other settings") {
+    Lanczos<double> lanczos;
+    lanczos.set_tolerance(1E-12).compute(sparse);
+    REQUIRE(lanczos.n_iteration() > 3);
+    double eigenvalue = lanczos.eigenvalue();
+
+    lanczos.set_max_iteration(3).set_low_memory(true).compute(sparse);
+    REQUIRE(!lanczos.converged());
+    REQUIRE(lanczos.n_iteration() == 3);
+    REQUIRE(lanczos.residuals().size() == 3);
+    REQUIRE(lanczos.n_apply() == 6);
+    REQUIRE(lanczos.eigenvector().allFinite());
+    REQUIRE(lanczos.eigenvector().norm() == Approx(1.0));
+
+    REQUIRE_THROWS_AS(lanczos.set_max_iteration(0), const std::domain_error&);
+    lanczos.set_max_iteration(300).set_low_memory(false).compute(sparse);
+    REQUIRE(lanczos.converged());
+    REQUIRE(lanczos.eigenvalue() == Approx(eigenvalue).epsilon(1E-12));
+  }
+
+  SECTION("small sector is exhausted") {
+    auto small = sector_gen.generate(Charge(1), Spin(1));
+    auto small_sparse = HamiltonianBuilder<double, RepSize, SiteSize>(model.hamiltonian).build(small);
+    Lanczos<double> lanczos;
+    lanczos.compute(small_sparse);
+    REQUIRE(lanczos.n_iteration() <= small.size());
+    REQUIRE(lanczos.eigenvalue() == Approx(dense_eigenvalues(small_sparse)(0)));
+  }
+
+  SECTION("empty operator") {
+    auto empty = sector_gen.generate(Charge(13), Spin(1));
+    auto empty_sparse = HamiltonianBuilder<double, RepSize, SiteSize>(model.hamiltonian).build(empty);
+    Lanczos<double> lanczos;
+    REQUIRE_THROWS_AS(lanczos.compute(empty_sparse), const std::domain_error&);
+  }
+}
+
+TEST_CASE("Block products", "[lobpcg]") {
+  HubbardChain model(4);
+  SectorGenerator<RepSize, SiteSize, Charge, Spin> sector_gen(model.system);
+  auto sector = sector_gen.generate(Charge(4), Spin(0));
+  auto sparse = HamiltonianBuilder<double, RepSize, SiteSize>(model.hamiltonian).build(sector);
+  auto matrix_free = make_matrix_free_hamiltonian(model.hamiltonian, sector, 2);
+
+  const size_t n_vector = 3;
+  Lobpcg<double>::BlockType x(sector.size(), n_vector), y(sector.size(), n_vector), z(sector.size(), n_vector);
+  for (size_t i = 0; i < sector.size(); ++i) {
+    for (size_t v = 0; v < n_vector; ++v) { x(i, v) = std::sin(0.3 * static_cast<double>(i) + static_cast<double>(v)); }
+  }
+  Eigen::MatrixXd expected = sparse.matrix() * Eigen::MatrixXd(x);
+  sparse.apply(x.data(), y.data(), n_vector);
+  matrix_free.apply(x.data(), z.data(), n_vector);
+  REQUIRE((Eigen::MatrixXd(y) - expected).norm() < 1E-12);
+  REQUIRE((Eigen::MatrixXd(z) - expected).norm() < 1E-12);
+}
+
+TEST_CASE("LOBPCG low-lying states", "[lobpcg]") {
+  HubbardChain model(6);
+  SectorGenerator<RepSize, SiteSize, Charge, Spin> sector_gen(model.system);
+  auto sector = sector_gen.generate(Charge(6), Spin(0));
+  auto sparse = HamiltonianBuilder<double, RepSize, SiteSize>(model.hamiltonian).build(sector);
+  auto matrix_free = make_matrix_free_hamiltonian(model.hamiltonian, sector);
+  Eigen::VectorXd expected = dense_eigenvalues(sparse);
+
+  for (size_t n_eigenvalue : {1, 5, 12}) {
+    Lobpcg<double> lobpcg;
+    lobpcg.set_n_eigenvalue(n_eigenvalue).set_tolerance(1E-9);
+    lobpcg.compute(sparse);
+    REQUIRE(lobpcg.converged());
+    REQUIRE(static_cast<size_t>(lobpcg.eigenvalues().size()) == n_eigenvalue);
+    for (size_t i = 0; i < n_eigenvalue; ++i) {
+      REQUIRE(lobpcg.eigenvalues()(i) == Approx(expected(i)).epsilon(1E-10));
+      REQUIRE(lobpcg.residuals()(i) < 1E-7);
+    }
+    Eigen::MatrixXd overlap = lobpcg.eigenvectors().adjoint() * lobpcg.eigenvectors();
+    REQUIRE((overlap - Eigen::MatrixXd::Identity(n_eigenvalue, n_eigenvalue)).norm() < 1E-10);
+
+    Eigen::VectorXd values = lobpcg.eigenvalues();
+    lobpcg.compute(matrix_free);
+    REQUIRE((lobpcg.eigenvalues() - values).norm() < 1E-9);
+  }
+
+  SECTION("small sector is diagonalized densely") {
+    auto small = sector_gen.generate(Charge(1), Spin(1));
+    auto small_sparse = HamiltonianBuilder<double, RepSize, SiteSize>(model.hamiltonian).build(small);
+    Lobpcg<double> lobpcg;
+    lobpcg.set_n_eigenvalue(3).compute(small_sparse);
+    REQUIRE(lobpcg.n_apply() == small.size());
+    REQUIRE((lobpcg.eigenvalues() - dense_eigenvalues(small_sparse).head(3)).norm() < 1E-12);
+    lobpcg.set_n_eigenvalue(small.size() + 1);
+    REQUIRE_THROWS_AS(lobpcg.compute(small_sparse), const std::domain_error&);
+  }
+}
+
+TEST_CASE("Davidson roots", "[davidson]") {
+  HubbardChain model(6, 20.0);
+  SectorGenerator<RepSize, SiteSize, Charge, Spin> sector_gen(model.system);
+  auto sector = sector_gen.generate(Charge(6), Spin(0));
+  auto sparse = HamiltonianBuilder<double, RepSize, SiteSize>(model.hamiltonian).build(sector);
+  auto matrix_free = make_matrix_free_hamiltonian(model.hamiltonian, sector);
+  Eigen::VectorXd expected = dense_eigenvalues(sparse);
+  REQUIRE(sparse.diagonal().size() == sector.size());
+
+  for (auto correction : {DavidsonCorrection::Diagonal, DavidsonCorrection::Olsen}) {
+    for (size_t n_root : {1, 4}) {
+      Davidson<double> davidson;
+      davidson.set_n_root(n_root).set_correction(correction).set_tolerance(1E-9);
+      davidson.compute(sparse);
+      REQUIRE(davidson.converged());
+      REQUIRE(static_cast<size_t>(davidson.eigenvalues().size()) == n_root);
+      for (size_t i = 0; i < n_root; ++i) {
+        REQUIRE(davidson.eigenvalues()(i) == Approx(expected(i)).epsilon(1E-10));
+        REQUIRE(davidson.residuals()(i) < 1E-8 * std::max(1.0, std::abs(expected(i))));
+      }
+      Eigen::MatrixXd residual = sparse.matrix() * davidson.eigenvectors()
+                                 - davidson.eigenvectors() * davidson.eigenvalues().asDiagonal();
+      REQUIRE(residual.norm() < 1E-7);
+
+      Eigen::VectorXd values = davidson.eigenvalues();
+      davidson.compute(matrix_free);
+      REQUIRE((davidson.eigenvalues() - values).norm() < 1E-9);
+    }
+  }
+
+  SECTION("restarts") {
+    Davidson<double> davidson;
+    davidson.set_n_root(3).set_max_subspace(8).set_restart_size(4).compute(sparse);
+    REQUIRE(davidson.converged());
+    REQUIRE(davidson.n_restart() > 0);
+    REQUIRE((davidson.eigenvalues() - expected.head(3)).norm() < 1E-9);
+  }
+
+  SECTION("fewer products than Lanczos for a diagonally dominant operator") {
+    Davidson<double> davidson;
+    davidson.set_tolerance(1E-8).compute(sparse);
+    Lanczos<double> lanczos;
+    lanczos.set_tolerance(1E-8).compute(sparse);
+    REQUIRE(davidson.eigenvalues()(0) == Approx(lanczos.eigenvalue()));
+    REQUIRE(davidson.n_apply() < lanczos.n_apply());
+  }
+
+  SECTION("diagonal of wrong size") {
+    Davidson<double> davidson;
+    std::vector<double> diagonal(3, 0.0);
+    REQUIRE_THROWS_AS(davidson.compute(sparse, diagonal), const std::length_error&);
+  }
+}
+
+TEST_CASE("Thread pool", "[driver]") {
+  ThreadPool pool(3);
+  REQUIRE(pool.n_thread() == 3);
+  std::vector<int> done(100, 0);
+  for (size_t i = 0; i < done.size(); ++i) {
+    pool.submit([&done, i]() { done[i] += static_cast<int>(i); });
+  }
+  pool.wait();
+  for (size_t i = 0; i < done.size(); ++i) { REQUIRE(done[i] == static_cast<int>(i)); }
+
+  pool.submit([]() { throw std::domain_error("task"); });
+  pool.submit([]() { });
+  REQUIRE_THROWS_AS(pool.wait(), const std::domain_error&);
+  pool.wait();
+}
+
+TEST_CASE("Sector-parallel driver", "[driver]") {
+  HubbardChain model(4);
+  SectorDriver<double, RepSize, SiteSize, Charge, Spin> driver(model.system, model.hamiltonian);
+  driver.set_dense_limit(20).set_n_thread(1);
+  auto serial = driver.run();
+  REQUIRE(serial.size() == model.system.sector_dimensions().size());
+  REQUIRE(std::is_sorted(serial.begin(), serial.end(),
+                         [](const decltype(serial[0])& a, const decltype(serial[0])& b) {
+                           return a.quantum_number < b.quantum_number;
+                         }));
+
+  SectorGenerator<RepSize, SiteSize, Charge, Spin> sector_gen(model.system);
+  HamiltonianBuilder<double, RepSize, SiteSize> builder(model.hamiltonian);
+  bool has_dense = false, has_lanczos = false;
+  for (auto const & row : serial) {
+    auto sector = sector_gen.generate(std::get<0>(row.quantum_number), std::get<1>(row.quantum_number));
+    REQUIRE(row.dimension == sector.size());
+    REQUIRE(row.eigenvalues.size() == 1);
+    REQUIRE(row.converged);
+    REQUIRE(row.eigenvalues[0] == Approx(dense_eigenvalues(builder.build(sector))(0)).epsilon(1E-10));
+    has_dense = has_dense || row.method == SectorMethod::Dense;
+    has_lanczos = has_lanczos || row.method == SectorMethod::Lanczos;
+  }
+  REQUIRE(has_dense);
+  REQUIRE(has_lanczos);
+
+  SECTION("the table does not depend on the number of threads") {
+    driver.set_n_thread(3);
+    auto parallel = driver.run();
+    REQUIRE(parallel.size() == serial.size());
+    for (size_t i = 0; i < serial.size(); ++i) {
+      REQUIRE(parallel[i].quantum_number == serial[i].quantum_number);
+      REQUIRE(parallel[i].method == serial[i].method);
+      REQUIRE(parallel[i].eigenvalues[0] == Approx(serial[i].eigenvalues[0]).epsilon(1E-12));
+    }
+  }
+
+  SECTION("fragments") {
+    driver.set_split_fragments(true).set_n_eigenvalue(2);
+    auto split = driver.run();
+    REQUIRE(split.size() == serial.size());
+    for (size_t i = 0; i < serial.size(); ++i) {
+      REQUIRE(split[i].dimension == serial[i].dimension);
+      REQUIRE(split[i].eigenvalues.size() == std::min<size_t>(2, split[i].dimension));
+      REQUIRE(split[i].eigenvalues[0] == Approx(serial[i].eigenvalues[0]).epsilon(1E-9));
+    }
+  }
+
+  SECTION("sectors above the sparse limit") {
+    // the Hubbard hopping never mixes the spins: Kronecker.
+    driver.set_sparse_limit(30);
+    REQUIRE(driver.storage(30) == SectorStorage::Sparse);
+    REQUIRE(driver.storage(31) == SectorStorage::Kronecker);
+    auto large = driver.run();
+    bool has_kronecker = false;
+    for (size_t i = 0; i < serial.size(); ++i) {
+      REQUIRE(serial[i].storage == SectorStorage::Sparse);
+      REQUIRE(large[i].storage == driver.storage(large[i].dimension));
+      REQUIRE(large[i].converged);
+      REQUIRE(large[i].eigenvalues[0] == Approx(serial[i].eigenvalues[0]).epsilon(1E-9));
+      has_kronecker = has_kronecker || large[i].storage == SectorStorage::Kronecker;
+    }
+    REQUIRE(has_kronecker);
+
+    // pair hopping between the cells 0 and 1 joins the spins: matrix-free.
+    MixedOperatorType pair_hopping = model.hamiltonian;
+    auto c = [&](size_t i) { return model.system.get_operator<double, RepSize, SiteSize>(i, 0, 1); };
+    auto cdag = [&](size_t i) { return model.system.get_operator<double, RepSize, SiteSize>(i, 1, 0); };
+    pair_hopping.add(0.3 * cdag(0) * cdag(1) * c(3) * c(2));
+    pair_hopping.add(0.3 * cdag(2) * cdag(3) * c(1) * c(0));
+    SectorDriver<double, RepSize, SiteSize, Charge, Spin> pair_driver(model.system, pair_hopping);
+    pair_driver.set_dense_limit(20).set_n_thread(2);
+    auto sparse = pair_driver.run();
+    pair_driver.set_sparse_limit(30);
+    REQUIRE(pair_driver.storage(31) == SectorStorage::MatrixFree);
+    auto matrix_free = pair_driver.run();
+    for (size_t i = 0; i < sparse.size(); ++i) {
+      REQUIRE(matrix_free[i].storage == pair_driver.storage(matrix_free[i].dimension));
+      REQUIRE(matrix_free[i].eigenvalues[0] == Approx(sparse[i].eigenvalues[0]).epsilon(1E-9));
+    }
+  }
+
+  SECTION("several eigenvalues, and selected sectors") {
+    driver.set_n_eigenvalue(3).set_n_thread(2);
+    auto table = driver.run({std::make_tuple(Charge(4), Spin(0)), std::make_tuple(Charge(1), Spin(1)),
+                             std::make_tuple(Charge(4), Spin(0)), std::make_tuple(Charge(3), Spin(2))});
+    REQUIRE(table.size() == 3);
+    REQUIRE(table[0].quantum_number == std::make_tuple(Charge(1), Spin(1)));
+    REQUIRE(table[0].method == SectorMethod::Dense);
+    REQUIRE(table[1].dimension == 0);
+    REQUIRE(table[1].eigenvalues.empty());
+    REQUIRE(table[2].method == SectorMethod::Lobpcg);
+    auto expected = dense_eigenvalues(builder.build(sector_gen.generate(Charge(4), Spin(0))));
+    for (size_t i = 0; i < 3; ++i) {
+      REQUIRE(table[2].eigenvalues[i] == Approx(expected(i)).epsilon(1E-9));
+    }
+  }
+}
@@ -0,0 +1,277 @@
+#define CATCH_CONFIG_MAIN
+
+#include "catch.hpp"
+
+#include <Eigen/Dense>
+
+#include "hilbertspace.h"
+#include "operator.h"
+#include "hamiltonian.h"
+#include "models.h"
+
+namespace {
+
+static const size_t RepSize = 16;
+static const size_t SiteSize = 16;
+using MixedOperatorType = MixedOperator<double, RepSize, SiteSize>;
+using HubbardChain = HubbardModel<RepSize, SiteSize>;
+
+} // namespace
+
+TEST_CASE("Diagonal part of an operator", "[diagonal]") {
+  HubbardChain model(4);
+  auto diag = model.hamiltonian.diagonal();
+  auto off_diag = model.hamiltonian.off_diagonal();
+  REQUIRE(diag.n_term() == 12);
+  REQUIRE(off_diag.n_term() == 16);
+
+  SectorGenerator<RepSize, SiteSize, Charge, Spin> sector_gen(model.system);
+  auto sector = sector_gen.generate(Charge(4), Spin(0));
+  SectorDiagonal<double> diagonal(model.hamiltonian, sector, 3);
+  REQUIRE(diagonal.size() == sector.size());
+
+  std::vector<double> x(sector.size()), y(sector.size(), 1.0);
+  for (size_t i = 0; i < sector.size(); ++i) {
+    auto s = sector.state(i);
+    double expected = 0;
+    for (auto const & r : model.hamiltonian.apply(std::get<0>(s), std::get<1>(s))) {
+      if (std::get<0>(r) == std::get<0>(s)) { expected += std::get<2>(r); }
+    }
+    REQUIRE(diagonal[i] == Approx(expected));
+    for (auto const & r : off_diag.apply(std::get<0>(s), std::get<1>(s))) {
+      REQUIRE(std::get<0>(r) != std::get<0>(s));
+    }
+    x[i] = 0.5 + static_cast<double>(i % 7);
+  }
+
+  diagonal.apply(x.data(), y.data());
+  for (size_t i = 0; i < sector.size(); ++i) {
+    REQUIRE(y[i] == Approx(1.0 + diagonal[i] * x[i]));
+  }
+}
+
+TEST_CASE("Sparse Hamiltonian assembly", "[builder]") {
+  HubbardChain model(4);
+  model.hamiltonian.add(-1.0 * model.hamiltonian.term(0));   // cancels the first hopping term
+  model.hamiltonian.add(0.5 * model.hamiltonian.term(1));    // duplicate of the second one
+
+  SectorGenerator<RepSize, SiteSize, Charge, Spin> sector_gen(model.system);
+  HamiltonianBuilder<double, RepSize, SiteSize> builder(model.hamiltonian);
+
+  for (int64_t charge = 0; charge <= 8; ++charge) {
+    for (int64_t spin = -charge; spin <= charge; spin += 2) {
+      auto sector = sector_gen.generate(Charge(charge), Spin(spin));
+      if (sector.size() == 0) { continue; }
+
+      std::vector<Eigen::Triplet<double>> triplets;
+      for (size_t j = 0; j < sector.size(); ++j) {
+        auto s = sector.state(j);
+        for (auto const & r : model.hamiltonian.apply(std::get<0>(s), std::get<1>(s))) {
+          triplets.emplace_back(static_cast<int>(sector.find(std::get<0>(r))), static_cast<int>(j), std::get<2>(r));
+        }
+      }
+      Eigen::SparseMatrix<double> expected(sector.size(), sector.size());
+      expected.setFromTriplets(triplets.begin(), triplets.end());
+
+      for (size_t n_thread : {1, 3}) {
+        auto hamiltonian = builder.build(sector, n_thread);
+        REQUIRE(hamiltonian.size() == sector.size());
+        auto const & outer = hamiltonian.outer_index();
+        auto const & inner = hamiltonian.inner_index();
+        for (size_t j = 0; j < sector.size(); ++j) {
+          REQUIRE(std::is_sorted(inner.begin() + outer[j], inner.begin() + outer[j + 1]));
+          REQUIRE(std::adjacent_find(inner.begin() + outer[j], inner.begin() + outer[j + 1]) == inner.begin() + outer[j + 1]);
+        }
+        Eigen::SparseMatrix<double> difference = hamiltonian.matrix() - expected;
+        REQUIRE(difference.norm() < 1E-12);
+        REQUIRE(hamiltonian.matrix().nonZeros() == static_cast<Eigen::Index>(hamiltonian.nnz()));
+      }
+    }
+  }
+
+  SECTION("operator which changes the sector") {
+    MixedOperatorType creation;
+    creation.add(model.system.get_operator<double, RepSize, SiteSize>(0, 1, 0));
+    HamiltonianBuilder<double, RepSize, SiteSize> creation_builder(creation);
+    auto sector = sector_gen.generate(Charge(2), Spin(0));
+    REQUIRE_THROWS_AS(creation_builder.build(sector), const std::domain_error&);
+  }
+}
+
+TEST_CASE("Matrix-free Hamiltonian", "[matrix_free]") {
+  HubbardChain model(4);
+  SectorGenerator<RepSize, SiteSize, Charge, Spin> sector_gen(model.system);
+  auto sector = sector_gen.generate(Charge(4), Spin(0));
+  auto sparse = HamiltonianBuilder<double, RepSize, SiteSize>(model.hamiltonian).build(sector);
+
+  Eigen::VectorXd x(sector.size());
+  for (size_t i = 0; i < sector.size(); ++i) { x(i) = std::sin(0.3 * static_cast<double>(i)); }
+  Eigen::VectorXd expected = sparse.matrix() * x;
+
+  for (size_t n_thread : {1, 3}) {
+    auto hamiltonian = make_matrix_free_hamiltonian(model.hamiltonian, sector, n_thread);
+    REQUIRE(hamiltonian.size() == sector.size());
+    Eigen::VectorXd y(sector.size());
+    hamiltonian.apply(x.data(), y.data());
+    REQUIRE((y - expected).norm() < 1E-12);
+
+    Eigen::VectorXd z = hamiltonian * x;
+    REQUIRE((z - expected).norm() < 1E-12);
+  }
+
+  SECTION("Eigen iterative solver") {
+    // (H + 10) is positive definite.
+    MixedOperatorType shifted(model.hamiltonian);
+    shifted.add(PureOperator<double, RepSize, SiteSize>(0, 0, 0, 0, 0, 0, 0, 10.0));
+    auto hamiltonian = make_matrix_free_hamiltonian(shifted, sector);
+    Eigen::ConjugateGradient<decltype(hamiltonian), Eigen::Lower | Eigen::Upper,
+                             Eigen::IdentityPreconditioner> solver;
+    solver.setTolerance(1E-12);
+    solver.compute(hamiltonian);
+    Eigen::VectorXd solution = solver.solve(x);
+    REQUIRE(solver.info() == Eigen::Success);
+    Eigen::VectorXd residual = sparse.matrix() * solution + 10.0 * solution - x;
+    REQUIRE(residual.norm() < 1E-9 * x.norm());
+  }
+}
+
+TEST_CASE("Kronecker Hamiltonian of separable species", "[kronecker]") {
+  using KroneckerType = KroneckerHamiltonian<double, RepSize, SiteSize, Charge, Spin>;
+  HubbardChain model(4);
+  SectorGenerator<RepSize, SiteSize, Charge, Spin> sector_gen(model.system);
+  auto sector = sector_gen.generate(Charge(4), Spin(0));
+  auto sparse = HamiltonianBuilder<double, RepSize, SiteSize>(model.hamiltonian).build(sector);
+
+  // the hopping never mixes the spins: up on the even sites, down on the odd ones.
+  auto species = KroneckerType::separate_species(model.system, model.hamiltonian);
+  for (size_t i_site = 0; i_site < model.system.n_site(); ++i_site) {
+    REQUIRE(species.test(i_site) == (i_site % 2 == 0));
+  }
+
+  Eigen::VectorXd x(sector.size());
+  for (size_t i = 0; i < sector.size(); ++i) { x(i) = std::sin(0.3 * static_cast<double>(i)); }
+  Eigen::VectorXd expected = sparse.matrix() * x;
+
+  for (size_t n_thread : {1, 3}) {
+    KroneckerType hamiltonian(model.system, model.hamiltonian, std::make_tuple(Charge(4), Spin(0)), n_thread);
+    REQUIRE(hamiltonian.size() == sector.size());
+    REQUIRE(hamiltonian.n_block() == 1);
+
+    Eigen::VectorXd xk(sector.size()), yk(sector.size()), y(sector.size());
+    hamiltonian.from_sector(sector, x.data(), xk.data());
+    hamiltonian.apply(xk.data(), yk.data());
+    hamiltonian.to_sector(sector, yk.data(), y.data());
+    REQUIRE((y - expected).norm() < 1E-12);
+
+    for (size_t i = 0; i < hamiltonian.size(); ++i) {
+      size_t j = sector.find_word(hamiltonian.word(i));
+      REQUIRE(hamiltonian.diagonal()[i] == Approx(sparse.matrix().coeff(j, j)));
+    }
+
+    Eigen::Matrix<double, Eigen::Dynamic, 2, Eigen::RowMajor> xb(sector.size(), 2), yb(sector.size(), 2);
+    xb.col(0) = xk;
+    xb.col(1) = 2.0 * xk;
+    hamiltonian.apply(xb.data(), yb.data(), 2);
+    REQUIRE((yb.col(0) - yk).norm() < 1E-12);
+    REQUIRE((yb.col(1) - 2.0 * yk).norm() < 1E-12);
+  }
+
+  SECTION("several blocks") {
+    auto charge_sector = sector_gen.generate(Charge(3), Spin(1));
+    auto charge_sparse = HamiltonianBuilder<double, RepSize, SiteSize>(model.hamiltonian).build(charge_sector);
+    KroneckerType hamiltonian(model.system, model.hamiltonian, std::make_tuple(Charge(3), Spin(1)));
+    REQUIRE(hamiltonian.size() == charge_sector.size());
+    REQUIRE(hamiltonian.memory_usage() > 0);
+
+    Eigen::VectorXd xs = Eigen::VectorXd::LinSpaced(charge_sector.size(), -1.0, 1.0);
+    Eigen::VectorXd xk(xs.size()), yk(xs.size()), y(xs.size());
+    hamiltonian.from_sector(charge_sector, xs.data(), xk.data());
+    hamiltonian.apply(xk.data(), yk.data());
+    hamiltonian.to_sector(charge_sector, yk.data(), y.data());
+    REQUIRE((y - charge_sparse.matrix() * xs).norm() < 1E-12);
+  }
+
+  SECTION("spin flip mixes the species") {
+    MixedOperatorType flipped(model.hamiltonian);
+    auto c = [&](size_t i) { return model.system.get_operator<double, RepSize, SiteSize>(i, 0, 1); };
+    auto cdag = [&](size_t i) { return model.system.get_operator<double, RepSize, SiteSize>(i, 1, 0); };
+    flipped.add(0.5 * cdag(0) * c(1));
+    flipped.add(0.5 * cdag(1) * c(0));
+    REQUIRE(KroneckerType::separate_species(model.system, flipped).none());
+    REQUIRE_THROWS_AS(KroneckerType(model.system, flipped, std::make_tuple(Charge(4), Spin(0))),
+                      const std::domain_error&);
+  }
+}
+
+TEST_CASE("Fragmentation of a sector", "[fragmentation]") {
+  using FragmentationType = SectorFragmentation<double, RepSize, SiteSize>;
+  // spinless fermions with dipole-conserving pair hopping on an open chain, which is strongly fragmented.
+  System<Charge> system;
+  State<Charge> e("E", false, Charge(0));
+  State<Charge> f("F", true, Charge(1));
+  Site<Charge> site(e, f);
+  size_t n_site = 10;
+  for (size_t i = 0; i < n_site; ++i) { system.add_site(site); }
+  auto c = [&](size_t i) { return system.get_operator<double, RepSize, SiteSize>(i, 0, 1); };
+  auto cdag = [&](size_t i) { return system.get_operator<double, RepSize, SiteSize>(i, 1, 0); };
+  MixedOperatorType hamiltonian;
+  for (size_t i = 0; i + 3 < n_site; ++i) {
+    hamiltonian.add(cdag(i) * c(i + 1) * c(i + 2) * cdag(i + 3));
+    hamiltonian.add(c(i) * cdag(i + 1) * cdag(i + 2) * c(i + 3));
+    hamiltonian.add((0.1 * i - 0.35) * cdag(i) * c(i));
+  }
+
+  auto sector = SectorGenerator<RepSize, SiteSize, Charge>(system).generate(Charge(5));
+  auto sparse = HamiltonianBuilder<double, RepSize, SiteSize>(hamiltonian).build(sector);
+  Eigen::MatrixXd matrix(sparse.matrix());
+  FragmentationType fragmentation(hamiltonian);
+  auto label = fragmentation.labels(sector, 1);
+  REQUIRE(label.size() == sector.size());
+  REQUIRE(label[0] == 0);
+  REQUIRE(fragmentation.labels(sector, 3) == label);
+  for (size_t i = 0; i < sector.size(); ++i) {
+    for (size_t j = 0; j < sector.size(); ++j) {
+      if (matrix(i, j) != 0.0) { REQUIRE(label[i] == label[j]); }
+    }
+  }
+
+  auto fragments = fragmentation.split(sector, 3);
+  REQUIRE(fragments.size() > 10);
+  size_t dimension = 0;
+  std::vector<double> found;
+  for (size_t i_fragment = 0; i_fragment < fragments.size(); ++i_fragment) {
+    auto const & fragment = fragments[i_fragment];
+    dimension += fragment.size();
+    for (size_t i = 0; i < fragment.size(); ++i) {
+      REQUIRE(label[fragment.parent_index[i]] == i_fragment);
+      REQUIRE(fragment.word(i) == sector.word(fragment.parent_index[i]));
+      REQUIRE(fragment.find_word(fragment.word(i)) == i);
+    }
+    auto fragment_sparse = HamiltonianBuilder<double, RepSize, SiteSize>(hamiltonian).build(fragment);
+    Eigen::MatrixXd fragment_matrix(fragment_sparse.matrix());
+    Eigen::VectorXd x = Eigen::VectorXd::LinSpaced(sector.size(), -1.0, 1.0), xf(fragment.size());
+    fragment.restrict(x.data(), xf.data());
+    Eigen::VectorXd y = Eigen::VectorXd::Zero(sector.size()), yf = fragment_matrix * xf;
+    fragment.extend(yf.data(), y.data());
+    Eigen::VectorXd x_fragment = Eigen::VectorXd::Zero(sector.size());
+    fragment.extend(xf.data(), x_fragment.data());
+    REQUIRE((matrix * x_fragment - y).norm() < 1E-12);
+
+    Eigen::SelfAdjointEigenSolver<Eigen::MatrixXd> solver(fragment_matrix, Eigen::EigenvaluesOnly);
+    found.insert(found.end(), solver.eigenvalues().data(), solver.eigenvalues().data() + fragment.size());
+  }
+  REQUIRE(dimension == sector.size());
+  std::sort(found.begin(), found.end());
+  Eigen::SelfAdjointEigenSolver<Eigen::MatrixXd> solver(matrix, Eigen::EigenvaluesOnly);
+  for (size_t i = 0; i < found.size(); ++i) {
+    REQUIRE(std::abs(found[i] - solver.eigenvalues()(i)) < 1E-10);
+  }
+
+  SECTION("a connected sector is a single fragment") {
+    HubbardChain model(4);
+    auto hubbard_sector = SectorGenerator<RepSize, SiteSize, Charge, Spin>(model.system).generate(Charge(4), Spin(0));
+    auto hubbard_fragments = FragmentationType(model.hamiltonian).split(hubbard_sector);
+    REQUIRE(hubbard_fragments.size() == 1);
+    REQUIRE(hubbard_fragments[0].size() == hubbard_sector.size());
+  }
+}
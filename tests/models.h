@@ -0,0 +1,52 @@
+#pragma once
+//! Models shared by the tests.
+
+#include "hilbertspace.h"
+#include "operator.h"
+
+//! System of n_cell Hubbard cells: an up and a down fermion site per cell, in this order.
+inline System<Charge, Spin> make_hubbard_system(size_t n_cell)
+{
+  System<Charge, Spin> system;
+  State<Charge, Spin> f0("FEm", false, Charge(0), Spin(0));
+  State<Charge, Spin> fu("FUp", true, Charge(1), Spin(1));
+  State<Charge, Spin> fd("FDn", true, Charge(1), Spin(-1));
+  Site<Charge, Spin> fup_site(f0, fu);
+  Site<Charge, Spin> fdn_site(f0, fd);
+  for (size_t i = 0; i < n_cell; ++i) {
+    system.add_site(fup_site);
+    system.add_site(fdn_site);
+  }
+  return system;
+}
+
+//! @brief Hubbard ring with hopping, interaction and (optionally) on-site energies.
+//!
+//! The on-site energies 0.1 * i_cell - 0.35 break the translation symmetry, and are never zero
+//! (a term with a zero coefficient would not conserve the sectors).
+template <size_t RepSize, size_t SiteSize>
+struct HubbardModel
+{
+  using MixedOperatorType = MixedOperator<double, RepSize, SiteSize>;
+
+  System<Charge, Spin> system;
+  MixedOperatorType hamiltonian;
+  size_t n_cell;
+
+  HubbardModel(size_t n, double interaction = 4.0, bool on_site_energy = true)
+      : system(make_hubbard_system(n)), n_cell(n)
+  {
+    auto c = [&](size_t i) { return system.template get_operator<double, RepSize, SiteSize>(i, 0, 1); };
+    auto cdag = [&](size_t i) { return system.template get_operator<double, RepSize, SiteSize>(i, 1, 0); };
+    for (size_t i_cell = 0; i_cell < n_cell; ++i_cell) {
+      size_t j_cell = (i_cell + 1) % n_cell;
+      for (size_t i_spin = 0; i_spin < 2; ++i_spin) {
+        size_t i = 2 * i_cell + i_spin, j = 2 * j_cell + i_spin;
+        hamiltonian.add(-1.0 * cdag(i) * c(j));
+        hamiltonian.add(-1.0 * cdag(j) * c(i));
+        if (on_site_energy) { hamiltonian.add((0.1 * i_cell - 0.35) * cdag(i) * c(i)); }
+      }
+      hamiltonian.add(interaction * cdag(2 * i_cell) * c(2 * i_cell) * cdag(2 * i_cell + 1) * c(2 * i_cell + 1));
+    }
+  }
+};
@@ -126,5 +126,180 @@ TEST_CASE("Spin-fermion model test", "[spin-fermion]") {
     }
   }
 
+  SECTION("apply overloads agree") {
+    using ResultType = std::tuple<std::bitset<RepSize>, std::bitset<SiteSize>, double>;
+    std::vector<ResultType> buffer;
+    size_t count = 0;
+    for (auto iter = system.cbegin<RepSize, SiteSize>(Charge(3), Spin(0)); iter.valid(); ++iter, ++count) {
+      auto bvec_fvec = iter.get();
+      auto expected = hop.apply(std::get<0>(bvec_fvec), std::get<1>(bvec_fvec));
+
+      buffer.clear();
+      hop.apply(std::get<0>(bvec_fvec), std::get<1>(bvec_fvec), buffer);
+      REQUIRE(buffer == expected);
+
+      std::vector<ResultType> visited;
+      hop.apply(std::get<0>(bvec_fvec), std::get<1>(bvec_fvec),
+                [&](const std::bitset<RepSize>& b, const std::bitset<SiteSize>& f, double v) {
+                  visited.emplace_back(b, f, v);
+                });
+      REQUIRE(visited == expected);
+    }
+    REQUIRE(count > 0);
+  }
+
+  SECTION("compiled operator finds the same terms") {
+    CompiledMixedOperator<double, RepSize, SiteSize> compiled_hop(hop);
+    REQUIRE(compiled_hop.n_term() == hop.n_term());
+    REQUIRE(compiled_hop.n_mask() == hop.n_term() / 2);
+    for (size_t charge = 0; charge <= 6; ++charge) {
+      for (auto iter = system.cbegin<RepSize, SiteSize>(Charge(charge), Spin(0)); iter.valid(); ++iter) {
+        auto bvec_fvec = iter.get();
+        auto expected = hop.apply(std::get<0>(bvec_fvec), std::get<1>(bvec_fvec));
+        auto result = compiled_hop.apply(std::get<0>(bvec_fvec), std::get<1>(bvec_fvec));
+        REQUIRE(result.size() == expected.size());
+        for (auto const & r : result) {
+          REQUIRE(std::find(expected.begin(), expected.end(), r) != expected.end());
+        }
+      }
+    }
+  }
+
+}
 
-}
\ No newline at end of file
+TEST_CASE("Compiled operator test", "[compiled]") {
+  static const size_t RepSize = 16;
+  static const size_t SiteSize = 16;
+  using MixedOperatorType = MixedOperator<double, RepSize, SiteSize>;
+
+  auto check = [](const System<Spin>& system, const MixedOperatorType& op) {
+    CompiledMixedOperator<double, RepSize, SiteSize> compiled_op(op);
+    REQUIRE(compiled_op.n_term() == op.n_term());
+    for (auto iter = system.cbegin<RepSize, SiteSize>(Spin(0)); iter.valid(); ++iter) {
+      auto bvec_fvec = iter.get();
+      auto expected = op.apply(std::get<0>(bvec_fvec), std::get<1>(bvec_fvec));
+      auto result = compiled_op.apply(std::get<0>(bvec_fvec), std::get<1>(bvec_fvec));
+      REQUIRE(result.size() == expected.size());
+      for (auto const & r : result) {
+        REQUIRE(std::find(expected.begin(), expected.end(), r) != expected.end());
+      }
+    }
+    return compiled_op.n_mask();
+  };
+
+  State<Spin> su("SpinUp", false, Spin(1));
+  State<Spin> s0("SpinZr", false, Spin(0));
+  State<Spin> sd("SpinDn", false, Spin(-1));
+
+  SECTION("spin-half Heisenberg (few cols per mask)") {
+    System<Spin> system;
+    Site<Spin> site(su, sd);
+    for (size_t i = 0; i < 6; ++i) { system.add_site(site); }
+    MixedOperatorType op;
+    for (size_t i = 0; i < 6; ++i) {
+      size_t j = (i + 1) % 6;
+      for (size_t a = 0; a < 2; ++a) {
+        for (size_t b = 0; b < 2; ++b) {
+          double sz = (a == b) ? 0.25 : -0.25;
+          op.add(sz * system.get_operator<double, RepSize, SiteSize>(i, a, a)
+                    * system.get_operator<double, RepSize, SiteSize>(j, b, b));
+        }
+      }
+      op.add(0.5 * system.get_operator<double, RepSize, SiteSize>(i, 0, 1)
+                 * system.get_operator<double, RepSize, SiteSize>(j, 1, 0));
+      op.add(0.5 * system.get_operator<double, RepSize, SiteSize>(i, 1, 0)
+                 * system.get_operator<double, RepSize, SiteSize>(j, 0, 1));
+    }
+    REQUIRE(check(system, op) == 6);
+  }
+
+  SECTION("spin-half exchange (pairs of cols)") {
+    System<Spin> system;
+    Site<Spin> site(su, sd);
+    for (size_t i = 0; i < 6; ++i) { system.add_site(site); }
+    MixedOperatorType op;
+    for (size_t i = 0; i < 6; ++i) {
+      size_t j = (i + 1) % 6;
+      op.add(0.5 * system.get_operator<double, RepSize, SiteSize>(i, 0, 1)
+                 * system.get_operator<double, RepSize, SiteSize>(j, 1, 0));
+      op.add(0.5 * system.get_operator<double, RepSize, SiteSize>(i, 1, 0)
+                 * system.get_operator<double, RepSize, SiteSize>(j, 0, 1));
+      op.add((0.1 * i + 0.1) * system.get_operator<double, RepSize, SiteSize>(i, 0, 0));
+    }
+    REQUIRE(check(system, op) == 12);
+
+    std::vector<std::bitset<RepSize>> masks, cols;
+    for (size_t i_term = 0; i_term < op.n_term(); ++i_term) {
+      masks.push_back(op.term(i_term).mask());
+      cols.push_back(op.term(i_term).col());
+    }
+    TermIndex<std::bitset<RepSize>> index(masks, cols, RepSize);
+    REQUIRE(index.n_group() == 12);
+    REQUIRE(index.n_pair() == 12);   // 6 exchange pairs, and 6 single diagonal terms
+  }
+
+  SECTION("spin-one two-site operator (all cols of a mask)") {
+    System<Spin> system;
+    Site<Spin> site(su, s0, sd);
+    for (size_t i = 0; i < 5; ++i) { system.add_site(site); }
+    MixedOperatorType op;
+    for (size_t i = 0; i < 5; ++i) {
+      size_t j = (i + 1) % 5;
+      for (size_t a = 0; a < 3; ++a) {
+        for (size_t b = 0; b < 3; ++b) {
+          for (size_t c = 0; c < 3; ++c) {
+            for (size_t d = 0; d < 3; ++d) {
+              double v = 1.0 + a + 3 * b + 9 * c + 27 * d;
+              op.add(v * system.get_operator<double, RepSize, SiteSize>(i, a, c)
+                       * system.get_operator<double, RepSize, SiteSize>(j, b, d));
+            }
+          }
+        }
+      }
+    }
+    REQUIRE(check(system, op) == 5);
+  }
+}
+
+
+TEST_CASE("Operator simplification", "[simplify]") {
+  static const size_t RepSize = 8;
+  static const size_t SiteSize = 8;
+  System<Charge> system;
+  {
+    State<Charge> f0("FEm", false, Charge(0));
+    State<Charge> f1("FOc", true, Charge(1));
+    Site<Charge> site(f0, f1);
+    for (size_t i = 0; i < 4; ++i) { system.add_site(site); }
+  }
+  auto c = [&](size_t i) { return system.get_operator<double, RepSize, SiteSize>(i, 0, 1); };
+  auto cdag = [&](size_t i) { return system.get_operator<double, RepSize, SiteSize>(i, 1, 0); };
+
+  MixedOperator<double, RepSize, SiteSize> op;
+  op.add(-1.0 * cdag(0) * c(1));
+  op.add(-1.0 * cdag(1) * c(0));
+  op.add(-1.0 * cdag(0) * c(1));    // duplicate
+  op.add(1.5 * cdag(2) * c(2));
+  op.add(-1.5 * cdag(2) * c(2));    // cancels the previous one
+  op.add(cdag(3) * cdag(3));        // vanishing product
+  op.add(0.5 * cdag(1) * c(0));     // duplicate
+
+  MixedOperator<double, RepSize, SiteSize> original(op);
+  REQUIRE(op.simplify() == 5);
+  REQUIRE(op.n_term() == 2);
+  REQUIRE(op.term(0).coefficient() == -2.0);
+  REQUIRE(op.term(1).coefficient() == -0.5);
+  REQUIRE(op.simplify() == 0);
+
+  for (auto iter = system.cbegin<RepSize, SiteSize>(Charge(1)); iter.valid(); ++iter) {
+    auto bvec_fvec = iter.get();
+    std::map<unsigned long, double> expected, result;
+    for (auto const & r : original.apply(std::get<0>(bvec_fvec), std::get<1>(bvec_fvec))) {
+      expected[std::get<0>(r).to_ulong()] += std::get<2>(r);
+    }
+    for (auto const & r : op.apply(std::get<0>(bvec_fvec), std::get<1>(bvec_fvec))) {
+      result[std::get<0>(r).to_ulong()] += std::get<2>(r);
+    }
+    for (auto const & e : expected) { REQUIRE(result[e.first] == e.second); }
+  }
+}
@@ -0,0 +1,426 @@
+#define CATCH_CONFIG_MAIN
+
+#include "catch.hpp"
+
+#include <iostream>
+
+#include "operator.h"
+#include "hilbertspace.h"
+#include "models.h"
+
+namespace {
+
+System<Charge, Spin> make_spin_fermion_system()
+{
+  System<Charge, Spin> system;
+  State<Charge, Spin> f0("FEm", false, Charge(0), Spin(0));
+  State<Charge, Spin> fu("FUp", true, Charge(1), Spin(1));
+  State<Charge, Spin> fd("FDn", true, Charge(1), Spin(-1));
+  State<Charge, Spin> su("SUp", false, Charge(0), Spin(1));
+  State<Charge, Spin> s0("SZr", false, Charge(0), Spin(0));
+  State<Charge, Spin> sd("SDn", false, Charge(0), Spin(-1));
+  Site<Charge, Spin> spin_site(su, s0, sd);
+  Site<Charge, Spin> fup_site(f0, fu);
+  Site<Charge, Spin> fdn_site(f0, fd);
+  for (size_t i = 0; i < 3; ++i) {
+    system.add_site(spin_site);
+    system.add_site(fup_site);
+    system.add_site(fdn_site);
+  }
+  return system;
+}
+
+} // namespace
+
+TEST_CASE("Lin table ranks the basis", "[lintable]") {
+  static const size_t RepSize = 16;
+  static const size_t SiteSize = 16;
+  using SectorGeneratorType = SectorGenerator<RepSize, SiteSize, Charge, Spin>;
+
+  auto system = make_spin_fermion_system();
+  SectorGeneratorType sector_gen(system);
+
+  for (int64_t charge = 0; charge <= 6; ++charge) {
+    for (int64_t spin = -6; spin <= 6; ++spin) {
+      auto sector = sector_gen.generate(Charge(charge), Spin(spin));
+      auto implicit_sector = sector_gen.generate_index(Charge(charge), Spin(spin));
+      REQUIRE(implicit_sector.basis.empty());
+      REQUIRE(implicit_sector.size() == sector.size());
+      for (size_t i = 0; i < sector.basis.size(); ++i) {
+        REQUIRE(sector.find_word(sector.basis[i]) == i);
+        REQUIRE(sector.find(std::get<0>(sector.state(i))) == i);
+        REQUIRE(implicit_sector.word(i) == sector.basis[i]);
+        REQUIRE(implicit_sector.state(i) == sector.state(i));
+      }
+    }
+  }
+
+  auto sector = sector_gen.generate(Charge(2), Spin(0));
+  REQUIRE(sector.find(std::get<0>(system.get_state_representation<RepSize, SiteSize>(1, 1))) == sector.npos);
+  REQUIRE(sector.find(std::bitset<RepSize>(3)) == sector.npos); // invalid digits of a spin site
+
+  auto hubbard_system = make_hubbard_system(5);
+  SectorGeneratorType hubbard_sector_gen(hubbard_system);
+  auto hubbard_sector = hubbard_sector_gen.generate(Charge(4), Spin(0));
+  REQUIRE(hubbard_sector.size() == 100);
+  for (size_t i = 0; i < hubbard_sector.size(); ++i) {
+    REQUIRE(hubbard_sector.find_word(hubbard_sector.word(i)) == i);
+  }
+  REQUIRE(hubbard_sector.index.uses_table());
+
+  // a small sector of a long representation: the tables would dwarf the basis.
+  auto long_system = make_hubbard_system(30);
+  using LongLinTable = LinTable<64, 64, Charge, Spin>;
+  REQUIRE(LongLinTable::max_half_digit(long_system) == 30);
+  auto small_sector = SectorGenerator<64, 64, Charge, Spin>(long_system).generate(Charge(1), Spin(1));
+  REQUIRE(small_sector.size() == 30);
+  REQUIRE(!small_sector.index.uses_table());
+  REQUIRE(small_sector.basis.empty());   // kept by the index only
+  REQUIRE(small_sector.index.memory_usage() == 30 * sizeof(uint64_t));
+  for (size_t i = 0; i < small_sector.size(); ++i) {
+    REQUIRE(small_sector.find_word(small_sector.word(i)) == i);
+    REQUIRE(small_sector.index.unrank(i) == small_sector.word(i));
+  }
+  auto parallel_small_sector = SectorGenerator<64, 64, Charge, Spin>(long_system).generate_parallel(2, Charge(1), Spin(1));
+  REQUIRE(parallel_small_sector.basis.empty());
+  REQUIRE(parallel_small_sector.word(29) == small_sector.word(29));
+  REQUIRE(small_sector.find_word(3) == small_sector.npos);
+}
+
+TEST_CASE("Lookup policies agree", "[lookup]") {
+  static const size_t RepSize = 16;
+  static const size_t SiteSize = 16;
+
+  auto system = make_spin_fermion_system();
+  BasicSectorGenerator<HashLookup, RepSize, SiteSize, Charge, Spin> hash_gen(system);
+  BasicSectorGenerator<SortedArrayLookup, RepSize, SiteSize, Charge, Spin> sorted_gen(system);
+  BasicSectorGenerator<DirectTableLookup, RepSize, SiteSize, Charge, Spin> direct_gen(system);
+  BasicSectorGenerator<LinTableLookup, RepSize, SiteSize, Charge, Spin> lin_gen(system);
+
+  auto hash_sector = hash_gen.generate(Charge(3), Spin(1));
+  auto sorted_sector = sorted_gen.generate(Charge(3), Spin(1));
+  auto direct_sector = direct_gen.generate(Charge(3), Spin(1));
+  auto lin_sector = lin_gen.generate(Charge(3), Spin(1));
+
+  REQUIRE(hash_sector.size() > 0);
+  REQUIRE(sorted_sector.size() == hash_sector.size());
+  REQUIRE(direct_sector.size() == hash_sector.size());
+  REQUIRE(lin_sector.size() == hash_sector.size());
+
+  for (uint64_t r = 0; r < (uint64_t(1) << system.n_digit()); ++r) {
+    std::bitset<RepSize> rep(r);
+    size_t idx = hash_sector.find(rep);
+    REQUIRE(sorted_sector.find(rep) == idx);
+    REQUIRE(direct_sector.find(rep) == idx);
+    REQUIRE(lin_sector.find(rep) == idx);
+  }
+}
+
+TEST_CASE("Parallel sector generation", "[parallel]") {
+  static const size_t RepSize = 24;
+  static const size_t SiteSize = 24;
+
+  auto system = make_hubbard_system(6);
+  SectorGenerator<RepSize, SiteSize, Charge, Spin> sector_gen(system);
+  for (int64_t charge = 0; charge <= 12; ++charge) {
+    for (int64_t spin = -2; spin <= 2; ++spin) {
+      auto sector = sector_gen.generate(Charge(charge), Spin(spin));
+      for (size_t n_thread : {1, 3, 4}) {
+        auto parallel_sector = sector_gen.generate_parallel(n_thread, Charge(charge), Spin(spin));
+        REQUIRE(parallel_sector.basis == sector.basis);
+        REQUIRE(parallel_sector.size() == sector.size());
+      }
+    }
+  }
+}
+
+TEST_CASE("Sector dimensions without enumeration", "[dimension]") {
+  static const size_t RepSize = 16;
+  static const size_t SiteSize = 16;
+
+  auto system = make_spin_fermion_system();
+  SectorGenerator<RepSize, SiteSize, Charge, Spin> sector_gen(system);
+  auto dimensions = system.sector_dimensions();
+
+  size_t n_total = 0;
+  for (auto const & dim : dimensions) {
+    n_total += dim.second;
+    auto charge = std::get<0>(dim.first);
+    auto spin = std::get<1>(dim.first);
+    REQUIRE(system.sector_dimension(charge, spin) == dim.second);
+    REQUIRE(sector_gen.generate(charge, spin).basis.size() == dim.second);
+  }
+  REQUIRE(n_total == 27 * 64);
+  REQUIRE(system.sector_dimension(Charge(7), Spin(0)) == 0);
+  REQUIRE(make_hubbard_system(16).sector_dimension(Charge(16), Spin(0)) == 165636900);
+}
+
+TEST_CASE("Single-pass generation of all sectors", "[generate_all]") {
+  static const size_t RepSize = 16;
+  static const size_t SiteSize = 16;
+
+  auto system = make_spin_fermion_system();
+  BasicSectorGenerator<SortedArrayLookup, RepSize, SiteSize, Charge, Spin> sector_gen(system);
+  auto dimensions = system.sector_dimensions();
+  for (size_t n_thread : {1, 4}) {
+    auto sectors = sector_gen.generate_all(n_thread);
+    REQUIRE(sectors.size() == dimensions.size());
+    for (auto const & s : sectors) {
+      auto sector = sector_gen.generate(std::get<0>(s.first), std::get<1>(s.first));
+      REQUIRE(s.second.size() == dimensions[s.first]);
+      REQUIRE(s.second.basis == sector.basis);
+      for (size_t i = 0; i < sector.size(); ++i) {
+        REQUIRE(s.second.find_word(sector.basis[i]) == i);
+      }
+    }
+  }
+}
+
+TEST_CASE("Finalized system layout", "[layout]") {
+  static const size_t RepSize = 16;
+  static const size_t SiteSize = 16;
+
+  auto system = make_spin_fermion_system();
+  auto frozen = make_spin_fermion_system();
+  frozen.finalize();
+  REQUIRE(!system.finalized());
+  REQUIRE(frozen.finalized());
+  REQUIRE_THROWS_AS(frozen.add_site(frozen.site(0)), const std::logic_error&);
+  REQUIRE_THROWS_AS(system.layout(), const std::logic_error&);
+
+  REQUIRE(frozen.n_digit() == system.n_digit());
+  REQUIRE(frozen.max_quantum_number() == system.max_quantum_number());
+  REQUIRE(frozen.min_quantum_number() == system.min_quantum_number());
+  for (size_t i_site = 0; i_site < system.n_site(); ++i_site) {
+    REQUIRE(frozen.start_digit(i_site) == system.start_digit(i_site));
+    REQUIRE(frozen.mask_digit<RepSize>(i_site) == system.mask_digit<RepSize>(i_site));
+    REQUIRE(frozen.max_quantum_number(i_site) == system.max_quantum_number(i_site));
+    REQUIRE(frozen.min_quantum_number(i_site) == system.min_quantum_number(i_site));
+  }
+
+  SectorGenerator<RepSize, SiteSize, Charge, Spin> sector_gen(system);
+  SectorGenerator<RepSize, SiteSize, Charge, Spin> frozen_sector_gen(frozen);
+  for (auto const & dim : system.sector_dimensions()) {
+    auto charge = std::get<0>(dim.first);
+    auto spin = std::get<1>(dim.first);
+    REQUIRE(frozen_sector_gen.generate(charge, spin).basis == sector_gen.generate(charge, spin).basis);
+  }
+}
+
+TEST_CASE("Compact states and operators", "[compact]") {
+  static const size_t RepSize = 16;
+  static const size_t SiteSize = 16;
+  using MixedOperatorType = MixedOperator<double, RepSize, SiteSize>;
+  using CompactOperatorType = CompactOperator<double, RepSize, SiteSize>;
+
+  auto system = make_spin_fermion_system();
+  SectorGenerator<RepSize, SiteSize, Charge, Spin> sector_gen(system);
+  CompactCodec<RepSize, SiteSize> codec(system);
+
+  MixedOperatorType op;
+  for (size_t i_cell = 0; i_cell < 3; ++i_cell) {
+    size_t i_up = 3 * i_cell + 1, i_dn = 3 * i_cell + 2;
+    size_t j_up = (3 * i_cell + 4) % 9, j_dn = (3 * i_cell + 5) % 9;
+    op.add(-1.0 * system.get_operator<double, RepSize, SiteSize>(i_up, 1, 0)
+                * system.get_operator<double, RepSize, SiteSize>(j_up, 0, 1));
+    op.add(-2.0 * system.get_operator<double, RepSize, SiteSize>(j_dn, 1, 0)
+                * system.get_operator<double, RepSize, SiteSize>(i_dn, 0, 1));
+    op.add(0.5 * system.get_operator<double, RepSize, SiteSize>(3 * i_cell, 2, 1)
+               * system.get_operator<double, RepSize, SiteSize>(i_dn, 1, 0)
+               * system.get_operator<double, RepSize, SiteSize>(i_up, 0, 1));
+  }
+  CompactOperatorType compact_op(op, codec);
+  REQUIRE(compact_op.n_term() == op.n_term());
+
+  for (int64_t charge = 0; charge <= 6; ++charge) {
+    for (int64_t spin = -6; spin <= 6; ++spin) {
+      auto sector = sector_gen.generate(Charge(charge), Spin(spin));
+      size_t i_basis = 0;
+      for (auto iter = system.cbegin<RepSize, SiteSize>(Charge(charge), Spin(spin)); iter.valid(); ++iter, ++i_basis) {
+        REQUIRE(sector.state(i_basis) == iter.get());
+        REQUIRE(codec.encode(std::get<0>(iter.get())) == iter.word());
+
+        // the compact operator groups its results by mask and col.
+        auto expected = op.apply(std::get<0>(iter.get()), std::get<1>(iter.get()));
+        auto result = compact_op.apply(iter.word());
+        REQUIRE(result.size() == expected.size());
+        for (auto const & r : result) {
+          auto decoded = codec.decode(std::get<0>(r));
+          auto found = std::find(expected.begin(), expected.end(),
+                                 std::make_tuple(std::get<0>(decoded), std::get<1>(decoded), std::get<1>(r)));
+          REQUIRE(found != expected.end());
+        }
+      }
+      REQUIRE(i_basis == sector.size());
+    }
+  }
+}
+
+TEST_CASE("Modular quantum numbers", "[modular]") {
+  using Momentum = ZnCharge<8>;
+  REQUIRE(ZnCharge<3>(2) + ZnCharge<3>(2) == ZnCharge<3>(1));
+  REQUIRE(ZnCharge<3>(0) - ZnCharge<3>(1) == ZnCharge<3>(2));
+  REQUIRE(ZnCharge<3>(-4).value() == 2);
+  REQUIRE(Momentum::Modulus == 8);
+  REQUIRE(Charge::Modulus == 0);
+
+  // spinless fermions in the momentum modes k = 0, ..., 7 of a ring.
+  System<Charge, Momentum> system;
+  State<Charge, Momentum> e("E", false, Charge(0), Momentum(0));
+  for (int k = 0; k < 8; ++k) {
+    system.add_site(Site<Charge, Momentum>(e, State<Charge, Momentum>("F", true, Charge(1), Momentum(k))));
+  }
+  REQUIRE(system.reach(3).residue_mask()[1] == 0x0F);  // modes 0, 1, 2 reach 0 to 3
+  REQUIRE(system.reach(3).reachable(std::make_tuple(Charge(0), Momentum(6)), std::make_tuple(Charge(1), Momentum(7))));
+  REQUIRE(!system.reach(3).reachable(std::make_tuple(Charge(0), Momentum(6)), std::make_tuple(Charge(1), Momentum(5))));
+
+  auto dimensions = system.sector_dimensions();
+  size_t total = 0;
+  for (int k = 0; k < 8; ++k) {
+    std::vector<uint64_t> expected;
+    for (uint64_t w = 0; w < 256; ++w) {
+      int momentum = 0;
+      for (int i = 0; i < 8; ++i) { momentum += ((w >> i) & 1) ? i : 0; }
+      if (__builtin_popcountll(w) == 3 && momentum % 8 == k) { expected.push_back(w); }
+    }
+    auto sector = SectorGenerator<16, 16, Charge, Momentum>(system).generate(Charge(3), Momentum(k));
+    REQUIRE(sector.size() == expected.size());
+    for (size_t i = 0; i < sector.size(); ++i) { REQUIRE(sector.word(i) == expected[i]); }
+    REQUIRE(system.sector_dimension(Charge(3), Momentum(k)) == expected.size());
+    REQUIRE(dimensions[std::make_tuple(Charge(3), Momentum(k))] == expected.size());
+    auto parallel = SectorGenerator<16, 16, Charge, Momentum>(system).generate_parallel(3, Charge(3), Momentum(k));
+    REQUIRE(parallel.basis == sector.basis);
+    total += sector.size();
+  }
+  REQUIRE(total == 56);
+
+  SECTION("residues which cannot be reached") {
+    // only the even modes: the odd momenta are empty, and pruned at the top of the tree.
+    System<Charge, Momentum> even;
+    for (int k = 0; k < 8; k += 2) {
+      even.add_site(Site<Charge, Momentum>(e, State<Charge, Momentum>("F", true, Charge(1), Momentum(k))));
+    }
+    even.finalize();
+    REQUIRE(even.reach(3).residue_mask()[1] == 0x55);
+    REQUIRE(even.sector_dimension(Charge(2), Momentum(3)) == 0);
+    auto iter = even.cbegin<16, 16>(Charge(2), Momentum(3));
+    REQUIRE(!iter.valid());
+    REQUIRE(even.sector_dimension(Charge(2), Momentum(2)) == 2);   // {0, 2} and {4, 6}
+  }
+
+  SECTION("clock model") {
+    System<ZnCharge<3>> clock;
+    State<ZnCharge<3>> s0("0", false, ZnCharge<3>(0)), s1("1", false, ZnCharge<3>(1)), s2("2", false, ZnCharge<3>(2));
+    for (size_t i = 0; i < 5; ++i) { clock.add_site(Site<ZnCharge<3>>(s0, s1, s2)); }
+    using ClockGenerator = SectorGenerator<16, 16, ZnCharge<3>>;
+    for (int q = 0; q < 3; ++q) {
+      REQUIRE(ClockGenerator(clock).generate(ZnCharge<3>(q)).size() == 81);
+    }
+  }
+}
+
+TEST_CASE("Packed quantum numbers", "[packing]") {
+  auto system = make_hubbard_system(3);
+  QuantumNumberPacking<Charge, Spin> packing = *system.packing();
+  REQUIRE(packing.valid());
+  // Charge in [0, 6] and Spin in [-3, 3]: two lanes of 3 bits and their guard bits.
+  REQUIRE(packing.guard() == ((uint64_t(1) << 3) | (uint64_t(1) << 7)));
+  REQUIRE(packing.offset(1, 1) == (uint64_t(1) | (uint64_t(0) << 4)));
+  REQUIRE(packing.offset(0, 1) == (uint64_t(1) | (uint64_t(1) << 4)));
+  REQUIRE(packing.offset(1, 0) == (uint64_t(1) << 4));
+
+  uint64_t target;
+  std::vector<uint64_t> lower;
+  REQUIRE(packing.bounds(std::make_tuple(Charge(3), Spin(1)), target, lower));
+  REQUIRE(target == (uint64_t(3) | (uint64_t(4) << 4)));
+  REQUIRE(lower.size() == 7);
+  REQUIRE(lower[0] == target);
+  REQUIRE(lower[6] == 0);
+  REQUIRE(packing.within(target, lower[3], target));
+  REQUIRE(!packing.within(uint64_t(4) | (uint64_t(4) << 4), lower[3], target));
+  REQUIRE(!packing.within(uint64_t(3) | (uint64_t(5) << 4), lower[3], target));
+  REQUIRE(!packing.bounds(std::make_tuple(Charge(7), Spin(1)), target, lower));
+
+  // Z_n quantum numbers are enumerated without packing.
+  System<ZnCharge<3>> clock;
+  State<ZnCharge<3>> s0("0", false, ZnCharge<3>(0)), s1("1", false, ZnCharge<3>(1));
+  clock.add_site(Site<ZnCharge<3>>(s0, s1));
+  REQUIRE(!clock.packing()->valid());
+}
+
+TEST_CASE("Combination bases of two-state sites", "[combination]") {
+  auto system = make_hubbard_system(5);
+  CombinationBasis<16, Charge, Spin> combinations(system);
+  REQUIRE(combinations.valid());
+  REQUIRE(combinations.n_species() == 2);   // up and down orbitals
+  REQUIRE(combinations.species_digits(1) == std::vector<size_t>({1, 3, 5, 7, 9}));
+  REQUIRE(combinations.species_delta(1) == std::make_tuple(Charge(1), Spin(-1)));
+
+  for (int64_t charge = -1; charge <= 11; ++charge) {
+    for (int64_t spin = -6; spin <= 6; ++spin) {
+      std::vector<uint64_t> expected;
+      for (auto iter = system.cbegin<16, 16>(Charge(charge), Spin(spin)); iter.valid(); ++iter) {
+        expected.push_back(iter.word());
+      }
+      std::vector<uint64_t> basis;
+      REQUIRE(combinations.generate(std::make_tuple(Charge(charge), Spin(spin)), basis));
+      REQUIRE(basis == expected);
+      auto sector = SectorGenerator<16, 16, Charge, Spin>(system).generate(Charge(charge), Spin(spin));
+      REQUIRE(sector.basis == expected);
+      for (size_t i = 0; i < sector.size(); ++i) { REQUIRE(sector.find_word(expected[i]) == i); }
+    }
+  }
+
+  SECTION("on several threads") {
+    auto large = make_hubbard_system(10);
+    CombinationBasis<32, Charge, Spin> large_combinations(large);
+    for (auto qn : {std::make_tuple(Charge(10), Spin(0)), std::make_tuple(Charge(7), Spin(3))}) {
+      std::vector<uint64_t> expected, basis;
+      REQUIRE(large_combinations.generate(qn, expected));
+      REQUIRE(large_combinations.generate(qn, basis, 3));
+      REQUIRE(basis == expected);
+      REQUIRE(std::is_sorted(expected.begin(), expected.end()));
+    }
+    auto sector = SectorGenerator<32, 32, Charge, Spin>(large).generate_parallel(3, Charge(10), Spin(0));
+    REQUIRE(sector.size() == 63504);   // (10 choose 5)^2
+    REQUIRE(std::is_sorted(sector.basis.begin(), sector.basis.end()));
+  }
+
+  SECTION("wide representations") {
+    auto wide = make_hubbard_system(3);
+    using WideCombinationBasis = CombinationBasis<80, Charge, Spin>;
+    std::vector<detail::uint128_t> basis;
+    REQUIRE(WideCombinationBasis(wide).generate(std::make_tuple(Charge(3), Spin(1)), basis));
+    auto sector = SectorGenerator<80, 80, Charge, Spin>(wide).generate(Charge(3), Spin(1));
+    REQUIRE(basis.size() == 9);
+    for (size_t i = 0; i < basis.size(); ++i) {
+      bool same = (basis[i] == sector.word(i));
+      REQUIRE(same);
+      REQUIRE(CompactRep<80>::popcount(basis[i]) == 3);
+    }
+  }
+
+  SECTION("spin-1/2 chain") {
+    System<Spin> chain;
+    State<Spin> up("Up", false, Spin(1)), dn("Dn", false, Spin(-1));
+    for (size_t i = 0; i < 12; ++i) { chain.add_site(Site<Spin>(dn, up)); }
+    CombinationBasis<16, Spin> spin_combinations(chain);
+    REQUIRE(spin_combinations.n_species() == 1);
+    std::vector<uint64_t> basis;
+    REQUIRE(spin_combinations.generate(std::make_tuple(Spin(2)), basis));
+    REQUIRE(basis.size() == 792);   // 7 of 12 spins up
+    REQUIRE(std::is_sorted(basis.begin(), basis.end()));
+    for (uint64_t w : basis) { REQUIRE(__builtin_popcountll(w) == 7); }
+    REQUIRE(spin_combinations.generate(std::make_tuple(Spin(3)), basis));
+    REQUIRE(basis.empty());   // odd magnetization of an even chain
+  }
+
+  SECTION("sites with more states") {
+    auto mixed = make_spin_fermion_system();
+    CombinationBasis<16, Charge, Spin> mixed_combinations(mixed);
+    REQUIRE(!mixed_combinations.valid());
+    std::vector<uint64_t> basis;
+    REQUIRE(!mixed_combinations.generate(std::make_tuple(Charge(2), Spin(0)), basis));
+    REQUIRE(basis.empty());
+  }
+}
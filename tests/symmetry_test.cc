@@ -0,0 +1,339 @@
+#define CATCH_CONFIG_MAIN
+
+#include "catch.hpp"
+
+#include <Eigen/Dense>
+
+#include "hilbertspace.h"
+#include "operator.h"
+#include "hamiltonian.h"
+#include "symmetry.h"
+#include "models.h"
+
+namespace {
+
+static const size_t RepSize = 16;
+static const size_t SiteSize = 16;
+using MixedOperatorType = MixedOperator<double, RepSize, SiteSize>;
+using PermutationType = SitePermutation<RepSize, SiteSize>;
+
+//! Translation-invariant Hubbard ring, with the up and down sites of every cell next to each other.
+struct HubbardRing : HubbardModel<RepSize, SiteSize>
+{
+  HubbardRing(size_t n)
+      : HubbardModel<RepSize, SiteSize>(n, 4.0, false)
+  {
+  }
+
+  PermutationType translation() const {
+    std::vector<size_t> image(2 * n_cell);
+    for (size_t i = 0; i < image.size(); ++i) { image[i] = (i + 2) % image.size(); }
+    return PermutationType(system, image);
+  }
+};
+
+//! Sorted eigenvalues of a Hermitian matrix.
+template <typename MatrixType>
+std::vector<double> eigenvalues(const MatrixType& matrix)
+{
+  Eigen::SelfAdjointEigenSolver<MatrixType> solver(matrix, Eigen::EigenvaluesOnly);
+  std::vector<double> ret(solver.eigenvalues().data(), solver.eigenvalues().data() + solver.eigenvalues().size());
+  return ret;
+}
+
+} // namespace
+
+TEST_CASE("Site permutation", "[symmetry]") {
+  HubbardRing model(3);
+  PermutationType t = model.translation();
+  CompactCodec<RepSize, SiteSize> codec(model.system);
+
+  // up electrons on cells 0 and 2: moving them to cells 1 and 0 reverses their order.
+  uint64_t w = (1 << 0) | (1 << 4);
+  REQUIRE(t.apply(w) == ((1 << 2) | (1 << 0)));
+  REQUIRE(t.odd(codec.fermion_parity(w)));
+  // one electron, or two which keep their order
+  REQUIRE(!t.odd(codec.fermion_parity(1 << 0)));
+  REQUIRE(!t.odd(codec.fermion_parity((1 << 0) | (1 << 1))));
+
+  REQUIRE((t * t * t).is_identity());
+  REQUIRE((t * t.inverse()).is_identity());
+
+  REQUIRE_THROWS_AS(PermutationType(model.system, std::vector<size_t>{0, 1, 2}), const std::length_error&);
+  REQUIRE_THROWS_AS(PermutationType(model.system, std::vector<size_t>{1, 0, 2, 3, 4, 5}), const std::domain_error&);
+  REQUIRE_THROWS_AS(PermutationType(model.system, std::vector<size_t>{0, 0, 2, 3, 4, 5}), const std::domain_error&);
+}
+
+TEST_CASE("Momentum sectors", "[symmetry]") {
+  HubbardRing model(6);
+  TranslationGroup<RepSize, SiteSize> group({model.translation()});
+  REQUIRE(group.n_element() == 6);
+  REQUIRE(group.length(0) == 6);
+
+  for (auto qn : {std::make_tuple(Charge(6), Spin(0)), std::make_tuple(Charge(4), Spin(2))}) {
+    auto sector = SectorGenerator<RepSize, SiteSize, Charge, Spin>(model.system)
+                      .generate(std::get<0>(qn), std::get<1>(qn));
+    auto sparse = HamiltonianBuilder<double, RepSize, SiteSize>(model.hamiltonian).build(sector);
+    std::vector<double> expected = eigenvalues(Eigen::MatrixXd(sparse.matrix()));
+
+    std::vector<double> found;
+    size_t dimension = 0;
+    for (size_t k = 0; k < group.length(0); ++k) {
+      SymmetricSectorGenerator<RepSize, SiteSize, Charge, Spin> generator(
+          model.system, group.elements(), group.characters({k}));
+      auto momentum_sector = generator.generate(std::get<0>(qn), std::get<1>(qn));
+      dimension += momentum_sector.size();
+      if (momentum_sector.size() == 0) { continue; }
+      REQUIRE(momentum_sector.size() <= sector.size() / 6 + sector.size() / 12 + 1);
+
+      auto hamiltonian = SymmetricHamiltonianBuilder<double, RepSize, SiteSize>(model.hamiltonian).build(momentum_sector);
+      Eigen::MatrixXcd matrix(hamiltonian.matrix());
+      REQUIRE((matrix - matrix.adjoint()).norm() < 1E-12);
+      for (size_t i = 0; i < hamiltonian.size(); ++i) {
+        REQUIRE(hamiltonian.diagonal()[i] == matrix(i, i));
+      }
+      auto values = eigenvalues(matrix);
+      found.insert(found.end(), values.begin(), values.end());
+    }
+    REQUIRE(dimension == sector.size());
+    std::sort(found.begin(), found.end());
+    REQUIRE(found.size() == expected.size());
+    for (size_t i = 0; i < found.size(); ++i) {
+      REQUIRE(std::abs(found[i] - expected[i]) < 1E-10);
+    }
+  }
+
+  SECTION("representatives") {
+    SymmetricSectorGenerator<RepSize, SiteSize, Charge, Spin> generator(
+        model.system, group.elements(), group.characters({1}));
+    auto sector = generator.generate(Charge(2), Spin(0));
+    for (size_t i = 0; i < sector.size(); ++i) {
+      auto rep = sector.representative(model.translation().apply(sector.word(i)));
+      REQUIRE(rep.index == i);
+      REQUIRE(rep.word == sector.word(i));
+      REQUIRE(sector.norm(i) > 0);
+    }
+  }
+
+  SECTION("on several threads") {
+    SymmetricSectorGenerator<RepSize, SiteSize, Charge, Spin> generator(
+        model.system, group.elements(), group.characters({3}));
+    auto sector = generator.generate(Charge(6), Spin(0));
+    auto parallel_sector = generator.generate_parallel(3, Charge(6), Spin(0));
+    REQUIRE(sector.size() > 0);
+    REQUIRE(parallel_sector.basis == sector.basis);
+    REQUIRE(parallel_sector.norms == sector.norms);
+  }
+}
+
+TEST_CASE("Momentum sectors of a torus", "[symmetry]") {
+  // spinless fermions on a 3 x 2 torus, site = 2 ix + iy.
+  System<Charge> system;
+  State<Charge> e("E", false, Charge(0));
+  State<Charge> f("F", true, Charge(1));
+  Site<Charge> site(e, f);
+  for (size_t i = 0; i < 6; ++i) { system.add_site(site); }
+
+  MixedOperatorType hamiltonian;
+  auto c = [&](size_t i) { return system.get_operator<double, RepSize, SiteSize>(i, 0, 1); };
+  auto cdag = [&](size_t i) { return system.get_operator<double, RepSize, SiteSize>(i, 1, 0); };
+  auto index = [](size_t ix, size_t iy) { return 2 * (ix % 3) + (iy % 2); };
+  std::vector<size_t> tx(6), ty(6);
+  for (size_t ix = 0; ix < 3; ++ix) {
+    for (size_t iy = 0; iy < 2; ++iy) {
+      size_t i = index(ix, iy);
+      tx[i] = index(ix + 1, iy);
+      ty[i] = index(ix, iy + 1);
+      hamiltonian.add(-1.0 * cdag(i) * c(tx[i]));
+      hamiltonian.add(-1.0 * cdag(tx[i]) * c(i));
+      hamiltonian.add(-0.5 * cdag(i) * c(ty[i]));
+      hamiltonian.add(2.0 * cdag(i) * c(i) * cdag(tx[i]) * c(tx[i]));
+    }
+  }
+
+  TranslationGroup<RepSize, SiteSize> group({PermutationType(system, tx), PermutationType(system, ty)});
+  REQUIRE(group.n_element() == 6);
+
+  auto sector = SectorGenerator<RepSize, SiteSize, Charge>(system).generate(Charge(3));
+  auto sparse = HamiltonianBuilder<double, RepSize, SiteSize>(hamiltonian).build(sector);
+  std::vector<double> expected = eigenvalues(Eigen::MatrixXd(sparse.matrix()));
+
+  std::vector<double> found;
+  for (size_t kx = 0; kx < 3; ++kx) {
+    for (size_t ky = 0; ky < 2; ++ky) {
+      SymmetricSectorGenerator<RepSize, SiteSize, Charge> generator(system, group.elements(), group.characters({kx, ky}));
+      auto momentum_sector = generator.generate(Charge(3));
+      if (momentum_sector.size() == 0) { continue; }
+      auto momentum_sparse = SymmetricHamiltonianBuilder<double, RepSize, SiteSize>(hamiltonian).build(momentum_sector);
+      auto values = eigenvalues(Eigen::MatrixXcd(momentum_sparse.matrix()));
+      found.insert(found.end(), values.begin(), values.end());
+    }
+  }
+  std::sort(found.begin(), found.end());
+  REQUIRE(found.size() == expected.size());
+  for (size_t i = 0; i < found.size(); ++i) {
+    REQUIRE(std::abs(found[i] - expected[i]) < 1E-10);
+  }
+
+  using GroupType = TranslationGroup<RepSize, SiteSize>;
+  REQUIRE_THROWS_AS(GroupType({PermutationType(system, tx), PermutationType(system, tx)}), const std::domain_error&);
+  REQUIRE_THROWS_AS(group.characters({0}), const std::length_error&);
+}
+
+TEST_CASE("Bit permutation kernel", "[symmetry]") {
+  HubbardRing model(5);
+  PermutationType t = model.translation();
+  std::vector<size_t> reflected(10);
+  for (size_t i = 0; i < 10; ++i) { reflected[i] = 2 * ((5 - i / 2) % 5) + i % 2; }
+  PermutationType r(model.system, reflected);
+  for (auto const & g : {t, r, t * r, t * t * r}) {
+    BitPermutation<RepSize> kernel(g.digit_image());
+    REQUIRE(kernel.n_byte() == 2);
+    for (uint64_t w = 0; w < (1 << 10); ++w) {
+      REQUIRE(kernel.apply(w) == g.apply(w));
+    }
+  }
+}
+
+TEST_CASE("Point group sectors", "[symmetry]") {
+  HubbardRing model(6);
+  std::vector<size_t> reflected(12);
+  for (size_t i = 0; i < 12; ++i) { reflected[i] = 2 * ((6 - i / 2) % 6) + i % 2; }
+  PermutationGroup<RepSize, SiteSize> dihedral({model.translation(), PermutationType(model.system, reflected)});
+  REQUIRE(dihedral.n_element() == 12);
+  REQUIRE(dihedral.elements()[0].is_identity());
+
+  TranslationGroup<RepSize, SiteSize> translations({model.translation()});
+  SymmetricSectorGenerator<RepSize, SiteSize, Charge, Spin> momentum_generator(
+      model.system, translations.elements(), translations.characters({0}));
+  auto momentum_sector = momentum_generator.generate(Charge(6), Spin(0));
+  auto momentum_sparse = SymmetricHamiltonianBuilder<double, RepSize, SiteSize>(model.hamiltonian).build(momentum_sector);
+  std::vector<double> expected = eigenvalues(Eigen::MatrixXcd(momentum_sparse.matrix()));
+
+  // k = 0, even and odd under the reflection.
+  std::vector<double> found;
+  size_t dimension = 0;
+  for (double parity : {1.0, -1.0}) {
+    auto characters = dihedral.characters({1.0, parity});
+    SymmetricSectorGenerator<RepSize, SiteSize, Charge, Spin> generator(model.system, dihedral.elements(), characters);
+    auto sector = generator.generate(Charge(6), Spin(0));
+    dimension += sector.size();
+    auto sparse = SymmetricHamiltonianBuilder<double, RepSize, SiteSize>(model.hamiltonian).build(sector);
+    auto values = eigenvalues(Eigen::MatrixXcd(sparse.matrix()));
+    found.insert(found.end(), values.begin(), values.end());
+  }
+  REQUIRE(dimension == momentum_sector.size());
+  std::sort(found.begin(), found.end());
+  REQUIRE(found.size() == expected.size());
+  for (size_t i = 0; i < found.size(); ++i) {
+    REQUIRE(std::abs(found[i] - expected[i]) < 1E-10);
+  }
+
+  // r t r = t^-1, so chi(t) = +-1.
+  using Complex = std::complex<double>;
+  REQUIRE_THROWS_AS(dihedral.characters({Complex(0, 1), Complex(1)}), const std::domain_error&);
+  REQUIRE_THROWS_AS(dihedral.characters({Complex(1)}), const std::length_error&);
+}
+
+TEST_CASE("Spin-flip and particle-hole sectors", "[symmetry]") {
+  using Z2OperationType = Z2Operation<RepSize, SiteSize>;
+  using Z2GeneratorType = BasicSymmetricSectorGenerator<Z2OperationType, Charge, Spin>;
+  auto spin_flip = [](const HubbardRing& model) {
+    std::vector<std::pair<size_t, size_t>> pairs;
+    for (size_t i = 0; i < model.n_cell; ++i) { pairs.push_back(std::make_pair(2 * i, 2 * i + 1)); }
+    return Z2OperationType::spin_flip(model.system, pairs);
+  };
+  // eta = (-1)^cell, on a bipartite ring.
+  auto particle_hole = [](const HubbardRing& model) {
+    std::vector<int> eta;
+    for (size_t i = 0; i < 2 * model.n_cell; ++i) { eta.push_back((i / 2) % 2 == 0 ? 1 : -1); }
+    return Z2OperationType::particle_hole(model.system, eta);
+  };
+
+  // U (n_up - 1/2) (n_dn - 1/2) is particle-hole symmetric.
+  HubbardRing model(4);
+  for (size_t i = 0; i < 2 * model.n_cell; ++i) {
+    model.hamiltonian.add(-2.0 * model.system.get_operator<double, RepSize, SiteSize>(i, 1, 1));
+  }
+  auto sector = SectorGenerator<RepSize, SiteSize, Charge, Spin>(model.system).generate(Charge(4), Spin(0));
+  auto sparse = HamiltonianBuilder<double, RepSize, SiteSize>(model.hamiltonian).build(sector);
+  std::vector<double> expected = eigenvalues(Eigen::MatrixXd(sparse.matrix()));
+
+  CompactCodec<RepSize, SiteSize> codec(model.system);
+  Z2OperationType s = spin_flip(model), c = particle_hole(model);
+  for (size_t i = 0; i < sector.size(); ++i) {
+    auto w = std::get<0>(sector.state(i)).to_ullong();
+    REQUIRE(s.apply(s.apply(w)) == w);
+    REQUIRE(c.apply(w) == (~w & 0xFF));
+    REQUIRE((s * c).apply(w) == c.apply(s.apply(w)));
+    REQUIRE((s * c).odd(codec.fermion_parity(w)) == (s.odd(codec.fermion_parity(c.apply(w))) != c.odd(codec.fermion_parity(w))));
+  }
+
+  Z2Group<RepSize, SiteSize> group(model.system, {s, c});
+  REQUIRE(group.n_element() == 4);
+  std::vector<double> found;
+  size_t dimension = 0;
+  for (int es : {1, -1}) {
+    for (int ec : {1, -1}) {
+      Z2GeneratorType generator(model.system, group.elements(), group.characters({es, ec}));
+      auto z2_sector = generator.generate(Charge(4), Spin(0));
+      dimension += z2_sector.size();
+      auto hamiltonian = SymmetricHamiltonianBuilder<double, RepSize, SiteSize>(model.hamiltonian).build(z2_sector);
+      Eigen::MatrixXcd matrix(hamiltonian.matrix());
+      REQUIRE((matrix - matrix.adjoint()).norm() < 1E-12);
+      auto values = eigenvalues(matrix);
+      found.insert(found.end(), values.begin(), values.end());
+    }
+  }
+  REQUIRE(dimension == sector.size());
+  std::sort(found.begin(), found.end());
+  REQUIRE(found.size() == expected.size());
+  for (size_t i = 0; i < found.size(); ++i) {
+    REQUIRE(std::abs(found[i] - expected[i]) < 1E-10);
+  }
+
+  SECTION("sectors which are not conserved") {
+    HubbardRing small_model(2);
+    Z2Group<RepSize, SiteSize> flip_group(small_model.system, {spin_flip(small_model)});
+    Z2GeneratorType flip_generator(small_model.system, flip_group.elements(), flip_group.characters({1}));
+    Z2GeneratorType odd_generator(small_model.system, flip_group.elements(), flip_group.characters({-1}));
+    REQUIRE(flip_generator.generate(Charge(2), Spin(0)).size() + odd_generator.generate(Charge(2), Spin(0)).size() == 4);
+    REQUIRE_THROWS_AS(flip_generator.generate(Charge(2), Spin(2)), const std::domain_error&);
+    REQUIRE_THROWS_AS(flip_generator.generate(Charge(1), Spin(-1)), const std::domain_error&);
+    REQUIRE(flip_generator.generate(Charge(4), Spin(2)).size() == 0);
+
+    Z2Group<RepSize, SiteSize> hole_group(small_model.system, {particle_hole(small_model)});
+    Z2GeneratorType hole_generator(small_model.system, hole_group.elements(), hole_group.characters({1}));
+    REQUIRE_THROWS_AS(hole_generator.generate_parallel(2, Charge(1), Spin(1)), const std::domain_error&);
+  }
+
+  SECTION("spin flip on an odd ring") {
+    HubbardRing odd_model(3);
+    auto odd_sector = SectorGenerator<RepSize, SiteSize, Charge, Spin>(odd_model.system).generate(Charge(2), Spin(0));
+    auto odd_sparse = HamiltonianBuilder<double, RepSize, SiteSize>(odd_model.hamiltonian).build(odd_sector);
+    std::vector<double> odd_expected = eigenvalues(Eigen::MatrixXd(odd_sparse.matrix()));
+
+    Z2Group<RepSize, SiteSize> flip_group(odd_model.system, {spin_flip(odd_model)});
+    std::vector<double> odd_found;
+    for (int es : {1, -1}) {
+      Z2GeneratorType generator(odd_model.system, flip_group.elements(), flip_group.characters({es}));
+      auto z2_sector = generator.generate(Charge(2), Spin(0));
+      auto hamiltonian = SymmetricHamiltonianBuilder<double, RepSize, SiteSize>(odd_model.hamiltonian).build(z2_sector);
+      auto values = eigenvalues(Eigen::MatrixXcd(hamiltonian.matrix()));
+      odd_found.insert(odd_found.end(), values.begin(), values.end());
+    }
+    std::sort(odd_found.begin(), odd_found.end());
+    REQUIRE(odd_found.size() == odd_expected.size());
+    for (size_t i = 0; i < odd_found.size(); ++i) {
+      REQUIRE(std::abs(odd_found[i] - odd_expected[i]) < 1E-10);
+    }
+
+    // on 3 cells, S C = -C S, and C^2 = -1 for eta = 1.
+    using GroupType = Z2Group<RepSize, SiteSize>;
+    REQUIRE_THROWS_AS(GroupType(odd_model.system, {spin_flip(odd_model), particle_hole(odd_model)}), const std::domain_error&);
+    REQUIRE_THROWS_AS(GroupType(odd_model.system, {Z2OperationType::particle_hole(odd_model.system, std::vector<int>(6, 1))}),
+                      const std::domain_error&);
+    REQUIRE_THROWS_AS(flip_group.characters({2}), const std::domain_error&);
+    REQUIRE_THROWS_AS(Z2OperationType::particle_hole(odd_model.system, {1}), const std::length_error&);
+  }
+}